@@ -0,0 +1,109 @@
+/*
+ * battery.h
+ * Low-rate battery sampler with smoothing, caching and runtime estimate
+ */
+
+#ifndef BATTERY_H
+#define BATTERY_H
+
+// Battery state, level is kept in 1/256 % fixed point
+struct BatteryState {
+  bool primed;                  // First sample taken
+  bool charging;
+  bool dirty;                   // Battery widget needs a redraw
+  int32_t filtered;             // Smoothed level (1/256 %)
+  int level;                    // Rounded level shown on screen, -1 if unknown
+  long minutesRemaining;        // Estimated runtime, -1 if unknown
+  int32_t anchorLevel;          // Filtered level at start of the discharge window
+  unsigned long anchorTime;
+  int32_t midLevel;             // Level one window in, the anchor once the window slides
+  unsigned long midTime;        // 0 until the window is that long
+  unsigned long lastSample;
+};
+
+BatteryState battery = {false, false, false, 0, -1, -1, 0, 0, 0, 0, 0};
+
+// Fold one power IC reading into the filter and the runtime estimate, no I/O
+void batteryAddSample(int32_t raw, bool charging, unsigned long now) {
+  if (raw < 0) {
+    // No fuel gauge on this board
+    if (battery.level != -1) {
+      battery.level = -1;
+      battery.dirty = true;
+    }
+    return;
+  }
+
+  if (!battery.primed) {
+    battery.filtered = raw << 8;
+    battery.primed = true;
+  } else {
+    battery.filtered += ((raw << 8) - battery.filtered) >> batteryFilterShift;
+  }
+
+  // Restart the discharge window on charger changes or when the level goes up
+  if (charging != battery.charging || battery.anchorTime == 0 || battery.filtered > battery.anchorLevel) {
+    battery.charging = charging;
+    battery.anchorLevel = battery.filtered;
+    battery.anchorTime = now;
+    battery.midTime = 0;
+    if (charging && battery.minutesRemaining != -1) {
+      battery.minutesRemaining = -1;
+      battery.dirty = true;
+    }
+  }
+
+  // Estimate runtime from the average discharge rate over the window
+  unsigned long elapsed = now - battery.anchorTime;
+  if (elapsed >= batteryEstimateWindow && battery.midTime == 0) {
+    battery.midLevel = battery.filtered;
+    battery.midTime = now;
+  }
+  int32_t drop = battery.anchorLevel - battery.filtered;
+  if (!charging && elapsed >= batteryEstimateWindow && drop >= 256) {
+    long minutes = (long)((int64_t)battery.filtered * elapsed / drop / 60000);
+    minutes = (minutes + 5) / 10 * 10; // Round to 10 minutes so the widget stays quiet
+
+    if (minutes != battery.minutesRemaining) {
+      battery.minutesRemaining = minutes;
+      battery.dirty = true;
+    }
+
+    // Slide the window by half so the estimate follows recent usage and never restarts from nothing
+    if (elapsed >= 2 * batteryEstimateWindow) {
+      battery.anchorLevel = battery.midLevel;
+      battery.anchorTime = battery.midTime;
+      battery.midTime = 0;
+    }
+  }
+
+  // Hysteresis keeps the shown level from flickering, more of it upwards while discharging
+  int level = (battery.filtered + 128) >> 8;
+  level = constrain(level, 0, 100);
+  int32_t band = (level > battery.level && !charging) ? 384 : 192;
+  if (level != battery.level && (battery.level < 0 || abs(battery.filtered - (battery.level << 8)) >= band)) {
+    battery.level = level;
+    battery.dirty = true;
+  }
+}
+
+void sampleBattery() {
+  battery.lastSample = millis();
+
+  i2cLock();
+  int32_t raw = M5.Power.getBatteryLevel();
+  bool charging = (M5.Power.isCharging() == m5::Power_Class::is_charging);
+  i2cUnlock();
+
+  batteryAddSample(raw, charging, battery.lastSample);
+}
+
+// Call from loop() after setup() took the first sample, only touches the power IC
+// every batterySampleInterval, also on boards without a fuel gauge
+void updateBattery() {
+  if (millis() - battery.lastSample >= batterySampleInterval) {
+    sampleBattery();
+  }
+}
+
+#endif // BATTERY_H
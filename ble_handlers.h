@@ -7,7 +7,13 @@
 #define BLE_HANDLERS_H
 
 // No camera mode yet
-String mode_str = "Unknown";
+char mode_str[MODE_LABEL_LENGTH] = "Unknown";
+
+// A name set by hand has no signature entry
+void setModeName(const char* name) {
+  snprintf(mode_str, sizeof(mode_str), "%s", name);
+  lastModeEntry = -1;
+}
 
 // BLE variables
 BLEServer* pServer = nullptr;
@@ -17,53 +23,99 @@ BLECharacteristic* pNotifyCharacteristic = nullptr;
 BLEScan* pBLEScan = nullptr;
 BLE2902 *pDescriptor2902;
 bool deviceConnected = false;
+volatile bool setupDone = false;        // Advertising starts early, callbacks leave the screen alone until then
 bool oldDeviceConnected = false;
+esp_bd_addr_t connectedBda;             // Peer address, for connection parameter updates
+uint16_t linkConnId = 0;                // The one link the state above belongs to
+volatile uint32_t responseCount = 0;    // Command answers from the camera, not told apart by command
+volatile uint32_t modeReportCount = 0;  // Mode status frames from the camera
+volatile uint32_t connectCount = 0;     // Connections since boot, for soak runs
+volatile uint32_t disconnectCount = 0;
+unsigned long lastCommandTxMicros = 0;  // When the last command was handed to the stack
+unsigned long notifyHoldoffUntil = 0;   // Background notifications wait until then so commands go first
+bool advertisingActive = false;         // Cleared on connect, the controller stops advertising then
+
+// Unique device name with identifier, built once
+const char* remoteDeviceName() {
+  static char name[32] = "";
+  if (name[0] == '\0') {
+    snprintf(name, sizeof(name), "Insta360 GPS Remote %s", REMOTE_IDENTIFIER);
+  }
+  return name;
+}
 
 // Prefix before unique mode signatures
 const uint8_t MODE_STATUS_PREFIX[] = {
   0xFE, 0xEF, 0xFE, 0x10, 0x80, 0x09, 0x01
 };
 
-// Recognize various modes by Camera responses
-// TODO: Figure out the mode bytes for cameras other than the X5
-const uint8_t MODE_CAMERA[] = {
-  0x20, 0x39, 0x39, 0x39, 0x2B
-};
-
-const uint8_t MODE_VIDEO[] = {
-  0x35, 0x68, 0x33, 0x35, 0x6D
-};
-
-const uint8_t MODE_TIMESHIFT[] = {
-  0x35, 0x68, 0x30, 0x33, 0x6D
+const uint8_t HEARTBEAT[] = {
+  0xFE, 0xEF, 0xFE, 0x02, 0x80, 0x05, 0x01, 0x54 
 };
 
-const uint8_t MODE_LOOP_RECORDING[] = {
-  0x39, 0x68, 0x34, 0x32, 0x6D
+// Camera frames start with this, byte 4 carries the response flag as in the heartbeat and the mode report.
+// The rest of an answer's layout is not known, so nothing in it ties the answer to a command.
+const uint8_t CAMERA_FRAME_PREFIX[] = {
+  0xFE, 0xEF, 0xFE
 };
 
-const uint8_t HEARTBEAT[] = {
-  0xFE, 0xEF, 0xFE, 0x02, 0x80, 0x05, 0x01, 0x54 
-};
+// "aa:bb:cc:dd:ee:ff", the form addresses are saved in
+void formatBda(const uint8_t* bda, char* address, size_t size) {
+  snprintf(address, size, "%02x:%02x:%02x:%02x:%02x:%02x", bda[0], bda[1], bda[2], bda[3], bda[4], bda[5]);
+}
 
 void displayCameraMode(void) {
 
     // If a mode was detected, show it
-    if (mode_str.length() > 0 && !mode_str.startsWith("Unknown")) {
-
-        String mode_line = "Mode: " + mode_str;
+    if (mode_str[0] != '\0' && strncmp(mode_str, "Unknown", 7) != 0) {
 
         M5.Lcd.setTextSize(2);
         M5.Lcd.fillRect(0, 90, 240, 25, BLACK);
         M5.Lcd.setCursor(10, 95);
         M5.Lcd.setTextColor(YELLOW);
-        M5.Lcd.print(mode_line);
+        M5.Lcd.print("Mode: ");
+        M5.Lcd.print(mode_str);
 
         // Reset text size
         M5.Lcd.setTextSize(1);
     }
 }
 
+// Copy the local name out of an advertisement without going through String
+bool advertisedName(BLEAdvertisedDevice &device, char* name, size_t size) {
+  const uint8_t* payload = device.getPayload();
+  size_t length = device.getPayloadLength();
+
+  for (size_t i = 0; i + 1 < length; ) {
+    uint8_t fieldLength = payload[i];
+    uint8_t type = payload[i + 1];
+    if (fieldLength == 0 || i + 1 + fieldLength > length) {
+      break;
+    }
+    if (type == 0x08 || type == 0x09) {     // Shortened or complete local name
+      size_t n = min((size_t)fieldLength - 1, size - 1);
+      memcpy(name, payload + i + 2, n);
+      name[n] = '\0';
+      return true;
+    }
+    i += fieldLength + 1;
+  }
+  return false;
+}
+
+// Pairing scan progress, the scan callback stops the scan once a camera is identified
+struct PairingScan {
+  unsigned long startMs;
+  volatile unsigned long detectedMs;  // After startMs, 0 until identified
+  volatile bool detectedPassive;      // Identified by a passive stage
+  int stage;
+  bool active;                        // Current stage scans actively
+  unsigned long stageStartMs;
+  unsigned long radioOnMs;            // Scan window time over finished stages
+};
+
+PairingScan pairingScan;
+
 // BLE Scan callback to capture camera info during pairing mode
 class MyScanCallbacks: public BLEAdvertisedDeviceCallbacks {
     void onResult(BLEAdvertisedDevice advertisedDevice) {
@@ -71,57 +123,89 @@ class MyScanCallbacks: public BLEAdvertisedDeviceCallbacks {
       if (!pairingMode) 
         return; // Only process during pairing mode
       
-      // Look for Insta360 cameras
-      if (advertisedDevice.haveName()) {
-        String deviceName = advertisedDevice.getName().c_str();
-        String deviceAddress = advertisedDevice.getAddress().toString().c_str();
-        
-        Serial.print("Scan found: ");
-        Serial.print(deviceName);
-        Serial.print(" @ ");
-        Serial.println(deviceAddress);
+      // Look for Insta360 cameras, the name is read straight from the payload
+      char deviceName[sizeof(detectedCameraName)];
+      if (!advertisedName(advertisedDevice, deviceName, sizeof(deviceName))) {
+        if (!advertisedDevice.haveName()) {
+          return;
+        }
+        snprintf(deviceName, sizeof(deviceName), "%s", advertisedDevice.getName().c_str());
+      }
+
+      Serial.print("Scan found: ");
+      Serial.println(deviceName);
         
-        // Check if this is an Insta360 camera
-        if (deviceName.startsWith("X3 ") || 
-            deviceName.startsWith("X4 ") || 
-            deviceName.startsWith("X5 ") ||
-            deviceName.startsWith("RS ") ||
-            deviceName.startsWith("ONE ")) {
+      // Check if this is an Insta360 camera, only then is its address worth formatting
+      if (cameraModelFromName(deviceName) != MODEL_UNKNOWN) {
           
-          // Found an Insta360 camera - save its info
-          detectedCameraName = deviceName;
-          detectedCameraAddress = deviceAddress;
+        // Found an Insta360 camera - save its info
+        const uint8_t* bda = *advertisedDevice.getAddress().getNative();
+        snprintf(detectedCameraAddress, sizeof(detectedCameraAddress), "%02x:%02x:%02x:%02x:%02x:%02x",
+                 bda[0], bda[1], bda[2], bda[3], bda[4], bda[5]);
+        memcpy(detectedCameraName, deviceName, sizeof(detectedCameraName));
           
-          Serial.print("Found Insta360 camera: ");
-          Serial.println(detectedCameraName);
+        Serial.print("Found Insta360 camera: ");
+        Serial.print(detectedCameraName);
+        Serial.print(" @ ");
+        Serial.println(detectedCameraAddress);
+
+        // Identified, no need to keep the radio on
+        if (!pairingScan.detectedMs) {
+          pairingScan.detectedMs = max(millis() - pairingScan.startMs, 1UL);
+          pairingScan.detectedPassive = !pairingScan.active;
+          pBLEScan->stop();
         }
       }
     }
 };
 
+// The scanner is only needed for pairing, so it is created on first use
+void ensureScanner() {
+  if (pBLEScan) {
+    return;
+  }
+
+  pBLEScan = BLEDevice::getScan();
+  pBLEScan->setAdvertisedDeviceCallbacks(new MyScanCallbacks());
+}
+
 class MyServerCallbacks: public BLEServerCallbacks {
 
     void onConnect(BLEServer* pServer, esp_ble_gatts_cb_param_t *param) {
 
+      // One link at a time. A rig camera that connects while another is linked is awake,
+      // which is all a wake needs to know, and is let go again.
+      if (deviceConnected) {
+        char address[18];
+        formatBda(param->connect.remote_bda, address, sizeof(address));
+        markRigCameraConnected(address);
+        advertisingActive = false;
+        Serial.print("Second link from ");
+        Serial.print(address);
+        Serial.println(" dropped, one link at a time");
+        pServer->disconnect(param->connect.conn_id);
+        return;
+      }
+
       deviceConnected = true;
+      linkConnId = param->connect.conn_id;
+      advertisingActive = false;
+      connectCount++;
+      resetLinkHealth();
+      if (!bootConnectedMicros) {
+        bootConnectedMicros = micros();
+      }
       
       // Get the connected device's address
-      char addressStr[18];
-      sprintf(addressStr, "%02x:%02x:%02x:%02x:%02x:%02x",
-              param->connect.remote_bda[0],
-              param->connect.remote_bda[1],
-              param->connect.remote_bda[2],
-              param->connect.remote_bda[3],
-              param->connect.remote_bda[4],
-              param->connect.remote_bda[5]);
-
-      connectedDeviceAddress = String(addressStr);
+      memcpy(connectedBda, param->connect.remote_bda, sizeof(connectedBda));
+      formatBda(param->connect.remote_bda, connectedDeviceAddress, sizeof(connectedDeviceAddress));
       
       Serial.print("Device connected from address: ");
       Serial.println(connectedDeviceAddress);
+      markRigCameraConnected(connectedDeviceAddress);
       
       // Check if we're in pairing mode and have detected a camera
-      if (pairingMode && detectedCameraName.length() > 0) {
+      if (pairingMode && detectedCameraName[0] != '\0') {
 
         // Stop scanning
         if (pBLEScan) {
@@ -135,9 +219,10 @@ class MyServerCallbacks: public BLEServerCallbacks {
         
         // Validate camera name format
         bool validFormat = false;
-        if (detectedCameraName.length() >= 9) { // "X5 " + 6 chars minimum
-          int spaceIndex = detectedCameraName.indexOf(' ');
-          if (spaceIndex > 0 && detectedCameraName.length() - spaceIndex > 6) {
+        size_t nameLength = strlen(detectedCameraName);
+        if (nameLength >= 9) { // "X5 " + 6 chars minimum
+          const char* space = strchr(detectedCameraName, ' ');
+          if (space && space > detectedCameraName && nameLength - (space - detectedCameraName) > 6) {
             validFormat = true;
           }
         }
@@ -154,7 +239,7 @@ class MyServerCallbacks: public BLEServerCallbacks {
           M5.Lcd.setCursor(10, 45);
           M5.Lcd.setTextColor(YELLOW);
           M5.Lcd.println(detectedCameraName);
-          mode_str = "Unknown";
+          setModeName("Unknown");
           delay(400);
           
           saveCurrentCamera(detectedCameraName, detectedCameraAddress);
@@ -176,7 +261,7 @@ class MyServerCallbacks: public BLEServerCallbacks {
           M5.Lcd.setCursor(10, 30);
           M5.Lcd.setTextColor(WHITE);
           M5.Lcd.println("Invalid camera");
-          mode_str = "Unknown";
+          setModeName("Unknown");
           delay(3000);
           
           // Disconnect
@@ -195,7 +280,7 @@ class MyServerCallbacks: public BLEServerCallbacks {
         M5.Lcd.println("Not identified.");
         M5.Lcd.setCursor(10, 40);
         M5.Lcd.println("Please retry.");
-        mode_str = "Unknown";
+        setModeName("Unknown");
         delay(3000);
         
         // Stop pairing mode
@@ -211,34 +296,49 @@ class MyServerCallbacks: public BLEServerCallbacks {
         // Known camera reconnected - just update display, no popup
         Serial.print("Known camera reconnected: ");
         Serial.println(currentCamera.name);
-        mode_str = "Unknown";
-        updateDisplay();
+        setModeName("Unknown");
       } else {
         // Not in pairing mode and no known camera
-        M5.Lcd.fillScreen(BLACK);
-        M5.Lcd.setCursor(10, 20);
-        M5.Lcd.setTextColor(YELLOW);
-        M5.Lcd.println("Unknown camera");
-        M5.Lcd.setCursor(10, 40);
-        M5.Lcd.setTextColor(WHITE);
-        M5.Lcd.println("Use Connect to pair");
-        mode_str = "Unknown";
-        delay(3000);
+        setModeName("Unknown");
+        if (setupDone) {
+          M5.Lcd.fillScreen(BLACK);
+          M5.Lcd.setCursor(10, 20);
+          M5.Lcd.setTextColor(YELLOW);
+          M5.Lcd.println("Unknown camera");
+          M5.Lcd.setCursor(10, 40);
+          M5.Lcd.setTextColor(WHITE);
+          M5.Lcd.println("Use Connect to pair");
+          delay(3000);
+        }
         
         // Disconnect
         pServer->disconnect(pServer->getConnId());
       }
       
-      updateDisplay();
+      // Before setup() is done, its own first draw shows the link
+      if (setupDone) {
+        updateDisplay();
+      }
     }
 
-    void onDisconnect(BLEServer* pServer) {
+    void onDisconnect(BLEServer* pServer, esp_ble_gatts_cb_param_t *param) {
+
+      // A second link dropped in onConnect leaves the camera's link alone
+      if (!deviceConnected || param->disconnect.conn_id != linkConnId) {
+        return;
+      }
+
       deviceConnected = false;
-      connectedDeviceAddress = "";
+      disconnectCount++;
+      connectedDeviceAddress[0] = '\0';
+      resetLinkHealth();
+      wakeLoop();
       
       Serial.println("Camera disconnected");
-      mode_str = "Unknown";
-      updateDisplay();
+      setModeName("Unknown");
+      if (setupDone) {
+        updateDisplay();
+      }
       
       // Return to normal advertising
       setNormalAdvertising();
@@ -249,57 +349,42 @@ class MyCharacteristicCallbacks: public BLECharacteristicCallbacks {
 
     void onWrite(BLECharacteristic* pCharacteristic) {
 
-      String rxValue = pCharacteristic->getValue().c_str();
+      // Read the value in place, no String copy
+      const uint8_t *data = pCharacteristic->getData();
+      size_t length = pCharacteristic->getLength();
       
       bool is_heartbeat = false;
 
-      if (rxValue.length() > 0) {
-
-        const uint8_t *data = (const uint8_t*)rxValue.c_str();
+      if (length > 0) {
 
-        if (rxValue.length() == 8 && memcmp(data, HEARTBEAT, 8) == 0) {
+        if (length == 8 && memcmp(data, HEARTBEAT, 8) == 0) {
           Serial.printf("Heartbeat");
           Serial.println();
           is_heartbeat = true;
+          linkHeartbeatReceived();
         }
-        else if (rxValue.length() == 15 && memcmp(data, MODE_STATUS_PREFIX, 7) == 0) {
+        else if (length == 15 && memcmp(data, MODE_STATUS_PREFIX, 7) == 0) {
 
-          const uint8_t *cmd = data + 10;
-
-          // Camera mode?
-          if (memcmp(cmd, MODE_CAMERA, 5) == 0) {
-            mode_str = "Camera";
-          }
-          else if (memcmp(cmd, MODE_VIDEO, 5) == 0) {
-            // Seems to apply to several video modes (e.g., PureVideo)
-            mode_str = "Video";
-          }
-          else if (memcmp(cmd, MODE_TIMESHIFT, 5) == 0) {
-            // Timeshift
-            mode_str = "Timeshift";
-          }
-          else if (memcmp(cmd, MODE_LOOP_RECORDING, 5) == 0) {
-            // Loop Recording
-            mode_str = "Loop Record";
-          }
-          else {
-            Serial.printf("MODE unhandled returned: ");
-            for (int i = 10; i < rxValue.length(); i++) {
-              Serial.printf("%02X ", (uint8_t)rxValue[i]);
-            }
-            Serial.println();
-            mode_str = "Unhandled";
-          }
+          // Signature bytes follow the prefix and three more header bytes
+          modeNameForSignature(data + 10, mode_str, sizeof(mode_str));
+          modeReportCount++;
+          wakeLoop();
 
           // We may know the mode now, if so, show it
           displayCameraMode();
         }
+        else if (length >= 7 && memcmp(data, CAMERA_FRAME_PREFIX, 3) == 0 && (data[4] & 0x80)) {
+
+          // Answer to a command, which one is not known
+          responseCount++;
+          wakeLoop();
+        }
 
         if (!is_heartbeat)
         {
             Serial.print("RX: ");
-            for (int i = 0; i < rxValue.length(); i++) {
-              Serial.printf("%02X ", (uint8_t)rxValue[i]);
+            for (size_t i = 0; i < length; i++) {
+              Serial.printf("%02X ", data[i]);
             }
             Serial.println();
         }
@@ -307,17 +392,38 @@ class MyCharacteristicCallbacks: public BLECharacteristicCallbacks {
     }
 };
 
-void setWakeAdvertising(uint8_t* wakePayload) {
+// Advertisement payloads, encoded once so switching is a single raw data swap
+struct AdvPayload {
+  uint8_t data[31];
+  uint8_t length;
+  uint8_t wakePayload[6];     // Key for wake entries
+};
 
-  Serial.print("Setting wake advertising with payload: ");
-  for (int i = 0; i < 6; i++) {
-    Serial.printf("%02X ", wakePayload[i]);
-  }
-  Serial.println();
+#define WAKE_ADV_CACHE_SIZE MAX_RIG_CAMERAS
+
+AdvPayload normalAdvPayload;
+AdvPayload wakeAdvPayloads[WAKE_ADV_CACHE_SIZE];
+uint8_t wakeAdvCount = 0;
+uint8_t wakeAdvNext = 0;      // Entry replaced when the cache is full
+volatile unsigned long advSwitchStartUs = 0;  // Raw data handed to the stack, 0 once it is on air
+volatile uint32_t advSwitchUs = 0;            // Last switch until the controller took the payload
+
+void storeAdvPayload(AdvPayload* entry, BLEAdvertisementData &adData) {
+  String payload = adData.getPayload();
+  entry->length = min((size_t)payload.length(), sizeof(entry->data));
+  memcpy(entry->data, payload.c_str(), entry->length);
+}
+
+void buildNormalAdvPayload() {
+  BLEAdvertisementData adData;
   
-  // Stop current advertising
-  BLEDevice::stopAdvertising();
-  delay(100);
+  // Unique device name with identifier
+  adData.setName(remoteDeviceName());
+  adData.setCompleteServices(BLEUUID(GPS_REMOTE_SERVICE_UUID));
+  storeAdvPayload(&normalAdvPayload, adData);
+}
+
+void buildWakeAdvPayload(AdvPayload* entry, const uint8_t* wakePayload) {
   
   // Create manufacturer data for wake-up (iBeacon format)
   uint8_t manufacturerData[26];
@@ -351,32 +457,77 @@ void setWakeAdvertising(uint8_t* wakePayload) {
   manufacturerData[24] = 0xe4;  // TX Power
   manufacturerData[25] = 0x01;  // Additional byte
   
-  BLEAdvertising *pAdvertising = BLEDevice::getAdvertising();
-  pAdvertising->addServiceUUID(GPS_REMOTE_SERVICE_UUID);
+  BLEAdvertisementData adData;
+  adData.setManufacturerData(String((const char*)manufacturerData, sizeof(manufacturerData)));
   
-  // Convert manufacturer data to Arduino String
-  String mfgDataString = "";
-  for (int i = 0; i < 26; i++) {
-    mfgDataString += (char)manufacturerData[i];
+  // Unique device name with identifier
+  adData.setName(remoteDeviceName());
+  storeAdvPayload(entry, adData);
+  memcpy(entry->wakePayload, wakePayload, 6);
+}
+
+// Cached wake payload for a camera, encoded on first use
+AdvPayload* wakeAdvPayloadFor(const uint8_t* wakePayload) {
+  for (int i = 0; i < wakeAdvCount; i++) {
+    if (memcmp(wakeAdvPayloads[i].wakePayload, wakePayload, 6) == 0) {
+      return &wakeAdvPayloads[i];
+    }
   }
-  
-  // Set manufacturer data using BLEAdvertisementData
+
+  AdvPayload* entry;
+  if (wakeAdvCount < WAKE_ADV_CACHE_SIZE) {
+    entry = &wakeAdvPayloads[wakeAdvCount++];
+  } else {
+    entry = &wakeAdvPayloads[wakeAdvNext];
+    wakeAdvNext = (wakeAdvNext + 1) % WAKE_ADV_CACHE_SIZE;
+  }
+  buildWakeAdvPayload(entry, wakePayload);
+  return entry;
+}
+
+// Call from setup() once BLE is up, encodes the payloads ahead of the first switch
+void buildAdvertisingCache() {
+  buildNormalAdvPayload();
+  for (int i = 0; i < rigCameraCount; i++) {
+    wakeAdvPayloadFor(rigCameras[i].wakePayload);
+  }
+
+  // Custom data from here on, start() then leaves the raw payload alone
   BLEAdvertisementData adData;
-  adData.setManufacturerData(mfgDataString);
-  
-  // Create unique device name with identifier
-  String deviceName = "Insta360 GPS Remote " + String(REMOTE_IDENTIFIER);
-  adData.setName(deviceName);
-  
+  adData.setName(remoteDeviceName());
+  BLEAdvertising *pAdvertising = BLEDevice::getAdvertising();
   pAdvertising->setAdvertisementData(adData);
-  
   pAdvertising->setScanResponse(false);
   pAdvertising->setMinPreferred(0x0);
+}
+
+// Swap the advertised data in place, advertising keeps running if it already is and should stay on air
+// linkGapHandler() times it on ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT
+void applyAdvPayload(AdvPayload* entry, bool onAir) {
+  advSwitchStartUs = micros();
+  esp_ble_gap_config_adv_data_raw(entry->data, entry->length);
+  if (onAir && !advertisingActive) {
+    BLEDevice::getAdvertising()->start();
+    advertisingActive = true;
+  } else if (!onAir && advertisingActive) {
+    BLEDevice::getAdvertising()->stop();
+    advertisingActive = false;
+  }
+}
+
+void setWakeAdvertising(uint8_t* wakePayload) {
+
+  Serial.print("Setting wake advertising with payload: ");
+  for (int i = 0; i < 6; i++) {
+    Serial.printf("%02X ", wakePayload[i]);
+  }
+  Serial.println();
+  
+  applyAdvPayload(wakeAdvPayloadFor(wakePayload), true);
   
   wakeMode = true;
   memcpy(currentWakePayload, wakePayload, 6);
   
-  pAdvertising->start();
   Serial.println("Wake advertising started");
 }
 
@@ -384,65 +535,61 @@ void setNormalAdvertising() {
 
   Serial.println("Setting normal advertising");
   
-  // Stop current advertising
-  BLEDevice::stopAdvertising();
-  delay(100);
-  
-  // Create fresh advertising without manufacturer data
-  BLEAdvertising *pAdvertising = BLEDevice::getAdvertising();
-  
-  // Clear any previous advertisement data
-  BLEAdvertisementData adData;
-  
-  // Create unique device name with identifier
-  String deviceName = "Insta360 GPS Remote " + String(REMOTE_IDENTIFIER);
-  adData.setName(deviceName);
-  adData.setCompleteServices(BLEUUID(GPS_REMOTE_SERVICE_UUID));
-  
-  // Set the clean advertisement data (no manufacturer data)
-  pAdvertising->setAdvertisementData(adData);
-  pAdvertising->setScanResponse(false);
-  pAdvertising->setMinPreferred(0x0);
+  // With a camera linked nothing else may connect, so the normal payload waits off air
+  applyAdvPayload(&normalAdvPayload, !deviceConnected);
   
   wakeMode = false;
   memset(currentWakePayload, 0, 6);
   
-  pAdvertising->start();
   Serial.print("Normal advertising started with name: ");
-  Serial.println(deviceName);
+  Serial.println(remoteDeviceName());
 }
 
-void sendCommand(uint8_t* command, size_t length, const char* commandName) {
-
-  if (!deviceConnected || !pServer || pServer->getConnectedCount() == 0) {
-    M5.Lcd.fillScreen(BLACK);
-    M5.Lcd.setCursor(40, 35);
-    M5.Lcd.setTextColor(RED);
-    M5.Lcd.println("Not Connected!");
-    delay(1500);
-    updateDisplay();
-    return;
-  }
-
+// Hand a command to the stack, no UI
+void transmitCommand(uint8_t* command, size_t length, const char* commandName) {
   Serial.print("TX ");
   Serial.print(commandName);
   Serial.print(": ");
-  for (int i = 0; i < length; i++) {
+  for (size_t i = 0; i < length; i++) {
     Serial.printf("%02X ", command[i]);
   }
   Serial.println();
 
   pNotifyCharacteristic->setValue(command, length);
+  unsigned long notifyStart = micros();
   pNotifyCharacteristic->notify();
-  
-  // Brief visual feedback
-  M5.Lcd.fillRect(50, 30, 60, 20, GREEN);
-  M5.Lcd.setCursor(55, 35);
+  lastCommandTxMicros = micros();
+  notifyHoldoffUntil = millis() + gpsCommandHoldoff;
+  recordNotifyLatency(lastCommandTxMicros - notifyStart);
+  noteCommandActivity();
+}
+
+// Small status box over the current screen
+void drawCommandFeedback(const char* text, uint16_t color) {
+  M5.Lcd.setTextSize(1);
+  M5.Lcd.fillRect(45, 30, 70, 20, color);
+  M5.Lcd.setCursor(50, 35);
   M5.Lcd.setTextColor(BLACK);
-  M5.Lcd.print("SENT!");
-  delay(400);
+  M5.Lcd.print(text);
+}
+
+void sendCommand(RemoteAction action, uint8_t* command, size_t length, const char* commandName) {
 
-  updateDisplay();
+  if (!deviceConnected || !pServer || pServer->getConnectedCount() == 0) {
+    M5.Lcd.fillScreen(BLACK);
+    M5.Lcd.setCursor(40, 35);
+    M5.Lcd.setTextColor(RED);
+    M5.Lcd.println("Not Connected!");
+    showOverlay(1500);
+    journalCommand(action, millis(), JOURNAL_NOT_CONNECTED);
+    return;
+  }
+
+  sendTrackedCommand(action, command, length, commandName);
+  
+  // Held until the camera answers or the command times out
+  drawCommandFeedback("SENT...", YELLOW);
+  showOverlay(0);
 }
 
 #endif // BLE_HANDLERS_H
\ No newline at end of file
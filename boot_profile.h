@@ -0,0 +1,57 @@
+/*
+ * boot_profile.h
+ * Boot phase timestamps, reported over serial
+ *
+ * Times are micros(), which counts from the start of the app. The ROM and the
+ * second stage bootloader run before that, typically a few hundred ms that
+ * these figures do not include.
+ */
+
+#ifndef BOOT_PROFILE_H
+#define BOOT_PROFILE_H
+
+#define MAX_BOOT_PHASES 12
+
+struct BootPhase {
+  const char* name;
+  unsigned long micros;       // Since app start
+};
+
+BootPhase bootPhases[MAX_BOOT_PHASES];
+int numBootPhases = 0;
+volatile unsigned long bootConnectedMicros = 0;   // First camera connection
+bool bootConnectedReported = false;
+
+// Record the end of a boot phase
+void bootMark(const char* name) {
+  if (numBootPhases < MAX_BOOT_PHASES) {
+    bootPhases[numBootPhases].name = name;
+    bootPhases[numBootPhases].micros = micros();
+    numBootPhases++;
+  }
+}
+
+void printBootReport() {
+  Serial.println("Boot profile (ms since app start, phase duration):");
+  unsigned long previous = 0;
+  for (int i = 0; i < numBootPhases; i++) {
+    Serial.printf("  %-12s %7.1f %7.1f\n", bootPhases[i].name,
+                  bootPhases[i].micros / 1000.0, (bootPhases[i].micros - previous) / 1000.0);
+    previous = bootPhases[i].micros;
+  }
+  if (bootConnectedMicros) {
+    Serial.printf("  %-12s %7.1f\n", "connected", bootConnectedMicros / 1000.0);
+  }
+}
+
+// Call from loop(), reports app start to first camera connection once
+void checkBootConnected() {
+  if (bootConnectedMicros && !bootConnectedReported) {
+    bootConnectedReported = true;
+    Serial.print("App start to camera connected: ");
+    Serial.print(bootConnectedMicros / 1000);
+    Serial.println("ms");
+  }
+}
+
+#endif // BOOT_PROFILE_H
@@ -20,14 +20,83 @@ Preferences preferences;
 
 // Pairing mode variables
 bool pairingMode = false;
-String detectedCameraName = "";
-String detectedCameraAddress = "";
-String connectedDeviceAddress = "";
+char detectedCameraName[30] = "";
+char detectedCameraAddress[20] = "";
+char connectedDeviceAddress[18] = "";
 
 // Wake-up variables
 bool wakeMode = false;
 uint8_t currentWakePayload[6] = {0};
 
+// Paired cameras woken together, keyed by their wake payload
+struct RigCamera {
+  char name[30];
+  char address[20];
+  uint8_t wakePayload[6];
+};
+
+RigCamera rigCameras[MAX_RIG_CAMERAS];
+uint8_t rigCameraCount = 0;
+volatile uint8_t rigConnectedMask = 0;              // Set from onConnect, cleared when a wake starts
+unsigned long rigConnectedAt[MAX_RIG_CAMERAS];      // ms after the wake started
+unsigned long rigWakeStartMs = 0;
+Preferences rigPreferences;
+
+void saveRigCameras() {
+  rigPreferences.begin("rig", false);
+  rigPreferences.putBytes("cams", rigCameras, rigCameraCount * sizeof(RigCamera));
+  rigPreferences.end();
+}
+
+void registerRigCamera(const char* name, const char* address, const uint8_t* wakePayload) {
+  int entry = 0;
+  while (entry < rigCameraCount && memcmp(rigCameras[entry].wakePayload, wakePayload, 6) != 0) {
+    entry++;
+  }
+
+  if (entry == rigCameraCount) {
+    if (rigCameraCount == MAX_RIG_CAMERAS) {
+      // Full, the oldest camera makes room
+      memmove(&rigCameras[0], &rigCameras[1], (MAX_RIG_CAMERAS - 1) * sizeof(RigCamera));
+      entry = MAX_RIG_CAMERAS - 1;
+    } else {
+      rigCameraCount++;
+    }
+  } else if (strcmp(rigCameras[entry].name, name) == 0 && strcmp(rigCameras[entry].address, address) == 0) {
+    return;
+  }
+
+  snprintf(rigCameras[entry].name, sizeof(rigCameras[entry].name), "%s", name);
+  snprintf(rigCameras[entry].address, sizeof(rigCameras[entry].address), "%s", address);
+  memcpy(rigCameras[entry].wakePayload, wakePayload, 6);
+  saveRigCameras();
+
+  Serial.print("Rig camera ");
+  Serial.print(entry);
+  Serial.print(": ");
+  Serial.println(name);
+}
+
+bool forgetRigCamera(int entry) {
+  if (entry < 0 || entry >= rigCameraCount) {
+    return false;
+  }
+  memmove(&rigCameras[entry], &rigCameras[entry + 1], (rigCameraCount - entry - 1) * sizeof(RigCamera));
+  rigCameraCount--;
+  saveRigCameras();
+  return true;
+}
+
+// Called from onConnect, marks the rig camera with this address as awake
+void markRigCameraConnected(const char* address) {
+  for (int i = 0; i < rigCameraCount; i++) {
+    if (strcasecmp(rigCameras[i].address, address) == 0 && !(rigConnectedMask & (1 << i))) {
+      rigConnectedAt[i] = millis() - rigWakeStartMs;
+      rigConnectedMask |= (1 << i);
+    }
+  }
+}
+
 void loadCurrentCamera() {
   
   Serial.println("Loading camera from preferences...");
@@ -73,26 +142,43 @@ void loadCurrentCamera() {
   }
 }
 
-void saveCurrentCamera(String cameraName, String cameraAddress) {
+// Call after loadCurrentCamera(), a camera saved before the rig existed joins it
+void loadRigCameras() {
+  rigPreferences.begin("rig", true);
+  size_t len = rigPreferences.getBytesLength("cams");
+  if (len > 0 && len <= sizeof(rigCameras) && len % sizeof(RigCamera) == 0) {
+    rigPreferences.getBytes("cams", rigCameras, len);
+    rigCameraCount = len / sizeof(RigCamera);
+  }
+  rigPreferences.end();
+
+  if (currentCamera.isValid) {
+    registerRigCamera(currentCamera.name, currentCamera.address, currentCamera.wakePayload);
+  }
+
+  Serial.print("Rig cameras: ");
+  Serial.println(rigCameraCount);
+}
+
+void saveCurrentCamera(const char* cameraName, const char* cameraAddress) {
   Serial.print("Saving camera: ");
   Serial.print(cameraName);
   Serial.print(" @ ");
   Serial.println(cameraAddress);
   
   // Extract wake payload from camera name (last 6 characters)
-  if (cameraName.length() >= 6) {
-    String nameEnd = cameraName.substring(cameraName.length() - 6);
+  size_t nameLength = strlen(cameraName);
+  if (nameLength >= 6) {
+    const char* nameEnd = cameraName + nameLength - 6;
     Serial.print("Wake payload suffix: ");
     Serial.println(nameEnd);
     
     // Convert to ASCII bytes
-    for (int i = 0; i < 6; i++) {
-      currentCamera.wakePayload[i] = (uint8_t)nameEnd[i];
-    }
+    memcpy(currentCamera.wakePayload, nameEnd, 6);
     
     // Save camera info
-    snprintf(currentCamera.name, 30, "%s", cameraName.c_str());
-    snprintf(currentCamera.address, 20, "%s", cameraAddress.c_str());
+    snprintf(currentCamera.name, 30, "%s", cameraName);
+    snprintf(currentCamera.address, 20, "%s", cameraAddress);
     currentCamera.isValid = true;
     
     // Store in preferences
@@ -101,6 +187,7 @@ void saveCurrentCamera(String cameraName, String cameraAddress) {
     preferences.putString("address", currentCamera.address);
     preferences.putBytes("wake", currentCamera.wakePayload, 6);
     preferences.end();
+    registerRigCamera(currentCamera.name, currentCamera.address, currentCamera.wakePayload);
     
     Serial.print("Wake payload bytes: ");
     for (int i = 0; i < 6; i++) {
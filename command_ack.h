@@ -0,0 +1,161 @@
+/*
+ * command_ack.h
+ * Tracks each command until the camera answers, with bounded retransmit
+ *
+ * The layout of the camera's answer frames is not known, so an answer is not
+ * matched to the command it belongs to: any answer that comes in while a
+ * command is pending resolves it. A late answer to an earlier command can
+ * therefore stand in for a lost one. Only MODE, which waits for a mode
+ * report, is tied to its own answer.
+ */
+
+#ifndef COMMAND_ACK_H
+#define COMMAND_ACK_H
+
+// The command waiting for an answer, only one is in flight at a time
+struct PendingCommand {
+  bool active;
+  RemoteAction action;
+  uint8_t* command;
+  size_t length;
+  const char* name;
+  uint8_t retries;
+  uint32_t responseMark;      // Counters at the first transmit
+  uint32_t modeReportMark;
+  uint32_t disconnectMark;
+  unsigned long txMicros;     // Last transmit
+  unsigned long sentMs;       // First transmit, for the journal
+};
+
+struct CommandAckStats {
+  uint32_t sent;
+  uint32_t answered;          // An answer came in, not necessarily to this command
+  uint32_t retries;
+  uint32_t timeouts;
+  uint32_t ackAvgUs;          // EWMA of transmit to answer
+};
+
+// Time to answer across all commands, bucket n counts answers under 16ms << n
+#define ACK_HISTOGRAM_BUCKETS 8
+uint32_t ackHistogram[ACK_HISTOGRAM_BUCKETS];
+
+PendingCommand pendingCommand;
+bool lastCommandAnswered = false;   // Outcome of the last resolved command
+CommandAckStats commandAckStats[NUM_REMOTE_ACTIONS];
+WheelTimer commandAckTimer;
+
+void commandAckTimeoutExpired(void* arg);
+
+// Marks the counters before the transmit, so an answer that beats notify() returning still counts
+void sendTrackedCommand(RemoteAction action, uint8_t* command, size_t length, const char* name) {
+  if (pendingCommand.active) {
+    Serial.print(pendingCommand.name);
+    Serial.println(" superseded before an answer");
+    journalCommand(pendingCommand.action, pendingCommand.sentMs, JOURNAL_SUPERSEDED);
+  }
+
+  pendingCommand.active = true;
+  pendingCommand.action = action;
+  pendingCommand.command = command;
+  pendingCommand.length = length;
+  pendingCommand.name = name;
+  pendingCommand.retries = 0;
+  pendingCommand.responseMark = responseCount;
+  pendingCommand.modeReportMark = modeReportCount;
+  pendingCommand.disconnectMark = disconnectCount;
+  pendingCommand.sentMs = millis();
+
+  transmitCommand(command, length, name);
+  pendingCommand.txMicros = lastCommandTxMicros;
+
+  commandAckStats[action].sent++;
+  wheelSchedule(&commandAckTimer, commandAckTimeout, commandAckTimeoutExpired);
+}
+
+void commandAckTimeoutExpired(void* arg) {
+  if (!pendingCommand.active) {
+    return;
+  }
+
+  const CommandAckPolicy &policy = commandAckPolicies[pendingCommand.action];
+  CommandAckStats &stats = commandAckStats[pendingCommand.action];
+
+  if (deviceConnected && pendingCommand.retries < policy.maxRetries) {
+    pendingCommand.retries++;
+    stats.retries++;
+    Serial.print("No answer to ");
+    Serial.print(pendingCommand.name);
+    Serial.print(", retry ");
+    Serial.println(pendingCommand.retries);
+
+    transmitCommand(pendingCommand.command, pendingCommand.length, pendingCommand.name);
+    pendingCommand.txMicros = lastCommandTxMicros;
+    drawCommandFeedback("RETRY...", ORANGE);
+    wheelSchedule(&commandAckTimer, commandAckTimeout, commandAckTimeoutExpired);
+    return;
+  }
+
+  pendingCommand.active = false;
+  lastCommandAnswered = false;
+  stats.timeouts++;
+  journalCommand(pendingCommand.action, pendingCommand.sentMs, JOURNAL_NO_REPLY);
+  Serial.print("No answer to ");
+  Serial.println(pendingCommand.name);
+  drawCommandFeedback("NO REPLY", RED);
+  showOverlay(1000);
+}
+
+// Call from loop(), resolves the pending command once the camera answers
+void updateCommandAck() {
+  if (!pendingCommand.active) {
+    return;
+  }
+
+  AckExpect expect = commandAckPolicies[pendingCommand.action].expect;
+  bool response = (responseCount != pendingCommand.responseMark);
+  bool answered;
+  if (expect == ACK_MODE_REPORT) {
+    answered = (modeReportCount != pendingCommand.modeReportMark);
+  } else if (expect == ACK_RESPONSE_OR_DISCONNECT) {
+    answered = response || (disconnectCount != pendingCommand.disconnectMark);
+  } else {
+    answered = response;
+  }
+  if (!answered) {
+    return;
+  }
+
+  CommandAckStats &stats = commandAckStats[pendingCommand.action];
+  uint32_t ackUs = micros() - pendingCommand.txMicros;
+  stats.answered++;
+  stats.ackAvgUs += ((int32_t)ackUs - (int32_t)stats.ackAvgUs) / 8;
+
+  int bucket = 0;
+  while (bucket < ACK_HISTOGRAM_BUCKETS - 1 && ackUs >= (16000UL << bucket)) {
+    bucket++;
+  }
+  ackHistogram[bucket]++;
+
+  pendingCommand.active = false;
+  lastCommandAnswered = true;
+  wheelCancel(&commandAckTimer);
+  journalCommand(pendingCommand.action, pendingCommand.sentMs, JOURNAL_ANSWERED);
+
+  Serial.print(pendingCommand.name);
+  Serial.print(" answered after ");
+  Serial.print(ackUs / 1000);
+  Serial.println("ms");
+  drawCommandFeedback("ANSWERED", GREEN);
+  showOverlay(400);
+}
+
+// Commands that were never answered, across all actions
+uint32_t lostCommandCount() {
+  uint32_t lost = 0;
+  for (int a = 0; a < NUM_REMOTE_ACTIONS; a++) {
+    lost += commandAckStats[a].timeouts;
+  }
+  return lost;
+}
+
+#endif // COMMAND_ACK_H
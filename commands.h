@@ -11,37 +11,151 @@ void executeShutter();
 void executeSleep();
 void executeWake();
 
-void connectNewCamera() {
+// Pairing timers
+WheelTimer pairingTimer;        // Scan start, then scan stages until the timeout
+WheelTimer pairingPollTimer;    // Watches for a detected camera
+char lastDetectedCameraName[30] = "";
+bool scanPassiveUseful = true;  // Passive stages run in this pairing
+uint8_t scanPassiveSkips = 0;   // Pairings left that skip the passive stages, kept in preferences
 
-  // Clear existing camera data
-  Serial.println("Starting new camera pairing process");
-  
-  memset(&currentCamera, 0, sizeof(currentCamera));
-  currentCamera.isValid = false;
-  
-  preferences.begin("camera", false);
-  preferences.clear();
+void saveScanPassiveSkips(uint8_t skips) {
+  if (skips == scanPassiveSkips) {
+    return;
+  }
+  scanPassiveSkips = skips;
+  preferences.begin("scan", false);
+  preferences.putUChar("skips", scanPassiveSkips);
   preferences.end();
-  
-  // Reset detection variables
-  detectedCameraName = "";
-  detectedCameraAddress = "";
-  
+}
+
+// Close the current stage's share of radio time
+void endScanStage() {
+  const ScanStage &stage = pairingScanStages[pairingScan.stage];
+  unsigned long end = millis();
+  if (pairingScan.detectedMs) {
+    // The radio went off when the camera was identified
+    end = min(end, pairingScan.startMs + pairingScan.detectedMs);
+  }
+  unsigned long elapsed = end > pairingScan.stageStartMs ? end - pairingScan.stageStartMs : 0;
+  pairingScan.radioOnMs += elapsed * stage.windowMs / stage.intervalMs;
+  pairingScan.stageStartMs = millis();
+}
+
+void reportPairingScan() {
+  Serial.printf("Pairing scan: detect=%lums radio_on=%lums stage=%d %s\n",
+                pairingScan.detectedMs, pairingScan.radioOnMs, pairingScan.stage,
+                pairingScan.detectedMs ? (pairingScan.detectedPassive ? "passive" : "active") : "not found");
+
+  // A passive find keeps the passive stages, a passive stage that missed the camera is skipped for a while
+  if (pairingScan.detectedMs && pairingScan.detectedPassive) {
+    saveScanPassiveSkips(0);
+  } else if (pairingScan.detectedMs && scanPassiveUseful) {
+    saveScanPassiveSkips(scanPassiveRetryAfter);
+  }
+}
+
+void finishPairingScan() {
+  if (pairingScan.startMs) {
+    endScanStage();
+    reportPairingScan();
+    pairingScan.startMs = 0;
+  }
+}
+
+void stopPairing() {
+  pairingMode = false;
+  wheelCancel(&pairingTimer);
+  wheelCancel(&pairingPollTimer);
+  if (pBLEScan) {
+    pBLEScan->stop();
+  }
+  finishPairingScan();
+}
+
+void pairingPoll(void* arg) {
+  // Pairing finished in onConnect, which already redrew the screen
+  if (!pairingMode) {
+    wheelCancel(&pairingTimer);
+    finishPairingScan();
+    clearOverlay();
+    return;
+  }
+
+  // Update display with detected camera if found
+  if (detectedCameraName[0] != '\0' && strcmp(detectedCameraName, lastDetectedCameraName) != 0) {
+    memcpy(lastDetectedCameraName, detectedCameraName, sizeof(lastDetectedCameraName));
+    M5.Lcd.fillRect(15, 45, 130, 15, BLACK);
+    M5.Lcd.setCursor(35, 45);
+    M5.Lcd.setTextColor(GREEN);
+    M5.Lcd.print("Found!");
+  }
+
+  wheelSchedule(&pairingPollTimer, 100, pairingPoll);
+}
+
+void pairingTimeout(void* arg) {
+  stopPairing();
+
   M5.Lcd.fillScreen(BLACK);
-  // Draw pairing icon
-  drawBitmap(64, 15, pairing_icon, 32, 32, ICON_CYAN);
-  M5.Lcd.setCursor(35, 50);
+  M5.Lcd.setCursor(40, 30);
   M5.Lcd.setTextColor(YELLOW);
-  M5.Lcd.println("PAIRING...");
-  M5.Lcd.setCursor(25, 65);
-  M5.Lcd.setTextColor(CYAN);
-  M5.Lcd.setTextSize(1);
-  M5.Lcd.println("B:Cancel");
-  delay(2000);
-  
+  M5.Lcd.println("Timeout");
+  M5.Lcd.setCursor(35, 45);
+  M5.Lcd.setTextColor(WHITE);
+  M5.Lcd.println("Try again");
+  showOverlay(2000);
+}
+
+// Start the next usable stage, or give up after the last one
+void pairingScanStage(void* arg) {
+  if (pairingScan.startMs) {
+    endScanStage();
+  }
+
+  int next = pairingScan.startMs ? pairingScan.stage + 1 : 0;
+  while (next < NUM_SCAN_STAGES && !pairingScanStages[next].active && !scanPassiveUseful) {
+    next++;
+  }
+  if (next == NUM_SCAN_STAGES) {
+    pairingTimeout(NULL);
+    return;
+  }
+  if (!pairingScan.startMs) {
+    pairingScan.startMs = millis();
+    pairingScan.stageStartMs = pairingScan.startMs;
+  }
+
+  const ScanStage &stage = pairingScanStages[next];
+  pairingScan.stage = next;
+  pairingScan.active = stage.active;
+  wheelSchedule(&pairingTimer, stage.durationMs, pairingScanStage);
+
+  // Once a camera is identified the scan stays off, the stages only run out the timeout
+  if (pairingScan.detectedMs) {
+    return;
+  }
+  Serial.printf("Scan stage %d: %s, %u/%ums\n", next, stage.active ? "active" : "passive",
+                stage.windowMs, stage.intervalMs);
+  pBLEScan->stop();
+  pBLEScan->setActiveScan(stage.active);
+  pBLEScan->setInterval(stage.intervalMs);
+  pBLEScan->setWindow(stage.windowMs);
+  pBLEScan->start(0, nullptr, false);
+}
+
+void startPairingScan(void* arg) {
   // Start scanning for cameras
   pairingMode = true;
+  lastDetectedCameraName[0] = '\0';
   Serial.println("Starting scan for Insta360 cameras");
+
+  preferences.begin("scan", true);
+  scanPassiveSkips = preferences.getUChar("skips", 0);
+  preferences.end();
+  scanPassiveUseful = (scanPassiveSkips == 0);
+  if (!scanPassiveUseful) {
+    saveScanPassiveSkips(scanPassiveSkips - 1);
+  }
   
   M5.Lcd.fillScreen(BLACK);
   // Draw pairing icon again
@@ -53,83 +167,147 @@ void connectNewCamera() {
   M5.Lcd.setTextColor(CYAN);
   M5.Lcd.println("B:Cancel");
   
-  // Start continuous scanning
-  if (pBLEScan) {
-    pBLEScan->start(0, nullptr, false); // Continuous scan
-  }
+  // Scan in stages, aggressive first, until a camera is identified
+  ensureScanner();
+  pairingScan.startMs = 0;
+  pairingScan.detectedMs = 0;
+  pairingScan.radioOnMs = 0;
+  pairingScanStage(NULL);
   
   // Ensure advertising is on
   setNormalAdvertising();
   
   // Wait for camera to be detected and connect
-  unsigned long startTime = millis();
-  while (pairingMode && millis() - startTime < 30000) { // 30 second timeout
-    M5.update();
-    
-    if (M5.BtnB.wasReleased()) {
-      Serial.println("Pairing cancelled by user");
-      pairingMode = false;
-      if (pBLEScan) {
-        pBLEScan->stop();
-      }
-      updateDisplay();
-      return;
-    }
-    
-    // Update display with detected camera if found
-    static String lastDetected = "";
-    if (detectedCameraName.length() > 0 && detectedCameraName != lastDetected) {
-      lastDetected = detectedCameraName;
-      M5.Lcd.fillRect(15, 45, 130, 15, BLACK);
-      M5.Lcd.setCursor(35, 45);
-      M5.Lcd.setTextColor(GREEN);
-      M5.Lcd.print("Found!");
-    }
-    
-    delay(100);
+  wheelSchedule(&pairingPollTimer, 100, pairingPoll);
+}
+
+// Called from loop() when B is pressed while pairing
+void cancelPairing() {
+  Serial.println("Pairing cancelled by user");
+  stopPairing();
+  clearOverlay();
+}
+
+void connectNewCamera() {
+
+  // Clear existing camera data
+  Serial.println("Starting new camera pairing process");
+
+  // One link at a time, the camera being paired needs it
+  if (deviceConnected) {
+    pServer->disconnect(linkConnId);
   }
   
-  // Timeout - stop scanning
-  if (pairingMode) {
-    pairingMode = false;
-    if (pBLEScan) {
-      pBLEScan->stop();
-    }
-    
-    M5.Lcd.fillScreen(BLACK);
-    M5.Lcd.setCursor(40, 30);
-    M5.Lcd.setTextColor(YELLOW);
-    M5.Lcd.println("Timeout");
-    M5.Lcd.setCursor(35, 45);
-    M5.Lcd.setTextColor(WHITE);
-    M5.Lcd.println("Try again");
-    delay(2000);
-  }
+  memset(&currentCamera, 0, sizeof(currentCamera));
+  currentCamera.isValid = false;
   
-  updateDisplay();
+  preferences.begin("camera", false);
+  preferences.clear();
+  preferences.end();
+  
+  // Reset detection variables
+  detectedCameraName[0] = '\0';
+  detectedCameraAddress[0] = '\0';
+  
+  M5.Lcd.fillScreen(BLACK);
+  // Draw pairing icon
+  drawBitmap(64, 15, pairing_icon, 32, 32, ICON_CYAN);
+  M5.Lcd.setCursor(35, 50);
+  M5.Lcd.setTextColor(YELLOW);
+  M5.Lcd.println("PAIRING...");
+  M5.Lcd.setCursor(25, 65);
+  M5.Lcd.setTextColor(CYAN);
+  M5.Lcd.setTextSize(1);
+  M5.Lcd.println("B:Cancel");
+
+  // Hold the pairing screens until pairing ends
+  showOverlay(0);
+  wheelSchedule(&pairingTimer, 2000, startPairingScan);
 }
 
 void executeShutter() {
-  sendCommand(SHUTTER_CMD, sizeof(SHUTTER_CMD), "SHUTTER");
+  sendCommand(ACTION_SHUTTER, SHUTTER_CMD, sizeof(SHUTTER_CMD), "SHUTTER");
 }
 
 void executeSwitchMode() {
-  sendCommand(MODE_CMD, sizeof(MODE_CMD), "MODE");
-  mode_str = "Unknown";
-  updateDisplay();
+  setModeName("Unknown");
+  sendCommand(ACTION_MODE, MODE_CMD, sizeof(MODE_CMD), "MODE");
 }
 
 void executeScreenOff() {
-  sendCommand(TOGGLE_SCREEN_CMD, sizeof(TOGGLE_SCREEN_CMD), "SCREEN");
+  sendCommand(ACTION_SCREEN_OFF, TOGGLE_SCREEN_CMD, sizeof(TOGGLE_SCREEN_CMD), "SCREEN");
 }
 
 void executeSleep() {
-  sendCommand(POWER_OFF_CMD, sizeof(POWER_OFF_CMD), "SLEEP");
+  sendCommand(ACTION_SLEEP, POWER_OFF_CMD, sizeof(POWER_OFF_CMD), "SLEEP");
+}
+
+// Wake fan-out, rotates the wake beacon across the rig in short slices
+// until every camera has connected or each has had wakeDuration of beacon.
+// The ESP32 has a single legacy advertising set, so the beacons take turns.
+WheelTimer wakeTimer;
+uint8_t wakeSlot = 0;                  // Rig entry on air
+unsigned long wakeEndMs = 0;
+long wakeAllConnectedMs = -1;          // Time to all connected for the last wake, -1 if not all
+
+void finishWake(void* arg) {
+  setNormalAdvertising();
+
+  uint8_t connectedMask = rigConnectedMask;
+  int awake = 0;
+  for (int i = 0; i < rigCameraCount; i++) {
+    if (connectedMask & (1 << i)) {
+      awake++;
+    }
+  }
+  Serial.printf("Wake finished: %d/%d cameras connected", awake, rigCameraCount);
+  if (wakeAllConnectedMs >= 0) {
+    Serial.printf(" after %ldms", wakeAllConnectedMs);
+  }
+  Serial.println();
+  
+  M5.Lcd.fillScreen(BLACK);
+  M5.Lcd.setCursor(35, 35);
+  M5.Lcd.setTextColor(GREEN);
+  M5.Lcd.println("Wake sent!");
+  if (rigCameraCount > 1) {
+    M5.Lcd.setCursor(35, 50);
+    M5.Lcd.setTextColor(WHITE);
+    M5.Lcd.printf("%d/%d awake\n", awake, rigCameraCount);
+  }
+  showOverlay(1000);
+}
+
+void wakeSlice(void* arg) {
+  uint8_t allMask = (1 << rigCameraCount) - 1;
+  uint8_t connectedMask = rigConnectedMask;
+
+  if ((connectedMask & allMask) == allMask) {
+    wakeAllConnectedMs = millis() - rigWakeStartMs;
+    finishWake(NULL);
+    return;
+  }
+  if ((long)(millis() - wakeEndMs) >= 0) {
+    finishWake(NULL);
+    return;
+  }
+
+  // Next camera still asleep
+  for (int n = 0; n < rigCameraCount; n++) {
+    wakeSlot = (wakeSlot + 1) % rigCameraCount;
+    if (!(connectedMask & (1 << wakeSlot))) {
+      break;
+    }
+  }
+  if (!wakeMode || !advertisingActive || memcmp(currentWakePayload, rigCameras[wakeSlot].wakePayload, 6) != 0) {
+    setWakeAdvertising(rigCameras[wakeSlot].wakePayload);
+  }
+  wheelSchedule(&wakeTimer, wakeSliceMs, wakeSlice);
 }
 
 void executeWake() {
 
-  if (!currentCamera.isValid) {
+  if (rigCameraCount == 0) {
 
     M5.Lcd.fillScreen(BLACK);
     M5.Lcd.setCursor(25, 30);
@@ -138,9 +316,7 @@ void executeWake() {
     M5.Lcd.setCursor(25, 45);
     M5.Lcd.setTextColor(WHITE);
     M5.Lcd.println("Connect first");
-    delay(2000);
-
-    updateDisplay();
+    showOverlay(2000);
 
     return;
   }
@@ -151,24 +327,58 @@ void executeWake() {
   M5.Lcd.println("Waking...");
   M5.Lcd.setCursor(20, 45);
   M5.Lcd.setTextColor(WHITE);
-  if (strlen(currentCamera.name) > 12) {
+  if (rigCameraCount > 1) {
+    M5.Lcd.printf("%d cameras\n", rigCameraCount);
+  } else if (strlen(rigCameras[0].name) > 12) {
     // Show abbreviated name
-    String shortName = String(currentCamera.name).substring(0, 12);
-    M5.Lcd.println(shortName);
+    M5.Lcd.printf("%.12s\n", rigCameras[0].name);
   } else {
-    M5.Lcd.println(currentCamera.name);
+    M5.Lcd.println(rigCameras[0].name);
   }
   
-  setWakeAdvertising(currentCamera.wakePayload);
-  delay(3000); // Send wake signal for 3 seconds
-  setNormalAdvertising();
-  
-  M5.Lcd.fillScreen(BLACK);
-  M5.Lcd.setCursor(35, 35);
-  M5.Lcd.setTextColor(GREEN);
-  M5.Lcd.println("Wake sent!");
-  delay(1000);
-  updateDisplay();
+  journalCommand(ACTION_WAKE, millis(), JOURNAL_SENT);
+
+  // A camera that is already connected counts as awake
+  rigWakeStartMs = millis();
+  rigConnectedMask = 0;
+  if (deviceConnected) {
+    markRigCameraConnected(connectedDeviceAddress);
+  }
+  wakeAllConnectedMs = -1;
+  wakeEndMs = rigWakeStartMs + wakeDuration * rigCameraCount;
+  wakeSlot = rigCameraCount - 1;
+
+  showOverlay(0);
+  wakeSlice(NULL);
+}
+
+const char* remoteActionName(RemoteAction action) {
+  switch (action) {
+    case ACTION_SHUTTER:    return "Shutter";
+    case ACTION_MODE:       return "Mode";
+    case ACTION_SCREEN_OFF: return "Screen Off";
+    case ACTION_SLEEP:      return "Sleep";
+    case ACTION_WAKE:       return "Wake";
+    case ACTION_MACRO_1:    return "Macro 1";
+    case ACTION_MACRO_2:    return "Macro 2";
+    case ACTION_MACRO_3:    return "Macro 3";
+    case ACTION_MACRO_4:    return "Macro 4";
+  }
+  return "Unknown";
+}
+
+void runRemoteAction(RemoteAction action) {
+  switch (action) {
+    case ACTION_SHUTTER:    executeShutter();    break;
+    case ACTION_MODE:       executeSwitchMode(); break;
+    case ACTION_SCREEN_OFF: executeScreenOff();  break;
+    case ACTION_SLEEP:      executeSleep();      break;
+    case ACTION_WAKE:       executeWake();       break;
+    case ACTION_MACRO_1:
+    case ACTION_MACRO_2:
+    case ACTION_MACRO_3:
+    case ACTION_MACRO_4:    runMacro(action - ACTION_MACRO_1); break;
+  }
 }
 
 #endif // COMMANDS_H
\ No newline at end of file
@@ -11,6 +11,36 @@
 #define SLEEP_PIN G26    // Pin for Sleep function (#5) - triggers on HIGH (to 3.3V)
 #define WAKE_PIN 25     // Pin for Wake function (#6) - triggers on HIGH (to 3.3V)
 
+// Commands that GPIO inputs and the serial API can trigger
+enum RemoteAction {
+  ACTION_SHUTTER,
+  ACTION_MODE,
+  ACTION_SCREEN_OFF,
+  ACTION_SLEEP,
+  ACTION_WAKE,
+  ACTION_MACRO_1,             // Stored macros, see macro.h
+  ACTION_MACRO_2,
+  ACTION_MACRO_3,
+  ACTION_MACRO_4
+};
+const int NUM_REMOTE_ACTIONS = ACTION_WAKE + 1;   // Camera commands, the macros follow
+
+struct GpioInputConfig {
+  uint8_t pin;
+  uint8_t activeLevel;             // LOW or HIGH
+  uint8_t mode;                    // INPUT, INPUT_PULLUP or INPUT_PULLDOWN
+  unsigned long debounceMs;
+  RemoteAction action;
+};
+
+// GPIO input map - add a line here to wire up another trigger (GPIO 0-39), ACTION_MACRO_n runs a macro
+const GpioInputConfig gpioInputs[] = {
+  {SHUTTER_PIN, LOW,  INPUT,          200, ACTION_SHUTTER},  // G0 has hardware pullup
+  {SLEEP_PIN,   HIGH, INPUT_PULLDOWN, 200, ACTION_SLEEP},
+  {WAKE_PIN,    HIGH, INPUT_PULLDOWN, 200, ACTION_WAKE},
+};
+const int NUM_GPIO_INPUTS = sizeof(gpioInputs) / sizeof(gpioInputs[0]);
+
 // GPS Remote service UUIDs
 #define GPS_REMOTE_SERVICE_UUID      "0000ce80-0000-1000-8000-00805f9b34fb"
 #define GPS_REMOTE_WRITE_CHAR_UUID   "0000ce81-0000-1000-8000-00805f9b34fb"
@@ -26,6 +56,47 @@
 #define ICON_CYAN 0x07FF
 #define ICON_WHITE 0xFFFF
 
+// External GNSS module on the Grove port (NMEA or UBX NAV-PVT)
+const bool gpsEnabled = false;                // Set to true when a GNSS module is wired up
+#define GPS_RX_PIN G33
+#define GPS_TX_PIN G32
+const unsigned long gpsBaud = 115200;
+const size_t gpsRxBufferSize = 2048;          // UART driver ring buffer
+const unsigned long gpsCommandHoldoff = 100;  // No fixes sent to the camera this long after a command
+
+// Experimental: stream fixes to the camera. Its GPS frame has not been captured, so the
+// layout sent is a guess (packGpsFrame() in gps.h). Uncomment only to try it on a camera.
+// #define GPS_STREAM_EXPERIMENTAL
+
+// IMU gesture triggers
+enum MotionGesture {
+  GESTURE_DOUBLE_TAP,
+  GESTURE_FLICK,
+  GESTURE_STILL,
+  NUM_GESTURES
+};
+
+struct MotionGestureConfig {
+  bool enabled;
+  RemoteAction action;
+};
+
+const bool motionEnabled = false;                   // Set to true to trigger commands by motion
+const MotionGestureConfig motionGestures[NUM_GESTURES] = {
+  {true,  ACTION_SHUTTER},  // Double tap
+  {true,  ACTION_MODE},     // Flick (quick twist)
+  {false, ACTION_SHUTTER},  // Held still
+};
+const unsigned long motionSampleInterval = 5;       // 200 Hz
+const int motionTapThreshold = 1500;                // mg of high-passed acceleration
+const unsigned long motionDoubleTapMin = 80;        // ms between taps
+const unsigned long motionDoubleTapMax = 400;
+const int motionFlickThreshold = 400;               // dps on any gyro axis
+const unsigned long motionFlickMax = 250;           // Longer twists are not flicks
+const int motionStillThreshold = 60;                // mg of high-passed acceleration
+const int motionStillGyroThreshold = 5;             // dps
+const unsigned long motionStillTime = 2000;         // ms held still before firing
+
 // Remote screens
 #define SCREEN_CONNECT_CAMERA     0
 #define SCREEN_SHUTTER            1
@@ -33,12 +104,134 @@
 #define SCREEN_CAMERA_SCREEN_OFF  3
 #define SCREEN_CAMERA_SLEEP       4
 #define SCREEN_CAMERA_WAKE        5
-#define NUM_SCREENS               6
+#define SCREEN_MACRO              6
+#define NUM_SCREENS               7
+
+// Heap left free when the menu screens are pre-rendered; screens that do not fit draw directly
+const size_t screenCacheHeapReserve = 40000;
+
+// Macros: steps are SHUTTER MODE SCREEN SLEEP WAKE, ACK (the last command was answered),
+// WAIT=<ms> and UNTIL=<mode> (a SIGS entry or label). Stored macros replace these.
+#define NUM_MACROS                4
+#define MACRO_MAX_STEPS           16
+const char* const defaultMacros[NUM_MACROS] = {
+  "MODE ACK SHUTTER ACK SCREEN",
+  "",
+  "",
+  ""
+};
+const int macroScreenSlot = 0;                  // Macro run from the MACRO screen
+const unsigned long macroStepTimeout = 5000;    // ms a step may wait for its condition
+
+// Going to a target mode (GOTO serial verb): MODE presses before giving up
+const int modeSelectMaxSteps = 8;
+
+// Command acknowledgement: what counts as the camera's answer, and how often to resend.
+// Shutter, mode and screen toggle, so a resend after a lost reply makes the camera act twice.
+enum AckExpect {
+  ACK_COMMAND_RESPONSE,       // A camera frame with the response flag, from any command
+  ACK_MODE_REPORT,            // A mode status frame
+  ACK_RESPONSE_OR_DISCONNECT  // A command answer, or the camera dropping the link as it powers off
+};
+
+struct CommandAckPolicy {
+  AckExpect expect;
+  uint8_t maxRetries;
+};
 
-// GPIO debounce settings
-const unsigned long debounceDelay = 200; // 200ms debounce
+const CommandAckPolicy commandAckPolicies[NUM_REMOTE_ACTIONS] = {
+  {ACK_COMMAND_RESPONSE,       0},  // Shutter
+  {ACK_MODE_REPORT,            0},  // Mode
+  {ACK_COMMAND_RESPONSE,       0},  // Screen off
+  {ACK_RESPONSE_OR_DISCONNECT, 2},  // Sleep
+  {ACK_COMMAND_RESPONSE,       0},  // Wake (beacon, not sent over the link)
+};
+const unsigned long commandAckTimeout = 500;  // ms to wait for an answer per attempt
+
+// Pairing scan stages, run in order until a camera is identified (interval and window in ms).
+// Passive stages are skipped for scanPassiveRetryAfter pairings once a camera was only
+// found by an active scan, then tried again.
+struct ScanStage {
+  unsigned long durationMs;
+  uint16_t intervalMs;
+  uint16_t windowMs;
+  bool active;                // Active scans request the scan response, where some names are
+};
+
+const ScanStage pairingScanStages[] = {
+  {3000,  100, 99, false},   // Passive, finds cameras that advertise their name
+  {5000,  100, 99, true},    // Active at full duty
+  {10000, 160, 80, true},    // Back off to half
+  {12000, 320, 80, true},    // Then a quarter
+};
+const int NUM_SCAN_STAGES = sizeof(pairingScanStages) / sizeof(pairingScanStages[0]);
+const uint8_t scanPassiveRetryAfter = 5;
+
+// Wake fan-out: one wake rotates the beacon across every paired camera
+const int MAX_RIG_CAMERAS = 4;
+const unsigned long wakeSliceMs = 250;       // Beacon time per camera before rotating
+const unsigned long wakeDuration = 3000;     // Total beacon time per camera
+
+// GPIO startup settings
 const unsigned long startupDelay = 2000; // 2 seconds delay after startup
 
+// Battery sampler settings
+const unsigned long batterySampleInterval = 5000;     // Read the power IC every 5 seconds
+const unsigned long batteryEstimateWindow = 600000;   // 10 minutes of discharge before estimating runtime
+const int batteryFilterShift = 3;                     // EWMA weight of 1/8 per sample
+
+// BLE connection parameter profiles (interval in 1.25ms units, timeout in 10ms units)
+const uint16_t lowLatencyMinInterval = 6;     // 7.5ms
+const uint16_t lowLatencyMaxInterval = 12;    // 15ms
+const uint16_t lowLatencySlaveLatency = 0;
+const uint16_t lowLatencyTimeout = 400;       // 4s
+const uint16_t lowPowerMinInterval = 80;      // 100ms
+const uint16_t lowPowerMaxInterval = 160;     // 200ms
+const uint16_t lowPowerSlaveLatency = 4;
+const uint16_t lowPowerTimeout = 600;         // 6s
+const unsigned long linkIdleTimeout = 30000;  // Back to low power after 30s without commands
+
+// Memory reporting
+const unsigned long memoryReportInterval = 600000;    // Log heap and stack use every 10 minutes
+
+// Trigger relay: a master forwards GPIO and button A triggers to slave remotes over ESP-NOW.
+// All remotes of a rig use the same channel and group; BLE keeps working alongside.
+enum RelayRole {
+  RELAY_OFF,
+  RELAY_MASTER,
+  RELAY_SLAVE
+};
+
+const RelayRole relayRole = RELAY_OFF;
+const uint8_t relayChannel = 1;
+const char relayGroup[4] = {'R', 'I', 'G', '1'};
+const int relayRepeats = 3;                   // Copies of each trigger, broadcasts are not acknowledged
+const unsigned long relayMaxAge = 100;        // ms, a trigger delayed longer than this is dropped
+
+// Shot journal
+enum JournalStatus {
+  JOURNAL_SENT,                   // Nothing to wait for (wake beacon)
+  JOURNAL_ANSWERED,
+  JOURNAL_NO_REPLY,
+  JOURNAL_NOT_CONNECTED,
+  JOURNAL_SUPERSEDED              // Another command went out before an answer
+};
+
+const int journalFlushBatch = 8;                      // Staged records that trigger a flash write
+const unsigned long journalFlushInterval = 10000;     // Longest a record waits for a flush to be wanted
+const unsigned long journalFlushIdle = 2000;          // ms without commands before a wanted flush is written
+const bool journalUseSpiffs = false;                  // Set to true to take an unused SPIFFS partition when
+                                                      // the partition table has no "journal" one
+const int journalExportMax = 256;                     // Newest records sent by JOURNAL
+
+// Loop profiling
+const uint32_t loopStallThreshold = 20000;            // us, a pass longer than this is logged as a stall
+const unsigned long loopWatchdogInterval = 10;        // ms between watchdog checks of the running pass
+
+// Connection health settings
+const int linkMinHeartbeats = 4;      // Intervals needed before the link is judged
+const int linkMissedHeartbeats = 3;   // Missed heartbeats before a proactive disconnect
+
 // Command payloads for camera control
 static uint8_t SHUTTER_CMD[] = {0xFC, 0xEF, 0xFE, 0x86, 0x00, 0x03, 0x01, 0x02, 0x00};
 static uint8_t MODE_CMD[] = {0xFC, 0xEF, 0xFE, 0x86, 0x00, 0x03, 0x01, 0x01, 0x00};
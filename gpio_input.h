@@ -0,0 +1,104 @@
+/*
+ * gpio_input.h
+ * Table-driven GPIO trigger inputs, scanned from one input register snapshot
+ */
+
+#ifndef GPIO_INPUT_H
+#define GPIO_INPUT_H
+
+// GPIO variables
+bool gpioInputsEnabled = false;               // Set once startupDelay has passed
+WheelTimer gpioStartupTimer;
+WheelTimer gpioDebounceTimers[NUM_GPIO_INPUTS];
+
+// External GPIO delay variable (defined in main sketch)
+extern int gpioDelay;
+
+// Bit masks over GPIO 0-39, built once from the input map
+uint64_t gpioInputMask = 0;     // Pins in the input map
+uint64_t gpioActiveLowMask = 0; // Pins that trigger on LOW
+uint64_t gpioLastActive = 0;    // Active pins at the previous scan
+uint64_t gpioDebounceMask = 0;  // Pins inside their debounce window
+bool gpioUsesHighBank = false;  // Any pin in 32-39
+int8_t gpioPinToInput[40];      // Pin number to input map index
+
+// Read GPIO 0-39 in one or two register accesses
+inline uint64_t readGpioSnapshot() {
+  uint64_t levels = REG_READ(GPIO_IN_REG);
+  if (gpioUsesHighBank) {
+    levels |= (uint64_t)(REG_READ(GPIO_IN1_REG) & 0xFF) << 32;
+  }
+  return levels;
+}
+
+void enableGPIOInputs(void* arg) {
+  gpioInputsEnabled = true;
+  Serial.println("GPIO input now active!");
+}
+
+void endGPIODebounce(void* arg) {
+  int i = (intptr_t)arg;
+  gpioDebounceMask &= ~(1ULL << gpioInputs[i].pin);
+}
+
+void setupGPIOInputs() {
+  memset(gpioPinToInput, -1, sizeof(gpioPinToInput));
+
+  Serial.println("GPIO pins configured:");
+  for (int i = 0; i < NUM_GPIO_INPUTS; i++) {
+    const GpioInputConfig &in = gpioInputs[i];
+    uint64_t bit = 1ULL << in.pin;
+
+    pinMode(in.pin, in.mode);
+    gpioInputMask |= bit;
+    if (in.activeLevel == LOW) {
+      gpioActiveLowMask |= bit;
+    }
+    if (in.pin >= 32) {
+      gpioUsesHighBank = true;
+    }
+    gpioPinToInput[in.pin] = i;
+
+    Serial.printf("G%d (%s) - trigger on %s, %lums debounce\n", in.pin,
+                  remoteActionName(in.action), in.activeLevel == LOW ? "GND" : "3.3V", in.debounceMs);
+  }
+
+  // GPIO input disabled for a while after startup
+  wheelSchedule(&gpioStartupTimer, startupDelay, enableGPIOInputs);
+}
+
+void checkGPIOPins() {
+  if (!gpioInputsEnabled) {
+    return; // GPIO input disabled during startup
+  }
+
+  // Active pins as a bitmask, whatever their polarity
+  uint64_t active = (readGpioSnapshot() ^ gpioActiveLowMask) & gpioInputMask;
+  uint64_t edges = active & ~gpioLastActive & ~gpioDebounceMask;
+  gpioLastActive = active;
+
+  // Only pins with a new edge are visited
+  while (edges) {
+    int pin = __builtin_ctzll(edges);
+    edges &= edges - 1;
+
+    int i = gpioPinToInput[pin];
+    const GpioInputConfig &in = gpioInputs[i];
+    gpioDebounceMask |= 1ULL << pin;
+    wheelSchedule(&gpioDebounceTimers[i], in.debounceMs, endGPIODebounce, (void*)(intptr_t)i);
+
+    // Slave remotes get the trigger first, the local delay only spaces out remotes on one wire
+    relayTrigger(in.action);
+
+    Serial.print("GPIO Pin G");
+    Serial.print(pin);
+    Serial.print(" activated - Delaying ");
+    Serial.print(gpioDelay);
+    Serial.print("ms then executing ");
+    Serial.println(remoteActionName(in.action));
+    delay(gpioDelay);  // Apply unique delay before executing
+    runRemoteAction(in.action);
+  }
+}
+
+#endif // GPIO_INPUT_H
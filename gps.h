@@ -0,0 +1,398 @@
+/*
+ * gps.h
+ * GNSS ingest: streaming NMEA (RMC/GGA) and UBX NAV-PVT parser, with an experimental stream to the camera
+ *
+ * The latest fix is always kept for the GPS serial verb. With
+ * GPS_STREAM_EXPERIMENTAL defined in config.h, loop() also notifies the newest
+ * fix on pNotifyCharacteristic once per pass, after any command and not within
+ * gpsCommandHoldoff of one, so the shutter always goes first. The frame the
+ * camera expects for a GPS fix has not been captured: packGpsFrame() sends a
+ * guessed layout, which is why the stream is off unless asked for.
+ */
+
+#ifndef GPS_H
+#define GPS_H
+
+#define GPS_FIELD_MAX      16
+#define UBX_PAYLOAD_MAX    100
+#define UBX_NAV_PVT_LENGTH 92
+
+// Latest position fix, integers only
+struct GpsFix {
+  int32_t latE7;              // Degrees * 1e7
+  int32_t lonE7;
+  int32_t altCm;              // Above mean sea level
+  uint32_t speedCmS;
+  uint16_t courseCdeg;        // Degrees * 100
+  uint32_t utcMs;             // Time of day
+  uint8_t fixType;            // 0 none, 2 = 2D, 3 = 3D
+  uint8_t sats;
+  unsigned long rxMicros;     // When the last byte of the fix was read
+};
+
+// Pipeline counters, reported with the GPS serial verb
+struct GpsStats {
+  uint32_t bytes;
+  uint32_t sentences;
+  uint32_t checksumErrors;
+  uint32_t fixes;
+  uint32_t parseUs;           // Time spent in the parser
+  uint32_t parseMaxUs;        // Longest single chunk
+  uint32_t sent;              // Fixes notified to the camera
+  uint32_t dropped;           // Fixes replaced by a newer one before they went out
+  uint32_t latencyAvgUs;      // EWMA of read to notify
+  uint32_t latencyMaxUs;
+};
+
+GpsFix gpsFix;
+GpsStats gpsStats;
+bool gpsFixPending = false;   // Newest fix not yet sent to the camera
+
+// NMEA parser state
+enum NmeaState { NMEA_IDLE, NMEA_BODY, NMEA_CHECKSUM_HI, NMEA_CHECKSUM_LO };
+NmeaState nmeaState = NMEA_IDLE;
+uint8_t nmeaChecksum = 0;
+uint8_t nmeaReceivedChecksum = 0;
+int nmeaFieldIndex = 0;
+char nmeaField[GPS_FIELD_MAX];
+int nmeaFieldLength = 0;
+char nmeaType = 0;            // 'R' for RMC, 'G' for GGA, 0 to ignore
+GpsFix nmeaWork;              // Fields of the sentence in progress
+bool nmeaWorkValid = false;
+
+// UBX parser state
+int ubxState = 0;             // 0 idle, 1 got 0xB5, 2 class, 3 id, 4-5 length, 6 payload, 7-8 checksum
+uint8_t ubxClass = 0;
+uint8_t ubxId = 0;
+uint16_t ubxLength = 0;
+uint16_t ubxIndex = 0;
+uint8_t ubxCkA = 0;
+uint8_t ubxCkB = 0;
+uint8_t ubxPayload[UBX_PAYLOAD_MAX];
+
+void setupGps() {
+  if (!gpsEnabled) {
+    return;
+  }
+
+  Serial2.setRxBufferSize(gpsRxBufferSize);
+  Serial2.begin(gpsBaud, SERIAL_8N1, GPS_RX_PIN, GPS_TX_PIN);
+  Serial.print("GPS UART started at ");
+  Serial.print(gpsBaud);
+  Serial.println(" baud");
+}
+
+inline int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+// Parse "123.4567" as a fixed point number with the given decimals
+int64_t parseFixed(const char* s, int decimals) {
+  int64_t value = 0;
+  int fraction = -1;
+  bool negative = (*s == '-');
+  if (negative) {
+    s++;
+  }
+
+  for (; *s; s++) {
+    if (*s == '.') {
+      fraction = 0;
+    } else if (*s >= '0' && *s <= '9') {
+      if (fraction >= decimals) {
+        continue;
+      }
+      value = value * 10 + (*s - '0');
+      if (fraction >= 0) {
+        fraction++;
+      }
+    }
+  }
+
+  for (int i = (fraction < 0 ? 0 : fraction); i < decimals; i++) {
+    value *= 10;
+  }
+  return negative ? -value : value;
+}
+
+// NMEA ddmm.mmmm to degrees * 1e7
+int32_t parseNmeaCoordinate(const char* s) {
+  int64_t raw = parseFixed(s, 7);                  // ddmm.mmmmmmm * 1e7
+  int64_t degrees = raw / 1000000000LL;
+  int64_t minutesE7 = raw - degrees * 1000000000LL;
+  return (int32_t)(degrees * 10000000LL + minutesE7 / 60);
+}
+
+// hhmmss.sss to milliseconds of the day
+uint32_t parseNmeaTime(const char* s) {
+  if (strlen(s) < 6) {
+    return 0;
+  }
+  uint32_t h = (s[0] - '0') * 10 + (s[1] - '0');
+  uint32_t m = (s[2] - '0') * 10 + (s[3] - '0');
+  uint32_t ms = (uint32_t)parseFixed(s + 4, 3);
+  return (h * 3600 + m * 60) * 1000 + ms;
+}
+
+void publishFix(const GpsFix &fix) {
+#ifdef GPS_STREAM_EXPERIMENTAL
+  if (gpsFixPending) {
+    gpsStats.dropped++;
+  }
+  gpsFixPending = true;
+#endif
+  gpsFix = fix;
+  gpsStats.fixes++;
+}
+
+void nmeaFieldDone() {
+  nmeaField[nmeaFieldLength] = '\0';
+
+  if (nmeaFieldIndex == 0) {
+    // Talker is ignored, GPRMC/GNRMC and GPGGA/GNGGA are both handled
+    nmeaType = 0;
+    if (nmeaFieldLength == 5 && strcmp(nmeaField + 2, "RMC") == 0) {
+      nmeaType = 'R';
+    } else if (nmeaFieldLength == 5 && strcmp(nmeaField + 2, "GGA") == 0) {
+      nmeaType = 'G';
+    }
+    nmeaWork = gpsFix;
+    nmeaWorkValid = false;
+  } else if (nmeaType == 'R') {
+    switch (nmeaFieldIndex) {
+      case 1: nmeaWork.utcMs = parseNmeaTime(nmeaField); break;
+      case 2: nmeaWorkValid = (nmeaField[0] == 'A'); break;
+      case 3: nmeaWork.latE7 = parseNmeaCoordinate(nmeaField); break;
+      case 4: if (nmeaField[0] == 'S') nmeaWork.latE7 = -nmeaWork.latE7; break;
+      case 5: nmeaWork.lonE7 = parseNmeaCoordinate(nmeaField); break;
+      case 6: if (nmeaField[0] == 'W') nmeaWork.lonE7 = -nmeaWork.lonE7; break;
+      case 7: nmeaWork.speedCmS = (uint32_t)(parseFixed(nmeaField, 3) * 5144 / 100000); break; // knots
+      case 8: nmeaWork.courseCdeg = (uint16_t)parseFixed(nmeaField, 2); break;
+    }
+  } else if (nmeaType == 'G') {
+    switch (nmeaFieldIndex) {
+      case 6: nmeaWork.fixType = (nmeaField[0] > '0') ? 3 : 0; break;
+      case 7: nmeaWork.sats = (uint8_t)atoi(nmeaField); break;
+      case 9: nmeaWork.altCm = (int32_t)parseFixed(nmeaField, 2); break;
+    }
+  }
+
+  nmeaFieldIndex++;
+  nmeaFieldLength = 0;
+}
+
+void nmeaSentenceDone(unsigned long rxMicros) {
+  gpsStats.sentences++;
+  if (nmeaChecksum != nmeaReceivedChecksum) {
+    gpsStats.checksumErrors++;
+    return;
+  }
+
+  if (nmeaType == 'G') {
+    // Altitude and satellites ride along with the next RMC
+    gpsFix.fixType = nmeaWork.fixType;
+    gpsFix.sats = nmeaWork.sats;
+    gpsFix.altCm = nmeaWork.altCm;
+  } else if (nmeaType == 'R' && nmeaWorkValid) {
+    nmeaWork.rxMicros = rxMicros;
+    if (nmeaWork.fixType == 0) {
+      nmeaWork.fixType = 2;
+    }
+    publishFix(nmeaWork);
+  }
+}
+
+void nmeaByte(char c, unsigned long rxMicros) {
+  if (c == '$') {
+    nmeaState = NMEA_BODY;
+    nmeaChecksum = 0;
+    nmeaFieldIndex = 0;
+    nmeaFieldLength = 0;
+    return;
+  }
+
+  switch (nmeaState) {
+    case NMEA_IDLE:
+      break;
+
+    case NMEA_BODY:
+      if (c == '*') {
+        nmeaFieldDone();
+        nmeaState = NMEA_CHECKSUM_HI;
+      } else if (c == '\r' || c == '\n') {
+        nmeaState = NMEA_IDLE;  // No checksum, not trusted
+      } else {
+        nmeaChecksum ^= (uint8_t)c;
+        if (c == ',') {
+          nmeaFieldDone();
+        } else if (nmeaFieldLength < GPS_FIELD_MAX - 1) {
+          nmeaField[nmeaFieldLength++] = c;
+        }
+      }
+      break;
+
+    case NMEA_CHECKSUM_HI:
+      nmeaReceivedChecksum = hexValue(c) << 4;
+      nmeaState = NMEA_CHECKSUM_LO;
+      break;
+
+    case NMEA_CHECKSUM_LO:
+      nmeaReceivedChecksum |= hexValue(c);
+      nmeaState = NMEA_IDLE;
+      nmeaSentenceDone(rxMicros);
+      break;
+  }
+}
+
+inline int32_t ubxInt32(int offset) {
+  return (int32_t)((uint32_t)ubxPayload[offset] | ((uint32_t)ubxPayload[offset + 1] << 8) |
+                   ((uint32_t)ubxPayload[offset + 2] << 16) | ((uint32_t)ubxPayload[offset + 3] << 24));
+}
+
+void ubxMessageDone(unsigned long rxMicros) {
+  gpsStats.sentences++;
+
+  // NAV-PVT (0x01 0x07)
+  if (ubxClass != 0x01 || ubxId != 0x07 || ubxLength != UBX_NAV_PVT_LENGTH) {
+    return;
+  }
+
+  uint8_t fixType = ubxPayload[20];
+  bool fixOk = ubxPayload[21] & 0x01;
+  if (!fixOk || fixType < 2) {
+    return;
+  }
+
+  GpsFix fix;
+  fix.utcMs = ((uint32_t)ubxPayload[8] * 3600 + ubxPayload[9] * 60 + ubxPayload[10]) * 1000 +
+              (ubxInt32(16) > 0 ? ubxInt32(16) / 1000000 : 0);
+  fix.fixType = fixType > 3 ? 3 : fixType;
+  fix.sats = ubxPayload[23];
+  fix.lonE7 = ubxInt32(24);
+  fix.latE7 = ubxInt32(28);
+  fix.altCm = ubxInt32(36) / 10;                  // mm
+  fix.speedCmS = (uint32_t)ubxInt32(60) / 10;     // mm/s
+  fix.courseCdeg = (uint16_t)(ubxInt32(64) / 1000); // deg * 1e5
+  fix.rxMicros = rxMicros;
+  publishFix(fix);
+}
+
+void ubxByte(uint8_t b, unsigned long rxMicros) {
+  switch (ubxState) {
+    case 0: if (b == 0xB5) ubxState = 1; break;
+    case 1: ubxState = (b == 0x62) ? 2 : 0; break;
+    case 2: ubxClass = b; ubxCkA = b; ubxCkB = b; ubxState = 3; break;
+    case 3: ubxId = b; ubxCkA += b; ubxCkB += ubxCkA; ubxState = 4; break;
+    case 4: ubxLength = b; ubxCkA += b; ubxCkB += ubxCkA; ubxState = 5; break;
+    case 5:
+      ubxLength |= (uint16_t)b << 8;
+      ubxCkA += b;
+      ubxCkB += ubxCkA;
+      ubxIndex = 0;
+      ubxState = (ubxLength == 0) ? 7 : 6;
+      break;
+    case 6:
+      if (ubxIndex < UBX_PAYLOAD_MAX) {
+        ubxPayload[ubxIndex] = b;
+      }
+      ubxIndex++;
+      ubxCkA += b;
+      ubxCkB += ubxCkA;
+      if (ubxIndex >= ubxLength) {
+        ubxState = 7;
+      }
+      break;
+    case 7:
+      ubxState = (b == ubxCkA) ? 8 : 0;
+      if (b != ubxCkA) {
+        gpsStats.checksumErrors++;
+      }
+      break;
+    case 8:
+      ubxState = 0;
+      if (b == ubxCkB) {
+        ubxMessageDone(rxMicros);
+      } else {
+        gpsStats.checksumErrors++;
+      }
+      break;
+  }
+}
+
+// Parse a chunk as read from the UART ring buffer
+void parseGpsBytes(const uint8_t* data, size_t length, unsigned long rxMicros) {
+  for (size_t i = 0; i < length; i++) {
+    uint8_t b = data[i];
+    if (ubxState != 0 || b == 0xB5) {
+      ubxByte(b, rxMicros);
+    } else {
+      nmeaByte((char)b, rxMicros);
+    }
+  }
+  gpsStats.bytes += length;
+}
+
+// Call from loop(): drains the UART into the parser
+void updateGps() {
+  if (!gpsEnabled) {
+    return;
+  }
+
+  uint8_t chunk[256];
+  int available;
+  while ((available = Serial2.available()) > 0) {
+    size_t n = Serial2.readBytes(chunk, available > (int)sizeof(chunk) ? sizeof(chunk) : available);
+    unsigned long start = micros();
+    parseGpsBytes(chunk, n, start);
+    uint32_t parseUs = micros() - start;
+    gpsStats.parseUs += parseUs;
+    if (parseUs > gpsStats.parseMaxUs) {
+      gpsStats.parseMaxUs = parseUs;
+    }
+  }
+}
+
+#ifdef GPS_STREAM_EXPERIMENTAL
+// Guessed layout: command header, then the fix fields little endian. Not checked against a camera.
+size_t packGpsFrame(const GpsFix &fix, uint8_t* frame) {
+  static const uint8_t header[] = {0xFC, 0xEF, 0xFE, 0x86, 0x00, 0x18, 0x02};
+  size_t n = sizeof(header);
+  memcpy(frame, header, n);
+  memcpy(frame + n, &fix.utcMs, 4);      n += 4;
+  memcpy(frame + n, &fix.latE7, 4);      n += 4;
+  memcpy(frame + n, &fix.lonE7, 4);      n += 4;
+  memcpy(frame + n, &fix.altCm, 4);      n += 4;
+  memcpy(frame + n, &fix.speedCmS, 4);   n += 4;
+  memcpy(frame + n, &fix.courseCdeg, 2); n += 2;
+  frame[n++] = fix.fixType;
+  frame[n++] = fix.sats;
+  return n;
+}
+#endif
+
+// Call last in loop(): sends the newest fix once the link is free of commands
+void streamGpsFix() {
+#ifdef GPS_STREAM_EXPERIMENTAL
+  if (!gpsFixPending || !deviceConnected || (long)(millis() - notifyHoldoffUntil) < 0) {
+    return;
+  }
+
+  uint8_t frame[32];
+  size_t length = packGpsFrame(gpsFix, frame);
+  pNotifyCharacteristic->setValue(frame, length);
+  pNotifyCharacteristic->notify();
+  gpsFixPending = false;
+  gpsStats.sent++;
+
+  uint32_t latency = micros() - gpsFix.rxMicros;
+  gpsStats.latencyAvgUs += ((int32_t)latency - (int32_t)gpsStats.latencyAvgUs) / 8;
+  if (latency > gpsStats.latencyMaxUs) {
+    gpsStats.latencyMaxUs = latency;
+  }
+#endif
+}
+
+#endif // GPS_H
@@ -90,4 +90,16 @@ const unsigned char pairing_icon[] = {
 0x7f, 0xfe, 0x00, 0x00, 0x7f, 0xfc, 0x00, 0x00, 0x3f, 0xf8, 0x00, 0x00, 0x0f, 0xf0, 0x00, 0x00
 };
 
+// Icon: List and Play (32x32) - for Macro
+const unsigned char macro_icon[] = {
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x00, 0x3f, 0xff, 0xcc, 0x00, 0x3f, 0xff, 0xce, 0x00, 
+0x3f, 0xff, 0xcf, 0x00, 0x3f, 0xff, 0xcf, 0x80, 0x00, 0x00, 0x0f, 0xc0, 0x00, 0x00, 0x0f, 0xe0, 
+0x00, 0x00, 0x0f, 0xf0, 0x00, 0x00, 0x0f, 0xf8, 0x3f, 0xff, 0xcf, 0xfc, 0x3f, 0xff, 0xcf, 0xff, 
+0x3f, 0xff, 0xcf, 0xff, 0x3f, 0xff, 0xcf, 0xfc, 0x00, 0x00, 0x0f, 0xf8, 0x00, 0x00, 0x0f, 0xf0, 
+0x00, 0x00, 0x0f, 0xe0, 0x00, 0x00, 0x0f, 0xc0, 0x3f, 0xff, 0xcf, 0x80, 0x3f, 0xff, 0xcf, 0x00, 
+0x3f, 0xff, 0xce, 0x00, 0x3f, 0xff, 0xcc, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
 #endif // ICONS_H
\ No newline at end of file
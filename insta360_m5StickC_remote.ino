@@ -38,7 +38,7 @@ Supports "wake" of camera.
 
 Make sure you set REMOTE_IDENTIFIER below. Just select three alphanumeric characters of your choice to prevent interference with multiple remotes.
 
-Make sure you have the other files in the same folder: config.h, icons.h, camera.h, ble_handlers.h, ui.h, and commands.h
+Make sure you have the other files in the same folder: config.h, timer_wheel.h, boot_profile.h, loop_profile.h, icons.h, camera.h, battery.h, mode_db.h, ble_handlers.h, link_health.h, link_profile.h, journal.h, command_ack.h, gps.h, ui.h, commands.h, macro.h, mode_select.h, gpio_input.h, motion.h, memory_stats.h, relay.h, and serial_api.h
 -----------------------------------------------------------------------------
 */
 
@@ -48,6 +48,11 @@ Make sure you have the other files in the same folder: config.h, icons.h, camera
 #include "BLEServer.h"
 #include "BLE2902.h"
 #include "Preferences.h"
+#include "soc/gpio_reg.h"
+#include "esp_partition.h"
+#include <WiFi.h>
+#include "esp_wifi.h"
+#include "esp_now.h"
 
 // *** CONFIGURE YOUR UNIQUE REMOTE IDENTIFIER HERE ***
 // Change this 3-character identifier for each remote to prevent interference
@@ -66,77 +71,109 @@ int calculateGPIODelay() {
 // GPIO delay for this remote (calculated once at startup)
 int gpioDelay = 0;
 
+// Shared I2C bus lock for the IMU task and the power IC, only created when needed
+SemaphoreHandle_t i2cMutex = nullptr;
+
+void i2cLock() {
+  if (i2cMutex) {
+    xSemaphoreTake(i2cMutex, portMAX_DELAY);
+  }
+}
+
+void i2cUnlock() {
+  if (i2cMutex) {
+    xSemaphoreGive(i2cMutex);
+  }
+}
+
 // Include all module headers in correct order
 #include "config.h"
+#include "timer_wheel.h"
+#include "boot_profile.h"
+#include "loop_profile.h"
 #include "icons.h"
 #include "camera.h"
+#include "battery.h"
+#include "mode_db.h"
 
 // Forward declarations for cross-dependencies
 void updateDisplay();
 void drawBitmap(int16_t x, int16_t y, const uint8_t *bitmap, int16_t w, int16_t h, uint16_t color);
 void setNormalAdvertising();
 void setWakeAdvertising(uint8_t* wakePayload);
-void sendCommand(uint8_t* command, size_t length, const char* commandName);
+void sendCommand(RemoteAction action, uint8_t* command, size_t length, const char* commandName);
+void sendTrackedCommand(RemoteAction action, uint8_t* command, size_t length, const char* name);
+void journalCommand(RemoteAction action, unsigned long txMs, JournalStatus status);
 void executeShutter();
 void executeSleep();
 void executeWake();
+void runMacro(int macro);
+void relayTrigger(RemoteAction action);
 void executeSwitchMode();
 void executeScreenOff();
 void connectNewCamera();
 void showNotConnectedMessage();
 void showNoCameraMessage();
 void checkGPIOPins();
+void drawBatteryStatus();
+void showOverlay(unsigned long durationMs);
+void clearOverlay();
+void drawConnectionStatus();
+void linkHeartbeatReceived();
+void resetLinkHealth();
+void noteCommandActivity();
+void recordNotifyLatency(uint32_t us);
+void wakeLoop();
 
 // Now include the implementation headers
 #include "ble_handlers.h"
+#include "link_health.h"
+#include "link_profile.h"
+#include "journal.h"
+#include "command_ack.h"
+#include "gps.h"
 #include "ui.h"
 #include "commands.h"
+#include "macro.h"
+#include "mode_select.h"
+#include "gpio_input.h"
+#include "motion.h"
+#include "memory_stats.h"
+#include "relay.h"
+#include "serial_api.h"
 
 void setup() {
-  M5.begin();
-  M5.Lcd.setRotation(3);
-  M5.Lcd.fillScreen(BLACK);
-  M5.Lcd.setTextSize(1);
-  detectDeviceAndSetScale();
-  
+  bootMark("app start");
+
+  // Big TX buffer so boot logging never stalls on the UART
+  Serial.setTxBufferSize(1024);
   Serial.begin(115200);
+  Serial.onReceive(serialReceived);
   Serial.println("M5StickC Insta360 Camera Remote");
   Serial.print("Remote ID: ");
   Serial.println(REMOTE_IDENTIFIER);
-  
-  // Calculate unique GPIO delay for this remote
-  gpioDelay = calculateGPIODelay();
-  Serial.print("GPIO delay for this remote: ");
-  Serial.print(gpioDelay);
-  Serial.println("ms");
-  
-  // Record startup time for GPIO delay
-  startupTime = millis();
-  
-  // Setup GPIO pins - G0 uses hardware pullup, others use pulldown
-  pinMode(SHUTTER_PIN, INPUT);           // G0 has hardware pullup - trigger on LOW (to GND)
-  pinMode(SLEEP_PIN, INPUT_PULLDOWN);    // G26 for Sleep (#5) - trigger on HIGH (to 3.3V)
-  pinMode(WAKE_PIN, INPUT_PULLDOWN);     // G25 for Wake (#6) - trigger on HIGH (to 3.3V)
-  
-  Serial.println("GPIO pins configured:");
-  Serial.println("G0 (Shutter) - INPUT (hardware pullup, trigger on GND)");
-  Serial.println("G26 (Sleep) - INPUT_PULLDOWN (trigger on 3.3V)");
-  Serial.println("G25 (Wake) - INPUT_PULLDOWN (trigger on 3.3V)");
-  Serial.println("GPIO input disabled for 2 seconds after startup...");
-  
-  // Load saved camera
+
+  // Serial is already running, keep M5.begin() from restarting it
+  auto cfg = M5.config();
+  cfg.serial_baudrate = 0;
+  M5.begin(cfg);
+  M5.Lcd.setRotation(3);
+  detectDeviceAndSetScale();
+  bootMark("M5.begin");
+
+  // Load saved camera and the mode signatures learned so far
   loadCurrentCamera();
+  loadRigCameras();
+  loadModeSignatures();
+  loadModeCycle();
+  loadMacros();
+  bootMark("nvs");
   
-  // Initialize BLE
-  String deviceName = "Insta360 GPS Remote " + String(REMOTE_IDENTIFIER);
-  BLEDevice::init(deviceName.c_str());
-
-  // Create BLE Scanner for camera detection
-  pBLEScan = BLEDevice::getScan();
-  pBLEScan->setAdvertisedDeviceCallbacks(new MyScanCallbacks());
-  pBLEScan->setActiveScan(true); // Active scan uses more power but gets names
-  pBLEScan->setInterval(100);
-  pBLEScan->setWindow(99);
+  // Initialize BLE first so the saved camera can reconnect as early as possible.
+  // The scanner is only needed for pairing and is created then.
+  BLEDevice::init(remoteDeviceName());
+  BLEDevice::setCustomGapHandler(linkGapHandler);
+  bootMark("ble init");
 
   // Create the BLE Server
   pServer = BLEDevice::createServer();
@@ -163,42 +200,67 @@ void setup() {
 
   // Start the service
   pService->start();
+  bootMark("gatt");
 
-  // Start with normal advertising
+  // Encode the advertisement payloads, then start with normal advertising
+  buildAdvertisingCache();
   setNormalAdvertising();
+  bootMark("advertising");
   
+  // Calculate unique GPIO delay for this remote
+  gpioDelay = calculateGPIODelay();
+  Serial.print("GPIO delay for this remote: ");
+  Serial.print(gpioDelay);
+  Serial.println("ms");
+  
+  // Setup GPIO pins from the input map in config.h
+  setupGPIOInputs();
+  Serial.println("GPIO input disabled for 2 seconds after startup...");
+  
+  // Start the GNSS UART and the motion engine, if enabled
+  setupGps();
+  setupMotion();
+  sampleBattery();
+  bootMark("peripherals");
+
+  // Find the end of the shot journal
+  setupJournal();
+  bootMark("journal");
+
+  // Join the trigger relay, if this remote is part of one
+  setupRelay();
+  
+  // Pre-render the menu screens into whatever heap is left
+  buildScreenCache();
+
   Serial.println("Ready!");
+  M5.Lcd.setTextSize(1);
+  setupDone = true;
   updateDisplay();
-}
+  bootMark("display");
 
-void loop() {
+  printBootReport();
+  setupMemoryReport();
+  setupLoopProfile();
+  printMemoryReport();
+}
 
-  M5.update();
+// Restarts advertising a while after the camera drops
+WheelTimer reconnectTimer;
 
-  bool connected = deviceConnected && pServer && (pServer->getConnectedCount() > 0);
-  
-  // Check GPIO pins for external button presses
-  checkGPIOPins();
-  
-  // Handle connection changes
-  if (!connected && oldDeviceConnected) {
-    delay(500);
-    if (!wakeMode && !pairingMode) {
-      pServer->startAdvertising();
-    }
-    oldDeviceConnected = false;
-  }
-  
-  if (connected && !oldDeviceConnected) {
-    oldDeviceConnected = true;
+void restartAdvertising(void* arg) {
+  if (!deviceConnected && !wakeMode && !pairingMode) {
+    pServer->startAdvertising();
   }
+}
+
+void handleButtons() {
 
   // Button B - Navigate to next screen
   if (M5.BtnB.wasReleased()) {
-    currentScreen = (currentScreen + 1) % NUM_SCREENS;
+    showNextScreen();
     Serial.print("Switched to screen: ");
     Serial.println(currentScreen);
-    updateDisplay();
   }
 
   // Button A - Execute current screen's function
@@ -215,6 +277,7 @@ void loop() {
         if (!deviceConnected) {
           showNotConnectedMessage();
         } else {
+          relayTrigger(ACTION_SHUTTER);
           executeShutter();
         }
         break;
@@ -223,6 +286,7 @@ void loop() {
         if (!deviceConnected) {
           showNotConnectedMessage();
         } else {
+          relayTrigger(ACTION_MODE);
           executeSwitchMode();
         }
         break;
@@ -231,6 +295,7 @@ void loop() {
         if (!deviceConnected) {
           showNotConnectedMessage();
         } else {
+          relayTrigger(ACTION_SCREEN_OFF);
           executeScreenOff();
         }
         break;
@@ -239,25 +304,128 @@ void loop() {
         if (!deviceConnected) {
           showNotConnectedMessage();
         } else {
+          relayTrigger(ACTION_SLEEP);
           executeSleep();
         }
         break;
         
       case SCREEN_CAMERA_WAKE: // Wake
-        if (!currentCamera.isValid) {
+        if (rigCameraCount == 0) {
           showNoCameraMessage();
         } else {
+          relayTrigger(ACTION_WAKE);
           executeWake();
         }
         break;
 
+      case SCREEN_MACRO: // Macro
+        relayTrigger((RemoteAction)(ACTION_MACRO_1 + macroScreenSlot));
+        runMacro(macroScreenSlot);
+        break;
+
       default:
         Serial.println("Error: Wrong screen mode");
         break;
     }
-    
-    delay(200);
+  }
+}
+
+void loop() {
+
+  loopBegin();
+
+  i2cLock();
+  M5.update();
+  i2cUnlock();
+  loopMark(LOOP_PHASE_INPUT);
+
+  // Run due timeouts, debounce windows and overlay expiries
+  runTimerWheel();
+  loopMark(LOOP_PHASE_TIMERS);
+
+  bool connected = deviceConnected && pServer && (pServer->getConnectedCount() > 0);
+  
+  // Check GPIO pins for external button presses
+  checkGPIOPins();
+
+  // Run commands from a host on USB serial
+  pollSerialCommands();
+
+  // Read fixes from the GNSS module, if one is fitted
+  updateGps();
+
+  // Run commands for detected gestures
+  pollMotionEvents();
+
+  // Run triggers forwarded by a master remote
+  pollRelayMessages();
+  loopMark(LOOP_PHASE_IO);
+
+  // Persist mode signatures and cycle steps learned since the last pass
+  saveModeSignatures();
+  saveModeCycle();
+
+  // Report app start to reconnect time once
+  checkBootConnected();
+
+  // Sample the battery at a low rate
+  updateBattery();
+  
+  // Grade the link from camera heartbeats, drop it if they stop
+  updateLinkHealth();
+  loopMark(LOOP_PHASE_STATE);
+
+  // Redraw status only when the shown value changes
+  if (battery.dirty && !overlayActive) {
+    drawBatteryStatus();
+  }
+  if (linkHealth.dirty && !overlayActive) {
+    drawConnectionStatus();
+  }
+  loopMark(LOOP_PHASE_RENDER);
+  
+  // Handle connection changes
+  if (!connected && oldDeviceConnected) {
+    // A link we dropped ourselves is already known dead, re-advertise at once
+    wheelSchedule(&reconnectTimer, linkHealth.dropRequested ? 0 : 500, restartAdvertising);
+    linkHealth.dropRequested = false;
+    oldDeviceConnected = false;
+    linkProfileDisconnected();
   }
   
-  delay(50);
+  if (connected && !oldDeviceConnected) {
+    oldDeviceConnected = true;
+    linkProfileConnected();
+  }
+
+  // Log connection parameter changes
+  updateLinkProfile();
+
+  // Resolve the pending command once the camera answers
+  updateCommandAck();
+
+  // Advance a running macro or mode selection
+  updateMacro();
+  updateModeSelect();
+
+  // Write the shot journal between commands
+  updateJournal(pendingCommand.active || runningMacro >= 0 || modeSelect.active);
+  loopMark(LOOP_PHASE_LINK);
+
+  // Button B cancels pairing, buttons are ignored while a message covers the screen
+  if (pairingMode && M5.BtnB.wasReleased()) {
+    cancelPairing();
+  } else if (!overlayActive) {
+    handleButtons();
+  }
+
+  // Send the newest GPS fix last, after any command this pass
+  streamGpsFix();
+  loopMark(LOOP_PHASE_BUTTONS);
+
+  loopEnd();
+
+  // Same 50ms pace as a delay, but a relayed trigger, a serial command or a camera answer wakes the loop at once,
+  // and a macro WAIT step ends on time
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(macroSleepMs(50)));
 }
@@ -0,0 +1,248 @@
+/*
+ * journal.h
+ * Append-only command journal in a flash partition, staged in RAM and written in batches
+ *
+ * Records go to the data partition labelled "journal" (see partitions.csv),
+ * or to an SPIFFS partition only if journalUseSpiffs is set. They are written
+ * between commands, once the link has been idle for journalFlushIdle.
+ *
+ * Records are 16 bytes and fill the partition as a ring, one 4KB sector at a
+ * time. A sector is erased just before the first record goes into it, so every
+ * sector takes the same share of erases. At boot the newest record is found from
+ * the first record of each sector plus one sector scan; a record torn by a power
+ * cut fails its CRC and is skipped.
+ */
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#define JOURNAL_SECTOR_SIZE 4096
+#define JOURNAL_STAGE_SIZE 16
+
+const char* const journalStatusNames[] = {"sent", "answered", "no_reply", "not_connected", "superseded"};
+
+struct JournalRecord {
+  uint32_t seq;               // 0xFFFFFFFF in erased flash
+  uint32_t timeMs;            // millis() at transmit
+  uint16_t session;           // Boots since the journal was created
+  uint8_t action;
+  uint8_t status;
+  int8_t rssi;
+  uint8_t camera;             // Rig entry, 0xFF if not in the rig
+  uint8_t reserved;
+  uint8_t crc;
+};
+
+struct JournalStats {
+  uint32_t records;           // Staged this session
+  uint32_t dropped;           // Staging full
+  uint32_t flushes;
+  uint32_t bytesWritten;
+  uint32_t erases;
+  uint32_t torn;              // Bad records found at boot
+};
+
+const esp_partition_t* journalPartition = nullptr;
+uint32_t journalSlots = 0;        // Records the partition holds
+uint32_t journalWriteSlot = 0;    // Next slot to write
+uint32_t journalNextSeq = 1;
+uint16_t journalSession = 0;
+
+JournalRecord journalStaged[JOURNAL_STAGE_SIZE];
+int journalStagedCount = 0;
+JournalStats journalStats;
+WheelTimer journalFlushTimer;
+bool journalFlushWanted = false;  // Batch full or held long enough, written once the link is idle
+unsigned long journalLastCommandMs = 0;
+
+const uint32_t JOURNAL_SLOTS_PER_SECTOR = JOURNAL_SECTOR_SIZE / sizeof(JournalRecord);
+
+uint8_t journalCrc(const JournalRecord &record) {
+  const uint8_t* bytes = (const uint8_t*)&record;
+  uint8_t crc = 0;
+  for (size_t i = 0; i < sizeof(record) - 1; i++) {
+    crc ^= bytes[i];
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+bool readJournalSlot(uint32_t slot, JournalRecord &record) {
+  esp_partition_read(journalPartition, slot * sizeof(JournalRecord), &record, sizeof(record));
+  return record.seq != 0xFFFFFFFF && record.crc == journalCrc(record);
+}
+
+bool journalSlotErased(const JournalRecord &record) {
+  const uint8_t* bytes = (const uint8_t*)&record;
+  for (size_t i = 0; i < sizeof(record); i++) {
+    if (bytes[i] != 0xFF) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Write staged records, erasing each sector as the ring enters it
+void flushJournal() {
+  wheelCancel(&journalFlushTimer);
+  journalFlushWanted = false;
+  if (!journalPartition || journalStagedCount == 0) {
+    return;
+  }
+
+  int written = 0;
+  while (written < journalStagedCount) {
+    if (journalWriteSlot % JOURNAL_SLOTS_PER_SECTOR == 0) {
+      esp_partition_erase_range(journalPartition, journalWriteSlot * sizeof(JournalRecord), JOURNAL_SECTOR_SIZE);
+      journalStats.erases++;
+    }
+
+    // Contiguous run up to the end of this sector
+    uint32_t room = JOURNAL_SLOTS_PER_SECTOR - journalWriteSlot % JOURNAL_SLOTS_PER_SECTOR;
+    uint32_t count = min((uint32_t)(journalStagedCount - written), room);
+    size_t bytes = count * sizeof(JournalRecord);
+    esp_partition_write(journalPartition, journalWriteSlot * sizeof(JournalRecord), &journalStaged[written], bytes);
+    journalStats.bytesWritten += bytes;
+
+    written += count;
+    journalWriteSlot = (journalWriteSlot + count) % journalSlots;
+  }
+
+  journalStagedCount = 0;
+  journalStats.flushes++;
+}
+
+void journalFlushDue(void* arg) {
+  journalFlushWanted = true;
+}
+
+// Stage one record, written with the next batch once the link is idle
+void journalCommand(RemoteAction action, unsigned long txMs, JournalStatus status) {
+  if (!journalPartition) {
+    return;
+  }
+  if (journalStagedCount == JOURNAL_STAGE_SIZE) {
+    journalStats.dropped++;
+    return;
+  }
+
+  JournalRecord &record = journalStaged[journalStagedCount++];
+  memset(&record, 0, sizeof(record));
+  record.seq = journalNextSeq++;
+  record.timeMs = txMs;
+  record.session = journalSession;
+  record.action = action;
+  record.status = status;
+  record.rssi = deviceConnected ? linkParams.rssi : 0;
+  record.camera = 0xFF;
+  for (int i = 0; i < rigCameraCount; i++) {
+    if (currentCamera.isValid && memcmp(rigCameras[i].wakePayload, currentCamera.wakePayload, 6) == 0) {
+      record.camera = i;
+    }
+  }
+  record.crc = journalCrc(record);
+  journalStats.records++;
+  journalLastCommandMs = millis();
+
+  if (journalStagedCount >= journalFlushBatch) {
+    wheelCancel(&journalFlushTimer);
+    journalFlushWanted = true;
+  } else if (!wheelPending(&journalFlushTimer)) {
+    wheelSchedule(&journalFlushTimer, journalFlushInterval, journalFlushDue);
+  }
+}
+
+// Call from loop(), linkBusy while a command, macro or mode selection is under way.
+// A full staging area is written at the first gap between commands, before records are dropped.
+void updateJournal(bool linkBusy) {
+  if (!journalFlushWanted || linkBusy) {
+    return;
+  }
+  if (millis() - journalLastCommandMs >= journalFlushIdle || journalStagedCount == JOURNAL_STAGE_SIZE) {
+    flushJournal();
+  }
+}
+
+// Oldest slot of the newest maxRecords records, walking back from the write slot
+uint32_t journalExportStart(int maxRecords) {
+  uint32_t slot = journalWriteSlot;
+  uint32_t newerSeq = journalNextSeq;
+  JournalRecord record;
+
+  for (uint32_t steps = 0; steps < journalSlots && maxRecords > 0; steps++) {
+    uint32_t previous = (slot + journalSlots - 1) % journalSlots;
+    if (readJournalSlot(previous, record)) {
+      if (record.seq >= newerSeq) {
+        break;                  // Wrapped into newer records
+      }
+      newerSeq = record.seq;
+      maxRecords--;
+    } else if (journalSlotErased(record)) {
+      break;
+    }
+    slot = previous;
+  }
+  return slot;
+}
+
+// Call from setup(), finds the newest record and carries on after it
+void setupJournal() {
+  journalPartition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "journal");
+  if (!journalPartition && journalUseSpiffs) {
+    // The default partition scheme has an SPIFFS partition, only taken when asked for
+    journalPartition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, NULL);
+  }
+  if (!journalPartition || journalPartition->size < 2 * JOURNAL_SECTOR_SIZE) {
+    journalPartition = nullptr;
+    Serial.println("Journal: no \"journal\" partition, shots are not recorded");
+    return;
+  }
+  journalSlots = (journalPartition->size / JOURNAL_SECTOR_SIZE) * JOURNAL_SLOTS_PER_SECTOR;
+
+  // Newest sector by its first record
+  JournalRecord record;
+  uint32_t newestSeq = 0;
+  uint32_t newestSector = 0;
+  bool any = false;
+  for (uint32_t sector = 0; sector < journalSlots / JOURNAL_SLOTS_PER_SECTOR; sector++) {
+    if (readJournalSlot(sector * JOURNAL_SLOTS_PER_SECTOR, record) && (!any || record.seq > newestSeq)) {
+      newestSeq = record.seq;
+      newestSector = sector;
+      journalSession = record.session;
+      any = true;
+    }
+  }
+
+  if (!any) {
+    journalWriteSlot = 0;
+  } else {
+    // Walk the newest sector to its end, skipping torn records
+    uint32_t first = newestSector * JOURNAL_SLOTS_PER_SECTOR;
+    journalWriteSlot = first + JOURNAL_SLOTS_PER_SECTOR;
+    for (uint32_t slot = first; slot < first + JOURNAL_SLOTS_PER_SECTOR; slot++) {
+      if (readJournalSlot(slot, record)) {
+        if (record.seq > newestSeq) {
+          newestSeq = record.seq;
+          journalSession = record.session;
+        }
+        continue;
+      }
+      if (journalSlotErased(record)) {
+        journalWriteSlot = slot;
+        break;
+      }
+      journalStats.torn++;
+    }
+    journalWriteSlot %= journalSlots;
+    journalNextSeq = newestSeq + 1;
+    journalSession++;
+  }
+
+  Serial.printf("Journal: %s %luKB, session %u, next record %lu at slot %lu, %lu torn\n",
+                journalPartition->label, (unsigned long)(journalPartition->size / 1024), journalSession,
+                (unsigned long)journalNextSeq, (unsigned long)journalWriteSlot, (unsigned long)journalStats.torn);
+}
+
+#endif // JOURNAL_H
@@ -0,0 +1,108 @@
+/*
+ * link_health.h
+ * Connection health monitor built on camera heartbeats
+ */
+
+#ifndef LINK_HEALTH_H
+#define LINK_HEALTH_H
+
+// Link quality levels shown by the status indicator
+#define LINK_QUALITY_UNKNOWN  -1
+#define LINK_QUALITY_LOST      0
+#define LINK_QUALITY_POOR      1
+#define LINK_QUALITY_FAIR      2
+#define LINK_QUALITY_GOOD      3
+
+// Heartbeat inter-arrival statistics, same scaling as TCP RTT estimation
+struct LinkHealth {
+  volatile unsigned long lastHeartbeat;
+  volatile long meanX8;         // EWMA of the interval in ms, scaled by 8
+  volatile long devX4;          // EWMA of the mean deviation in ms, scaled by 4
+  volatile int samples;
+  int quality;
+  bool dirty;                   // Status indicator needs a redraw
+  bool dropRequested;           // We disconnected on purpose, re-advertise at once
+};
+
+LinkHealth linkHealth = {0, 0, 0, 0, LINK_QUALITY_UNKNOWN, false, false};
+
+void resetLinkHealth() {
+  linkHealth.lastHeartbeat = 0;
+  linkHealth.meanX8 = 0;
+  linkHealth.devX4 = 0;
+  linkHealth.samples = 0;
+  linkHealth.quality = LINK_QUALITY_UNKNOWN;
+  linkHealth.dirty = true;
+}
+
+// Called from onWrite on the BLE task for every HEARTBEAT frame
+void linkHeartbeatReceived() {
+  unsigned long now = millis();
+
+  if (linkHealth.lastHeartbeat != 0) {
+    long sample = (long)(now - linkHealth.lastHeartbeat);
+
+    if (linkHealth.samples == 0) {
+      linkHealth.meanX8 = sample << 3;
+      linkHealth.devX4 = sample << 1;
+    } else {
+      long err = sample - (linkHealth.meanX8 >> 3);
+      linkHealth.meanX8 += err;              // gain 1/8
+      if (err < 0) {
+        err = -err;
+      }
+      linkHealth.devX4 += err - (linkHealth.devX4 >> 2); // gain 1/4
+    }
+    linkHealth.samples++;
+  }
+
+  linkHealth.lastHeartbeat = now;
+}
+
+// Call from loop(), grades the link and drops it when heartbeats stop
+void updateLinkHealth() {
+  if (!deviceConnected || pairingMode) {
+    return;
+  }
+
+  int quality = LINK_QUALITY_UNKNOWN;
+
+  if (linkHealth.samples >= linkMinHeartbeats) {
+    long mean = linkHealth.meanX8 >> 3;
+    long dev = linkHealth.devX4 >> 2;
+    long elapsed = (long)(millis() - linkHealth.lastHeartbeat);
+    long deadline = mean + 4 * dev;
+
+    if (mean < 1) {
+      mean = 1;
+    }
+
+    if (elapsed <= deadline) {
+      quality = (4 * dev < mean) ? LINK_QUALITY_GOOD : LINK_QUALITY_FAIR;
+    } else if (elapsed < mean * linkMissedHeartbeats + 4 * dev) {
+      quality = LINK_QUALITY_POOR;
+    } else {
+      quality = LINK_QUALITY_LOST;
+    }
+
+    if (quality == LINK_QUALITY_LOST && !linkHealth.dropRequested) {
+      Serial.print("Heartbeats missed for ");
+      Serial.print(elapsed);
+      Serial.print("ms (mean ");
+      Serial.print(mean);
+      Serial.print("ms, dev ");
+      Serial.print(dev);
+      Serial.println("ms) - dropping link");
+
+      linkHealth.dropRequested = true;
+      pServer->disconnect(pServer->getConnId());
+    }
+  }
+
+  if (quality != linkHealth.quality) {
+    linkHealth.quality = quality;
+    linkHealth.dirty = true;
+  }
+}
+
+#endif // LINK_HEALTH_H
@@ -0,0 +1,118 @@
+/*
+ * link_profile.h
+ * Low-latency and low-power BLE connection parameter profiles, switched by command activity
+ */
+
+#ifndef LINK_PROFILE_H
+#define LINK_PROFILE_H
+
+enum LinkProfile {
+  LINK_PROFILE_NONE,          // Whatever the camera picked
+  LINK_PROFILE_LOW_LATENCY,
+  LINK_PROFILE_LOW_POWER
+};
+
+// Requested profile and what the controller reports back
+struct LinkParams {
+  LinkProfile profile;
+  volatile uint16_t interval;         // 1.25ms units
+  volatile uint16_t latency;
+  volatile uint16_t timeout;          // 10ms units
+  volatile bool updated;              // New parameters to log from loop()
+  uint32_t notifyAvgUs;               // EWMA of notify() until the stack confirms the send
+  uint32_t notifyMaxUs;
+  volatile int8_t rssi;               // Last reading, taken on each command
+};
+
+LinkParams linkParams = {LINK_PROFILE_NONE, 0, 0, 0, false, 0, 0, 0};
+WheelTimer linkIdleTimer;
+
+const char* linkProfileName(LinkProfile profile) {
+  switch (profile) {
+    case LINK_PROFILE_LOW_LATENCY: return "low-latency";
+    case LINK_PROFILE_LOW_POWER:   return "low-power";
+    default:                       return "camera";
+  }
+}
+
+// GAP events arrive on the BLE task, only record them here
+void linkGapHandler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param) {
+  if (event == ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT && param->update_conn_params.status == ESP_BT_STATUS_SUCCESS) {
+    linkParams.interval = param->update_conn_params.conn_int;
+    linkParams.latency = param->update_conn_params.latency;
+    linkParams.timeout = param->update_conn_params.timeout;
+    linkParams.updated = true;
+  } else if (event == ESP_GAP_BLE_READ_RSSI_COMPLETE_EVT && param->read_rssi_cmpl.status == ESP_BT_STATUS_SUCCESS) {
+    linkParams.rssi = param->read_rssi_cmpl.rssi;
+  } else if (event == ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT && advSwitchStartUs) {
+    if (param->adv_data_raw_cmpl.status == ESP_BT_STATUS_SUCCESS) {
+      advSwitchUs = micros() - advSwitchStartUs;
+    }
+    advSwitchStartUs = 0;
+  }
+}
+
+void requestLinkProfile(LinkProfile profile) {
+  if (!deviceConnected || profile == linkParams.profile) {
+    return;
+  }
+  linkParams.profile = profile;
+
+  Serial.print("Requesting ");
+  Serial.print(linkProfileName(profile));
+  Serial.println(" connection parameters");
+
+  if (profile == LINK_PROFILE_LOW_LATENCY) {
+    pServer->updateConnParams(connectedBda, lowLatencyMinInterval, lowLatencyMaxInterval,
+                              lowLatencySlaveLatency, lowLatencyTimeout);
+  } else {
+    pServer->updateConnParams(connectedBda, lowPowerMinInterval, lowPowerMaxInterval,
+                              lowPowerSlaveLatency, lowPowerTimeout);
+  }
+}
+
+void linkIdle(void* arg) {
+  requestLinkProfile(LINK_PROFILE_LOW_POWER);
+}
+
+// Called for every command sent, keeps the link fast while shooting
+void noteCommandActivity() {
+  requestLinkProfile(LINK_PROFILE_LOW_LATENCY);
+  esp_ble_gap_read_rssi(connectedBda);
+  wheelSchedule(&linkIdleTimer, linkIdleTimeout, linkIdle);
+}
+
+void recordNotifyLatency(uint32_t us) {
+  linkParams.notifyAvgUs += ((int32_t)us - (int32_t)linkParams.notifyAvgUs) / 8;
+  if (us > linkParams.notifyMaxUs) {
+    linkParams.notifyMaxUs = us;
+  }
+}
+
+// Call from loop() on connection changes
+void linkProfileConnected() {
+  linkParams.profile = LINK_PROFILE_NONE;
+  noteCommandActivity();      // Start fast, the first command is often right after connecting
+}
+
+void linkProfileDisconnected() {
+  wheelCancel(&linkIdleTimer);
+  linkParams.profile = LINK_PROFILE_NONE;
+  linkParams.interval = 0;
+}
+
+void printLinkParams() {
+  Serial.printf("Connection parameters: %s, interval %.2fms, latency %u, timeout %ums, notify avg %luus max %luus\n",
+                linkProfileName(linkParams.profile), linkParams.interval * 1.25, linkParams.latency,
+                linkParams.timeout * 10, (unsigned long)linkParams.notifyAvgUs, (unsigned long)linkParams.notifyMaxUs);
+}
+
+// Call from loop(), logs parameters the controller settled on
+void updateLinkProfile() {
+  if (linkParams.updated) {
+    linkParams.updated = false;
+    printLinkParams();
+  }
+}
+
+#endif // LINK_PROFILE_H
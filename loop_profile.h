@@ -0,0 +1,189 @@
+/*
+ * loop_profile.h
+ * Cycle-counter timing of loop() phases, with a stall log
+ *
+ * A stall is logged with the phase it happened in: for a pass that finished,
+ * the slowest phase, for one still running, the phase after the last
+ * loopMark(). A watchdog task on the other core checks the running pass every
+ * loopWatchdogInterval, so a pass that never finishes is logged too.
+ */
+
+#ifndef LOOP_PROFILE_H
+#define LOOP_PROFILE_H
+
+enum LoopPhase {
+  LOOP_PHASE_INPUT,           // M5.update()
+  LOOP_PHASE_TIMERS,          // Timer wheel callbacks
+  LOOP_PHASE_IO,              // GPIO, serial, GPS and motion
+  LOOP_PHASE_STATE,           // NVS saves, battery and link health
+  LOOP_PHASE_RENDER,          // Status redraws
+  LOOP_PHASE_LINK,            // Connection changes, acks and macros
+  LOOP_PHASE_BUTTONS,         // Button handling, including full screen draws, then the GPS fix
+  LOOP_PHASE_PASS,            // Whole pass, without the closing delay
+  LOOP_PHASE_PERIOD,          // Start to start, the jitter seen by inputs
+  NUM_LOOP_PHASES
+};
+
+const char* const loopPhaseNames[NUM_LOOP_PHASES] = {
+  "input", "timers", "io", "state", "render", "link", "buttons", "pass", "period"
+};
+
+// Bucket n counts times under 32us << n, the last one everything longer
+#define LOOP_HISTOGRAM_BUCKETS 12
+#define LOOP_STALL_LOG_SIZE 8
+
+struct LoopPhaseStats {
+  uint32_t count;
+  uint32_t avgUs;             // EWMA
+  uint32_t maxUs;
+  uint32_t histogram[LOOP_HISTOGRAM_BUCKETS];
+};
+
+struct LoopStall {
+  uint32_t atMs;
+  uint32_t passUs;
+  uint8_t phase;              // Slowest phase of the pass, or the one running when the watchdog caught it
+  uint32_t phaseUs;
+  bool caught;                // Seen by the watchdog while the pass was still running
+};
+
+LoopPhaseStats loopPhaseStats[NUM_LOOP_PHASES];
+LoopStall loopStalls[LOOP_STALL_LOG_SIZE];
+uint32_t loopStallCount = 0;
+
+uint32_t loopCyclesPerUs = 240;
+volatile uint32_t loopPassStart = 0;
+volatile uint32_t loopPhaseStart = 0;
+uint8_t loopSlowestPhase = 0;
+uint32_t loopSlowestUs = 0;
+
+// Shared with the watchdog, which runs on the other core and so cannot read this core's cycle counter
+volatile uint32_t loopPassStartUs = 0;
+volatile uint8_t loopPhaseRunning = 0;      // Phase after the last loopMark()
+volatile bool loopInPass = false;           // Between loopBegin() and loopEnd()
+volatile bool loopPassCaught = false;       // The watchdog has logged this pass
+portMUX_TYPE loopStallMux = portMUX_INITIALIZER_UNLOCKED;
+
+void recordLoopPhase(int phase, uint32_t us) {
+  LoopPhaseStats &stats = loopPhaseStats[phase];
+  stats.count++;
+  stats.avgUs += ((int32_t)us - (int32_t)stats.avgUs) / 8;
+  if (us > stats.maxUs) {
+    stats.maxUs = us;
+  }
+
+  int bucket = 0;
+  while (bucket < LOOP_HISTOGRAM_BUCKETS - 1 && us >= (32UL << bucket)) {
+    bucket++;
+  }
+  stats.histogram[bucket]++;
+}
+
+// Called by the watchdog, logs the running pass once it has gone past the stall threshold
+void checkLoopStall() {
+  uint32_t nowUs = micros();
+  LoopStall* stall = nullptr;
+  portENTER_CRITICAL(&loopStallMux);
+  uint32_t passUs = nowUs - loopPassStartUs;
+  if (loopInPass && !loopPassCaught && passUs >= loopStallThreshold) {
+    loopPassCaught = true;
+    stall = &loopStalls[loopStallCount % LOOP_STALL_LOG_SIZE];
+    stall->atMs = millis();
+    stall->passUs = passUs;
+    stall->phase = loopPhaseRunning;
+    uint32_t phaseStartUs = (loopPhaseStart - loopPassStart) / loopCyclesPerUs;
+    stall->phaseUs = passUs > phaseStartUs ? passUs - phaseStartUs : 0;
+    stall->caught = true;
+    loopStallCount++;
+  }
+  portEXIT_CRITICAL(&loopStallMux);
+
+  if (stall) {
+    Serial.printf("Loop stuck: %lums so far, in %s\n", (unsigned long)(passUs / 1000), loopPhaseNames[stall->phase]);
+  }
+}
+
+void loopWatchdogTask(void* arg) {
+  for (;;) {
+    vTaskDelay(pdMS_TO_TICKS(loopWatchdogInterval));
+    checkLoopStall();
+  }
+}
+
+// Call from setup()
+void setupLoopProfile() {
+  loopCyclesPerUs = ESP.getCpuFreqMHz();
+
+  // loop() runs on core 1, the watchdog on core 0 still runs when a pass spins
+  xTaskCreatePinnedToCore(loopWatchdogTask, "loopdog", 2048, nullptr, 1, nullptr, 0);
+}
+
+// Call first thing in loop()
+inline void loopBegin() {
+  uint32_t now = ESP.getCycleCount();
+  if (loopPassStart) {
+    recordLoopPhase(LOOP_PHASE_PERIOD, (now - loopPassStart) / loopCyclesPerUs);
+  }
+  loopPassStart = now;
+  loopPhaseStart = now;
+  loopSlowestUs = 0;
+
+  portENTER_CRITICAL(&loopStallMux);
+  loopPassStartUs = micros();
+  loopPhaseRunning = LOOP_PHASE_INPUT;
+  loopPassCaught = false;
+  loopInPass = true;
+  portEXIT_CRITICAL(&loopStallMux);
+}
+
+// Call at the end of each phase
+inline void loopMark(LoopPhase phase) {
+  uint32_t now = ESP.getCycleCount();
+  uint32_t us = (now - loopPhaseStart) / loopCyclesPerUs;
+  recordLoopPhase(phase, us);
+  if (us >= loopSlowestUs) {
+    loopSlowestUs = us;
+    loopSlowestPhase = phase;
+  }
+  loopPhaseStart = now;
+  loopPhaseRunning = phase + 1;
+}
+
+// Call before the closing delay, logs the pass if it stalled
+void loopEnd() {
+  uint32_t passUs = (ESP.getCycleCount() - loopPassStart) / loopCyclesPerUs;
+  recordLoopPhase(LOOP_PHASE_PASS, passUs);
+
+  portENTER_CRITICAL(&loopStallMux);
+  loopInPass = false;
+  bool caught = loopPassCaught;
+  portEXIT_CRITICAL(&loopStallMux);
+
+  // Already logged by the watchdog, fill in how it ended
+  if (caught) {
+    LoopStall &stall = loopStalls[(loopStallCount - 1) % LOOP_STALL_LOG_SIZE];
+    stall.passUs = passUs;
+    if (loopSlowestPhase == stall.phase) {
+      stall.phaseUs = loopSlowestUs;
+    }
+    Serial.printf("Loop stall ended: %lums\n", (unsigned long)(passUs / 1000));
+    return;
+  }
+
+  if (passUs < loopStallThreshold) {
+    return;
+  }
+
+  LoopStall &stall = loopStalls[loopStallCount % LOOP_STALL_LOG_SIZE];
+  stall.atMs = millis();
+  stall.passUs = passUs;
+  stall.phase = loopSlowestPhase;
+  stall.phaseUs = loopSlowestUs;
+  stall.caught = false;
+  loopStallCount++;
+
+  Serial.printf("Loop stall: %lums, %lums in %s\n", (unsigned long)(passUs / 1000),
+                (unsigned long)(loopSlowestUs / 1000), loopPhaseNames[loopSlowestPhase]);
+}
+
+#endif // LOOP_PROFILE_H
@@ -0,0 +1,277 @@
+/*
+ * macro.h
+ * Stored command macros, each step starts as soon as its condition is met
+ */
+
+#ifndef MACRO_H
+#define MACRO_H
+
+enum MacroOp {
+  MACRO_END = 0,
+  MACRO_COMMAND,              // Send a command, once the previous one is answered or given up
+  MACRO_ACK,                  // Stop unless the last command was answered
+  MACRO_WAIT,                 // Pause for arg ms
+  MACRO_UNTIL_MODE            // Wait for a mode report of signature entry arg
+};
+
+struct MacroStep {
+  uint8_t op;
+  uint8_t action;
+  uint16_t arg;
+};
+
+struct MacroCommandName {
+  const char* name;
+  RemoteAction action;
+};
+
+const MacroCommandName macroCommandNames[] = {
+  {"SHUTTER", ACTION_SHUTTER},
+  {"MODE",    ACTION_MODE},
+  {"SCREEN",  ACTION_SCREEN_OFF},
+  {"SLEEP",   ACTION_SLEEP},
+  {"WAKE",    ACTION_WAKE},
+};
+
+MacroStep macros[NUM_MACROS][MACRO_MAX_STEPS];
+Preferences macroPreferences;
+
+// The running macro, -1 when idle
+int runningMacro = -1;
+int macroStep = 0;
+unsigned long macroStartMs = 0;
+unsigned long macroStepStartMs = 0;
+
+struct MacroStats {
+  int last;                   // Last macro to finish, -1 before the first
+  bool lastCompleted;
+  unsigned long lastMs;       // Start to last step done, or to the failing step
+};
+
+MacroStats macroStats = {-1, false, 0};
+
+// Parse "MODE ACK SHUTTER WAIT=500 UNTIL=Video" into steps, false on a bad token
+bool parseMacro(const char* text, MacroStep* steps) {
+  MacroStep parsed[MACRO_MAX_STEPS];
+  memset(parsed, 0, sizeof(parsed));
+  int count = 0;
+  char token[24];
+
+  while (*text) {
+    while (*text == ' ') {
+      text++;
+    }
+    if (*text == '\0') {
+      break;
+    }
+
+    size_t length = 0;
+    while (text[length] && text[length] != ' ') {
+      length++;
+    }
+    if (length >= sizeof(token) || count == MACRO_MAX_STEPS - 1) {
+      return false;
+    }
+    memcpy(token, text, length);
+    token[length] = '\0';
+    text += length;
+
+    MacroStep &step = parsed[count++];
+    char* value = strchr(token, '=');
+    if (value) {
+      *value++ = '\0';
+    }
+
+    if (strcasecmp(token, "ACK") == 0 && !value) {
+      step.op = MACRO_ACK;
+    } else if (strcasecmp(token, "WAIT") == 0 && value) {
+      // Whole ms up to the 16 bit step argument, no sign
+      char* end;
+      long ms = strtol(value, &end, 10);
+      if (!isdigit((unsigned char)value[0]) || *end || ms > UINT16_MAX) {
+        return false;
+      }
+      step.op = MACRO_WAIT;
+      step.arg = (uint16_t)ms;
+    } else if (strcasecmp(token, "UNTIL") == 0 && value) {
+      int entry = findModeEntry(value);
+      if (entry < 0) {
+        return false;
+      }
+      step.op = MACRO_UNTIL_MODE;
+      step.arg = (uint16_t)entry;
+    } else {
+      step.op = MACRO_END;
+      for (const MacroCommandName &c : macroCommandNames) {
+        if (!value && strcasecmp(token, c.name) == 0) {
+          step.op = MACRO_COMMAND;
+          step.action = c.action;
+        }
+      }
+      if (step.op == MACRO_END) {
+        return false;
+      }
+    }
+  }
+
+  memcpy(steps, parsed, sizeof(parsed));
+  return true;
+}
+
+// Print the steps back in the form parseMacro() takes
+void printMacro(const MacroStep* steps) {
+  for (int i = 0; i < MACRO_MAX_STEPS && steps[i].op != MACRO_END; i++) {
+    if (i) {
+      Serial.print(' ');
+    }
+    switch (steps[i].op) {
+      case MACRO_COMMAND:
+        for (const MacroCommandName &c : macroCommandNames) {
+          if (c.action == steps[i].action) {
+            Serial.print(c.name);
+          }
+        }
+        break;
+      case MACRO_ACK:
+        Serial.print("ACK");
+        break;
+      case MACRO_WAIT:
+        Serial.printf("WAIT=%u", steps[i].arg);
+        break;
+      case MACRO_UNTIL_MODE:
+        Serial.printf("UNTIL=%u", steps[i].arg);
+        break;
+    }
+  }
+}
+
+// Call after loadModeSignatures(), UNTIL steps may name learned modes
+void loadMacros() {
+  macroPreferences.begin("macros", true);
+  for (int m = 0; m < NUM_MACROS; m++) {
+    char key[4] = {'m', (char)('0' + m), '\0'};
+    if (macroPreferences.getBytesLength(key) == sizeof(macros[m])) {
+      macroPreferences.getBytes(key, macros[m], sizeof(macros[m]));
+    } else if (!parseMacro(defaultMacros[m], macros[m])) {
+      Serial.printf("Default macro %d does not parse\n", m + 1);
+      memset(macros[m], 0, sizeof(macros[m]));
+    }
+  }
+  macroPreferences.end();
+}
+
+bool storeMacro(int macro, const char* text) {
+  if (macro < 0 || macro >= NUM_MACROS || runningMacro == macro || !parseMacro(text, macros[macro])) {
+    return false;
+  }
+
+  char key[4] = {'m', (char)('0' + macro), '\0'};
+  macroPreferences.begin("macros", false);
+  macroPreferences.putBytes(key, macros[macro], sizeof(macros[macro]));
+  macroPreferences.end();
+  return true;
+}
+
+void finishMacro(bool completed) {
+  unsigned long elapsed = millis() - macroStartMs;
+  macroStats = {runningMacro, completed, elapsed};
+  Serial.printf("Macro %d %s after %lums at step %d\n", runningMacro + 1,
+                completed ? "done" : "failed", elapsed, macroStep + 1);
+  runningMacro = -1;
+
+  M5.Lcd.fillScreen(BLACK);
+  M5.Lcd.setCursor(25, 35);
+  M5.Lcd.setTextColor(completed ? GREEN : RED);
+  M5.Lcd.println(completed ? "Macro done!" : "Macro failed!");
+  showOverlay(completed ? 800 : 1500);
+}
+
+void runMacro(int macro) {
+  if (runningMacro >= 0) {
+    Serial.println("Macro already running");
+    return;
+  }
+  if (macros[macro][0].op == MACRO_END) {
+    M5.Lcd.fillScreen(BLACK);
+    M5.Lcd.setCursor(25, 35);
+    M5.Lcd.setTextColor(RED);
+    M5.Lcd.println("Macro is empty");
+    showOverlay(1500);
+    return;
+  }
+
+  Serial.printf("Macro %d started\n", macro + 1);
+  runningMacro = macro;
+  macroStep = 0;
+  macroStartMs = millis();
+  macroStepStartMs = macroStartMs;
+}
+
+// How long loop() may sleep before a running WAIT step is due, at most maxMs
+unsigned long macroSleepMs(unsigned long maxMs) {
+  if (runningMacro < 0 || macros[runningMacro][macroStep].op != MACRO_WAIT) {
+    return maxMs;
+  }
+  unsigned long waited = millis() - macroStepStartMs;
+  unsigned long wait = macros[runningMacro][macroStep].arg;
+  return waited >= wait ? 0 : min(maxMs, wait - waited);
+}
+
+// Call from loop(), runs every step whose condition is met
+void updateMacro() {
+  while (runningMacro >= 0) {
+    const MacroStep &step = macros[runningMacro][macroStep];
+    unsigned long now = millis();
+    bool waiting = false;
+
+    switch (step.op) {
+      case MACRO_END:
+        finishMacro(true);
+        return;
+
+      case MACRO_COMMAND:
+        if (pendingCommand.active) {
+          waiting = true;
+        } else if (step.action != ACTION_WAKE && !deviceConnected) {
+          finishMacro(false);
+          return;
+        } else {
+          runRemoteAction((RemoteAction)step.action);
+        }
+        break;
+
+      case MACRO_ACK:
+        if (pendingCommand.active) {
+          waiting = true;
+        } else if (!lastCommandAnswered) {
+          finishMacro(false);
+          return;
+        }
+        break;
+
+      case MACRO_WAIT:
+        waiting = (now - macroStepStartMs < step.arg);
+        break;
+
+      case MACRO_UNTIL_MODE:
+        waiting = (lastModeEntry != step.arg);
+        break;
+    }
+
+    if (waiting) {
+      if (step.op != MACRO_WAIT && now - macroStepStartMs >= macroStepTimeout) {
+        finishMacro(false);
+      }
+      return;
+    }
+
+    macroStep++;
+    macroStepStartMs = now;
+    if (macroStep == MACRO_MAX_STEPS) {
+      finishMacro(true);
+      return;
+    }
+  }
+}
+
+#endif // MACRO_H
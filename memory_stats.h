@@ -0,0 +1,54 @@
+/*
+ * memory_stats.h
+ * Heap and task stack high-water marks for long sessions
+ */
+
+#ifndef MEMORY_STATS_H
+#define MEMORY_STATS_H
+
+TaskHandle_t loopTaskHandle = nullptr;
+WheelTimer memoryReportTimer;
+
+// Tasks worth watching, by name, BLE ones are created by the stack
+const char* const bleTaskNames[] = {"BTC_TASK", "BTU_TASK", "btController"};
+
+void printStackHighWater(const char* name, TaskHandle_t task) {
+  if (!task) {
+    return;
+  }
+  Serial.printf(" %s=%u", name, (unsigned)uxTaskGetStackHighWaterMark(task));
+}
+
+// Free heap now and at its lowest, largest block that can still be allocated,
+// and the least free stack each task has had (bytes)
+void printMemoryReport() {
+  Serial.printf("Memory: free=%lu min_free=%lu largest=%lu stack:",
+                (unsigned long)ESP.getFreeHeap(), (unsigned long)ESP.getMinFreeHeap(),
+                (unsigned long)ESP.getMaxAllocHeap());
+  printStackHighWater("loop", loopTaskHandle);
+  printStackHighWater("motion", motionTaskHandle);
+  for (const char* name : bleTaskNames) {
+    printStackHighWater(name, xTaskGetHandle(name));
+  }
+  Serial.println();
+}
+
+void memoryReportTick(void* arg) {
+  printMemoryReport();
+  wheelSchedule(&memoryReportTimer, memoryReportInterval, memoryReportTick);
+}
+
+// Cuts loop()'s wait short, from any task
+void wakeLoop() {
+  if (loopTaskHandle) {
+    xTaskNotifyGive(loopTaskHandle);
+  }
+}
+
+// Call from setup(), on the loop task
+void setupMemoryReport() {
+  loopTaskHandle = xTaskGetCurrentTaskHandle();
+  wheelSchedule(&memoryReportTimer, memoryReportInterval, memoryReportTick);
+}
+
+#endif // MEMORY_STATS_H
@@ -0,0 +1,263 @@
+/*
+ * mode_db.h
+ * Per-model camera mode signatures with learning of unknown signatures
+ */
+
+#ifndef MODE_DB_H
+#define MODE_DB_H
+
+#define MODE_SIG_LENGTH     5
+#define MODE_LABEL_LENGTH   14
+#define MAX_LEARNED_SIGS    16
+#define MODE_INDEX_SIZE     64      // Power of two, well above the entry count
+
+// Camera models, by the name prefix they advertise
+enum CameraModel {
+  MODEL_X3,
+  MODEL_X4,
+  MODEL_X5,
+  MODEL_RS,
+  MODEL_ONE,
+  NUM_MODELS,
+  MODEL_UNKNOWN = NUM_MODELS
+};
+
+const char* const cameraModelPrefixes[NUM_MODELS] = {"X3 ", "X4 ", "X5 ", "RS ", "ONE "};
+
+struct ModeSignature {
+  uint8_t model;
+  uint8_t sig[MODE_SIG_LENGTH];
+  char label[MODE_LABEL_LENGTH];
+};
+
+// Recognize various modes by Camera responses
+// TODO: Figure out the mode bytes for cameras other than the X5, they are learned meanwhile
+const ModeSignature builtinModeSignatures[] = {
+  {MODEL_X5, {0x20, 0x39, 0x39, 0x39, 0x2B}, "Camera"},
+  {MODEL_X5, {0x35, 0x68, 0x33, 0x35, 0x6D}, "Video"},       // Also several other video modes (e.g., PureVideo)
+  {MODEL_X5, {0x35, 0x68, 0x30, 0x33, 0x6D}, "Timeshift"},
+  {MODEL_X5, {0x39, 0x68, 0x34, 0x32, 0x6D}, "Loop Record"},
+};
+const int NUM_BUILTIN_SIGS = sizeof(builtinModeSignatures) / sizeof(builtinModeSignatures[0]);
+
+// Signatures seen in the field, kept in preferences until labelled
+ModeSignature learnedModeSignatures[MAX_LEARNED_SIGS];
+int numLearnedSigs = 0;
+volatile int lastModeEntry = -1;   // Entry of the last mode report, -1 when unknown
+bool learnedSigsDirty = false;      // Saved from loop(), not from the BLE task
+Preferences modePreferences;        // Separate from the camera's, which the BLE task also uses
+
+// Perfect hash index: slot -> entry + 1 (0 empty). Entries below NUM_BUILTIN_SIGS are built-in.
+uint8_t modeIndex[MODE_INDEX_SIZE];
+uint32_t modeIndexSeed = 0;
+bool modeIndexComplete = false;     // False when no seed fits every entry, lookups then scan
+portMUX_TYPE modeDbMux = portMUX_INITIALIZER_UNLOCKED;
+
+CameraModel cameraModelFromName(const char* name) {
+  for (int i = 0; i < NUM_MODELS; i++) {
+    if (strncmp(name, cameraModelPrefixes[i], strlen(cameraModelPrefixes[i])) == 0) {
+      return (CameraModel)i;
+    }
+  }
+  return MODEL_UNKNOWN;
+}
+
+inline uint32_t modeSignatureHash(uint8_t model, const uint8_t* sig, uint32_t seed) {
+  uint32_t h = seed ^ (model * 0x9E3779B1u);
+  for (int i = 0; i < MODE_SIG_LENGTH; i++) {
+    h = (h ^ sig[i]) * 0x01000193u;
+  }
+  return (h ^ (h >> 15)) & (MODE_INDEX_SIZE - 1);
+}
+
+inline const ModeSignature* modeSignatureEntry(int entry) {
+  return entry < NUM_BUILTIN_SIGS ? &builtinModeSignatures[entry]
+                                  : &learnedModeSignatures[entry - NUM_BUILTIN_SIGS];
+}
+
+// Entry for a signature number or label, -1 if there is none
+int findModeEntry(const char* name) {
+  char* end;
+  int entry = (int)strtol(name, &end, 10);
+  if (end == name || *end) {
+    entry = -1;
+    for (int e = 0; e < NUM_BUILTIN_SIGS + numLearnedSigs; e++) {
+      if (strcasecmp(modeSignatureEntry(e)->label, name) == 0) {
+        return e;
+      }
+    }
+  }
+  return (entry >= 0 && entry < NUM_BUILTIN_SIGS + numLearnedSigs) ? entry : -1;
+}
+
+// Find a seed that puts every signature in its own slot, runs only when entries change.
+// The table is built aside and swapped in whole, so a lookup never sees a partial one.
+void rebuildModeIndex() {
+  int total = NUM_BUILTIN_SIGS + numLearnedSigs;
+  uint8_t table[MODE_INDEX_SIZE];
+
+  // A fit takes a few dozen seeds, the bound keeps a miss from stalling the BLE task
+  for (uint32_t seed = 1; seed <= 1000; seed++) {
+    memset(table, 0, sizeof(table));
+    bool collision = false;
+
+    for (int e = 0; e < total && !collision; e++) {
+      const ModeSignature* s = modeSignatureEntry(e);
+      uint32_t slot = modeSignatureHash(s->model, s->sig, seed);
+      if (table[slot]) {
+        collision = true;
+      } else {
+        table[slot] = e + 1;
+      }
+    }
+
+    if (!collision) {
+      portENTER_CRITICAL(&modeDbMux);
+      memcpy(modeIndex, table, sizeof(modeIndex));
+      modeIndexSeed = seed;
+      modeIndexComplete = true;
+      portEXIT_CRITICAL(&modeDbMux);
+      return;
+    }
+  }
+
+  modeIndexComplete = false;
+  Serial.println("Mode index: no collision-free seed found, scanning instead");
+}
+
+void loadModeSignatures() {
+  modePreferences.begin("modesigs", true);
+  size_t len = modePreferences.getBytesLength("sigs");
+  if (len > 0 && len <= sizeof(learnedModeSignatures) && len % sizeof(ModeSignature) == 0) {
+    modePreferences.getBytes("sigs", learnedModeSignatures, len);
+    numLearnedSigs = len / sizeof(ModeSignature);
+  }
+  modePreferences.end();
+
+  rebuildModeIndex();
+
+  Serial.print("Mode signatures: ");
+  Serial.print(NUM_BUILTIN_SIGS);
+  Serial.print(" built-in, ");
+  Serial.print(numLearnedSigs);
+  Serial.println(" learned");
+}
+
+// Call from loop(), persists signatures learned on the BLE task
+void saveModeSignatures() {
+  if (!learnedSigsDirty) {
+    return;
+  }
+  learnedSigsDirty = false;
+
+  modePreferences.begin("modesigs", false);
+  modePreferences.putBytes("sigs", learnedModeSignatures, numLearnedSigs * sizeof(ModeSignature));
+  modePreferences.end();
+  Serial.println("Learned mode signatures saved");
+}
+
+// Constant time: one hash, one slot, one compare
+int findModeSignature(uint8_t model, const uint8_t* sig) {
+  if (!modeIndexComplete) {
+    for (int e = 0; e < NUM_BUILTIN_SIGS + numLearnedSigs; e++) {
+      const ModeSignature* s = modeSignatureEntry(e);
+      if (s->model == model && memcmp(s->sig, sig, MODE_SIG_LENGTH) == 0) {
+        return e;
+      }
+    }
+    return -1;
+  }
+
+  portENTER_CRITICAL(&modeDbMux);
+  int entry = modeIndex[modeSignatureHash(model, sig, modeIndexSeed)] - 1;
+  portEXIT_CRITICAL(&modeDbMux);
+  if (entry < 0) {
+    return -1;
+  }
+  const ModeSignature* s = modeSignatureEntry(entry);
+  if (s->model != model || memcmp(s->sig, sig, MODE_SIG_LENGTH) != 0) {
+    return -1;
+  }
+  return entry;
+}
+
+// Built-in entry with these bytes whatever its model, -1 if there is none
+int findBuiltinSignature(const uint8_t* sig) {
+  for (int e = 0; e < NUM_BUILTIN_SIGS; e++) {
+    if (memcmp(builtinModeSignatures[e].sig, sig, MODE_SIG_LENGTH) == 0) {
+      return e;
+    }
+  }
+  return -1;
+}
+
+// Remember a signature we could not name, returns its entry or -1 when full
+int learnModeSignature(uint8_t model, const uint8_t* sig) {
+  if (numLearnedSigs >= MAX_LEARNED_SIGS) {
+    return -1;
+  }
+
+  portENTER_CRITICAL(&modeDbMux);
+  ModeSignature &s = learnedModeSignatures[numLearnedSigs];
+  s.model = model;
+  memcpy(s.sig, sig, MODE_SIG_LENGTH);
+  s.label[0] = '\0';
+  numLearnedSigs++;
+  portEXIT_CRITICAL(&modeDbMux);
+
+  rebuildModeIndex();
+  learnedSigsDirty = true;
+  return NUM_BUILTIN_SIGS + numLearnedSigs - 1;
+}
+
+// Name a learned signature, e.g. from the LABEL serial verb
+bool labelModeSignature(int entry, const char* label) {
+  if (entry < NUM_BUILTIN_SIGS || entry >= NUM_BUILTIN_SIGS + numLearnedSigs) {
+    return false;
+  }
+
+  portENTER_CRITICAL(&modeDbMux);
+  snprintf(learnedModeSignatures[entry - NUM_BUILTIN_SIGS].label, MODE_LABEL_LENGTH, "%s", label);
+  portEXIT_CRITICAL(&modeDbMux);
+
+  learnedSigsDirty = true;
+  return true;
+}
+
+// Mode name for a status frame signature, learning it if it is new
+void modeNameForSignature(const uint8_t* sig, char* name, size_t size) {
+  uint8_t model = cameraModelFromName(currentCamera.name);
+  int entry = findModeSignature(model, sig);
+
+  // Only the X5 has built-in entries so far, other and unknown models use them for the same bytes
+  if (entry < 0) {
+    entry = findBuiltinSignature(sig);
+  }
+
+  if (entry < 0) {
+    Serial.printf("MODE unhandled returned: ");
+    for (int i = 0; i < MODE_SIG_LENGTH; i++) {
+      Serial.printf("%02X ", sig[i]);
+    }
+    Serial.println();
+
+    entry = learnModeSignature(model, sig);
+    if (entry < 0) {
+      snprintf(name, size, "Unhandled");
+      return;
+    }
+    Serial.print("Learned as signature #");
+    Serial.println(entry);
+  }
+
+  lastModeEntry = entry;
+
+  const ModeSignature* s = modeSignatureEntry(entry);
+  if (s->label[0] == '\0') {
+    snprintf(name, size, "Sig #%d", entry);
+  } else {
+    snprintf(name, size, "%s", s->label);
+  }
+}
+
+#endif // MODE_DB_H
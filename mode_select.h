@@ -0,0 +1,162 @@
+/*
+ * mode_select.h
+ * Goes to a target mode by sending MODE and reading the camera's mode report after each press
+ *
+ * Every press answered by a single report is one observed step of the
+ * camera's mode cycle, kept per signature entry so the number of presses
+ * to a target is known before starting. A step that does not match the
+ * learned cycle (the camera's mode list was changed) replaces it.
+ */
+
+#ifndef MODE_SELECT_H
+#define MODE_SELECT_H
+
+const int MODE_MAX_ENTRIES = NUM_BUILTIN_SIGS + MAX_LEARNED_SIGS;
+
+// Learned cycle: entry -> entry after one MODE press, -1 when not seen yet
+int8_t modeCycleNext[MODE_MAX_ENTRIES];
+bool modeCycleDirty = false;
+
+struct ModeSelect {
+  bool active;
+  int target;
+  int fromEntry;              // Mode before the press in flight
+  int steps;
+  int predicted;              // Presses the learned cycle needs, -1 if it does not know
+  unsigned long startMs;
+  unsigned long stepStartMs;
+};
+
+struct ModeSelectStats {
+  uint32_t reached;
+  uint32_t failed;
+  uint32_t relearned;         // Steps that differed from the learned cycle
+  int lastSteps;
+  unsigned long lastMs;
+  unsigned long stepAvgMs;    // EWMA of the time per press
+};
+
+ModeSelect modeSelect;
+ModeSelectStats modeSelectStats;
+
+// Call after loadModeSignatures()
+void loadModeCycle() {
+  memset(modeCycleNext, -1, sizeof(modeCycleNext));
+  modePreferences.begin("modesigs", true);
+  if (modePreferences.getBytesLength("cycle") == sizeof(modeCycleNext)) {
+    modePreferences.getBytes("cycle", modeCycleNext, sizeof(modeCycleNext));
+  }
+  modePreferences.end();
+}
+
+// Call from loop(), persists cycle steps learned since the last pass
+void saveModeCycle() {
+  if (!modeCycleDirty) {
+    return;
+  }
+  modeCycleDirty = false;
+
+  modePreferences.begin("modesigs", false);
+  modePreferences.putBytes("cycle", modeCycleNext, sizeof(modeCycleNext));
+  modePreferences.end();
+}
+
+// Presses from one entry to another along the learned cycle, -1 if unknown
+int predictModeSteps(int from, int target) {
+  int entry = from;
+  for (int steps = 0; steps <= modeSelectMaxSteps && entry >= 0; steps++) {
+    if (entry == target) {
+      return steps;
+    }
+    entry = modeCycleNext[entry];
+  }
+  return -1;
+}
+
+void learnModeStep(int from, int to) {
+  if (from < 0 || to < 0 || modeCycleNext[from] == to) {
+    return;
+  }
+  if (modeCycleNext[from] >= 0) {
+    modeSelectStats.relearned++;
+  }
+  modeCycleNext[from] = to;
+  modeCycleDirty = true;
+}
+
+void finishModeSelect(bool reached) {
+  unsigned long elapsed = millis() - modeSelect.startMs;
+  modeSelect.active = false;
+
+  ModeSelectStats &stats = modeSelectStats;
+  if (reached) {
+    stats.reached++;
+  } else {
+    stats.failed++;
+  }
+  stats.lastSteps = modeSelect.steps;
+  stats.lastMs = elapsed;
+
+  Serial.printf("Mode select: %s %s after %d presses (predicted %d) in %lums\n",
+                modeSignatureEntry(modeSelect.target)->label[0] ? modeSignatureEntry(modeSelect.target)->label : "target",
+                reached ? "reached" : "not reached", modeSelect.steps, modeSelect.predicted, elapsed);
+
+  M5.Lcd.fillScreen(BLACK);
+  M5.Lcd.setCursor(25, 35);
+  M5.Lcd.setTextColor(reached ? GREEN : RED);
+  M5.Lcd.println(reached ? "Mode reached!" : "Mode not reached!");
+  showOverlay(reached ? 800 : 1500);
+}
+
+// Start going to a signature entry, false if the camera is not connected or busy
+bool startModeSelect(int target) {
+  if (modeSelect.active || runningMacro >= 0 || !deviceConnected) {
+    return false;
+  }
+
+  modeSelect.active = true;
+  modeSelect.target = target;
+  modeSelect.fromEntry = -1;
+  modeSelect.steps = 0;
+  modeSelect.predicted = (lastModeEntry >= 0) ? predictModeSteps(lastModeEntry, target) : -1;
+  modeSelect.startMs = millis();
+  return true;
+}
+
+// Call from loop(), presses MODE once the previous press has been answered
+void updateModeSelect() {
+  if (!modeSelect.active || pendingCommand.active) {
+    return;
+  }
+
+  int entry = lastModeEntry;
+  if (modeSelect.steps > 0) {
+    if (!lastCommandAnswered || !deviceConnected) {
+      finishModeSelect(false);
+      return;
+    }
+
+    // A resent press may have moved the camera twice, so only single presses teach the cycle
+    if (pendingCommand.retries == 0) {
+      learnModeStep(modeSelect.fromEntry, entry);
+    }
+    unsigned long stepMs = millis() - modeSelect.stepStartMs;
+    modeSelectStats.stepAvgMs += ((long)stepMs - (long)modeSelectStats.stepAvgMs) / 4;
+  }
+
+  if (entry == modeSelect.target) {
+    finishModeSelect(true);
+    return;
+  }
+  if (modeSelect.steps == modeSelectMaxSteps) {
+    finishModeSelect(false);
+    return;
+  }
+
+  modeSelect.fromEntry = entry;
+  modeSelect.steps++;
+  modeSelect.stepStartMs = millis();
+  executeSwitchMode();
+}
+
+#endif // MODE_SELECT_H
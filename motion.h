@@ -0,0 +1,212 @@
+/*
+ * motion.h
+ * IMU gesture engine: samples the accelerometer and gyro on its own task,
+ * filters in fixed point and hands double-tap, flick and stillness events to loop()
+ */
+
+#ifndef MOTION_H
+#define MOTION_H
+
+struct MotionEvent {
+  MotionGesture gesture;
+  uint32_t latencyUs;         // From the first sample of the gesture to detection
+};
+
+// Engine counters, written by the motion task and reported with the IMU serial verb
+struct MotionStats {
+  volatile uint32_t samples;
+  volatile uint32_t overruns;         // Passes that missed their sample slot
+  volatile uint32_t readUsAvg;        // EWMA of the I2C read time
+  volatile uint32_t costUsAvg;        // EWMA of filter and detector time per sample
+  volatile uint32_t events[NUM_GESTURES];
+  volatile uint32_t lastLatencyUs;
+};
+
+MotionStats motionStats;
+QueueHandle_t motionQueue = nullptr;
+TaskHandle_t motionTaskHandle = nullptr;
+
+// Detector state, only touched by the motion task
+struct MotionDetector {
+  int32_t gravity[3];         // Low-passed acceleration, mg * 16
+  bool tapHigh;
+  int tapCount;
+  unsigned long firstTapUs;
+  unsigned long lastTapUs;
+  unsigned long tapSuppressUntilUs;
+  bool inFlick;
+  unsigned long flickStartUs;
+  unsigned long stillSinceUs;
+  bool stillFired;
+  bool primed;
+};
+
+MotionDetector motionDetector;
+
+const char* motionGestureName(MotionGesture gesture) {
+  switch (gesture) {
+    case GESTURE_DOUBLE_TAP: return "Double tap";
+    case GESTURE_FLICK:      return "Flick";
+    case GESTURE_STILL:      return "Still";
+    default:                 return "Unknown";
+  }
+}
+
+void postMotionEvent(MotionGesture gesture, unsigned long startUs, unsigned long nowUs) {
+  MotionEvent event = {gesture, (uint32_t)(nowUs - startUs)};
+  motionStats.events[gesture]++;
+  motionStats.lastLatencyUs = event.latencyUs;
+  xQueueSend(motionQueue, &event, 0);
+}
+
+// One sample: acceleration in mg, rotation in dps
+void processMotionSample(const int32_t accel[3], const int32_t gyro[3], unsigned long nowUs) {
+  MotionDetector &d = motionDetector;
+
+  if (!d.primed) {
+    for (int i = 0; i < 3; i++) {
+      d.gravity[i] = accel[i] << 4;
+    }
+    d.primed = true;
+  }
+
+  // High-pass by removing a slow gravity estimate, L1 norm keeps it multiply-free
+  int32_t motion = 0;
+  int32_t spin = 0;
+  for (int i = 0; i < 3; i++) {
+    d.gravity[i] += ((accel[i] << 4) - d.gravity[i]) >> 4;
+    motion += abs(accel[i] - (d.gravity[i] >> 4));
+    spin = max(spin, (int32_t)abs(gyro[i]));
+  }
+
+  // Flick: a short burst of rotation
+  if (!d.inFlick && spin > motionFlickThreshold) {
+    d.inFlick = true;
+    d.flickStartUs = nowUs;
+  } else if (d.inFlick && spin < motionFlickThreshold / 2) {
+    d.inFlick = false;
+    if (nowUs - d.flickStartUs <= motionFlickMax * 1000) {
+      postMotionEvent(GESTURE_FLICK, d.flickStartUs, nowUs);
+    }
+    // The twist also shakes the accelerometer, so don't read it as taps
+    d.tapCount = 0;
+    d.tapSuppressUntilUs = nowUs + 300000;
+  }
+
+  // Double tap: two acceleration spikes within the tap window
+  if (d.tapCount == 1 && nowUs - d.lastTapUs > motionDoubleTapMax * 1000) {
+    d.tapCount = 0;
+  }
+  if (!d.tapHigh && motion > motionTapThreshold) {
+    d.tapHigh = true;
+    if (!d.inFlick && (long)(nowUs - d.tapSuppressUntilUs) >= 0) {
+      unsigned long gap = nowUs - d.lastTapUs;
+      if (d.tapCount == 1 && gap >= motionDoubleTapMin * 1000) {
+        postMotionEvent(GESTURE_DOUBLE_TAP, d.firstTapUs, nowUs);
+        d.tapCount = 0;
+      } else if (d.tapCount == 0) {
+        d.tapCount = 1;
+        d.firstTapUs = nowUs;
+      }
+      d.lastTapUs = nowUs;
+    }
+  } else if (d.tapHigh && motion < motionTapThreshold / 2) {
+    d.tapHigh = false;
+  }
+
+  // Stillness: fires once per still period
+  if (motion < motionStillThreshold && spin < motionStillGyroThreshold) {
+    if (d.stillSinceUs == 0) {
+      d.stillSinceUs = nowUs;
+    } else if (!d.stillFired && nowUs - d.stillSinceUs >= motionStillTime * 1000) {
+      d.stillFired = true;
+      postMotionEvent(GESTURE_STILL, d.stillSinceUs, nowUs);
+    }
+  } else {
+    d.stillSinceUs = 0;
+    d.stillFired = false;
+  }
+}
+
+void motionTask(void* arg) {
+  TickType_t lastWake = xTaskGetTickCount();
+  const TickType_t period = pdMS_TO_TICKS(motionSampleInterval);
+
+  for (;;) {
+    vTaskDelayUntil(&lastWake, period);
+    if ((TickType_t)(xTaskGetTickCount() - lastWake) >= period) {
+      motionStats.overruns++;
+    }
+
+    unsigned long readStart = micros();
+    float ax, ay, az, gx, gy, gz;
+    i2cLock();
+    bool fresh = M5.Imu.update();
+    M5.Imu.getAccel(&ax, &ay, &az);
+    M5.Imu.getGyro(&gx, &gy, &gz);
+    i2cUnlock();
+    unsigned long processStart = micros();
+
+    if (!fresh) {
+      continue;
+    }
+
+    int32_t accel[3] = {(int32_t)(ax * 1000), (int32_t)(ay * 1000), (int32_t)(az * 1000)};
+    int32_t gyro[3] = {(int32_t)gx, (int32_t)gy, (int32_t)gz};
+    processMotionSample(accel, gyro, processStart);
+
+    unsigned long done = micros();
+    motionStats.samples++;
+    motionStats.readUsAvg += ((int32_t)(processStart - readStart) - (int32_t)motionStats.readUsAvg) / 16;
+    motionStats.costUsAvg += ((int32_t)(done - processStart) - (int32_t)motionStats.costUsAvg) / 16;
+  }
+}
+
+void setupMotion() {
+  if (!motionEnabled) {
+    return;
+  }
+
+  if (!M5.Imu.isEnabled()) {
+    Serial.println("Motion triggers enabled but no IMU found");
+    return;
+  }
+
+  i2cMutex = xSemaphoreCreateMutex();
+  motionQueue = xQueueCreate(8, sizeof(MotionEvent));
+
+  // Same priority as loop() so sampling never preempts the command path
+  xTaskCreatePinnedToCore(motionTask, "motion", 3072, nullptr, 1, &motionTaskHandle, 1);
+  Serial.print("Motion triggers active at ");
+  Serial.print(1000 / motionSampleInterval);
+  Serial.println(" Hz");
+}
+
+// Call from loop(), runs the commands mapped to detected gestures
+void pollMotionEvents() {
+  if (!motionQueue) {
+    return;
+  }
+
+  MotionEvent event;
+  while (xQueueReceive(motionQueue, &event, 0) == pdTRUE) {
+    const MotionGestureConfig &config = motionGestures[event.gesture];
+
+    Serial.print("Gesture: ");
+    Serial.print(motionGestureName(event.gesture));
+    Serial.print(" (");
+    Serial.print(event.latencyUs / 1000);
+    Serial.print("ms)");
+
+    if (!config.enabled) {
+      Serial.println(" - not mapped");
+      continue;
+    }
+
+    Serial.print(" - executing ");
+    Serial.println(remoteActionName(config.action));
+    runRemoteAction(config.action);
+  }
+}
+
+#endif // MOTION_H
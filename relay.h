@@ -0,0 +1,225 @@
+/*
+ * relay.h
+ * Forwards triggers from a master remote to slave remotes over a connectionless transport
+ *
+ * The master broadcasts each trigger relayRepeats times under one sequence
+ * number. Slaves drop repeats by sequence number (reset when the master reboots)
+ * and drop triggers that arrive more than relayMaxAge late, judged against the
+ * quickest delivery seen so far, so a delayed shot is never fired. That
+ * decision is relayAccept(), which takes the slave's state and counters as
+ * arguments so a host test can run several slaves side by side.
+ */
+
+#ifndef RELAY_H
+#define RELAY_H
+
+#define RELAY_MAGIC 0x5249       // Marks a relay frame
+#define RELAY_VERSION 1
+
+struct RelayMessage {
+  uint16_t magic;
+  uint8_t version;
+  uint8_t action;
+  char group[4];
+  uint32_t bootId;            // Random per master boot
+  uint32_t seq;
+  uint32_t sentMicros;        // Master clock
+};
+
+struct RelayInbound {
+  RelayMessage message;
+  uint32_t rxMicros;
+};
+
+struct RelayStats {
+  uint32_t sent;
+  uint32_t received;
+  uint32_t duplicates;
+  uint32_t stale;
+  uint32_t rejected;          // Wrong format or group
+  uint32_t fired;
+  int32_t minTransitUs;       // Slave clock minus master clock, quickest seen
+  uint32_t jitterAvgUs;       // EWMA of the delay over the quickest
+  uint32_t jitterMaxUs;
+};
+
+// Whatever carries the messages, receive calls relayReceived() from any task
+class RelayTransport {
+  public:
+    virtual ~RelayTransport() {}
+    virtual bool begin() = 0;
+    virtual bool send(const uint8_t* data, size_t length) = 0;
+};
+
+// What a slave remembers about the master
+struct RelayReceiver {
+  uint32_t lastBootId;
+  uint32_t lastSeq;
+  bool transitKnown;
+};
+
+RelayTransport* relayTransport = nullptr;
+QueueHandle_t relayQueue = nullptr;
+RelayStats relayStats;
+uint32_t relayBootId = 0;
+uint32_t relaySeq = 0;
+RelayReceiver relayReceiver;
+
+// Runs on the transport's task, queue the message and wake loop()
+void relayReceived(const uint8_t* data, size_t length) {
+  if (!relayQueue || length != sizeof(RelayMessage)) {
+    return;
+  }
+  RelayInbound inbound;
+  inbound.rxMicros = micros();
+  memcpy(&inbound.message, data, sizeof(RelayMessage));
+  xQueueSend(relayQueue, &inbound, 0);
+  wakeLoop();
+}
+
+// ESP-NOW broadcast, runs alongside BLE on the shared radio
+class EspNowTransport : public RelayTransport {
+  public:
+    bool begin() {
+      WiFi.mode(WIFI_STA);
+      esp_wifi_set_channel(relayChannel, WIFI_SECOND_CHAN_NONE);
+      if (esp_now_init() != ESP_OK) {
+        return false;
+      }
+      esp_now_register_recv_cb(onReceive);
+
+      esp_now_peer_info_t peer;
+      memset(&peer, 0, sizeof(peer));
+      memset(peer.peer_addr, 0xFF, sizeof(peer.peer_addr));
+      peer.channel = relayChannel;
+      peer.encrypt = false;
+      return esp_now_add_peer(&peer) == ESP_OK;
+    }
+
+    bool send(const uint8_t* data, size_t length) {
+      static const uint8_t broadcast[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+      return esp_now_send(broadcast, data, length) == ESP_OK;
+    }
+
+  private:
+    static void onReceive(const esp_now_recv_info_t* info, const uint8_t* data, int length) {
+      relayReceived(data, length);
+    }
+};
+
+// Call from setup()
+void setupRelay() {
+  if (relayRole == RELAY_OFF) {
+    return;
+  }
+
+  relayQueue = xQueueCreate(8, sizeof(RelayInbound));
+  relayTransport = new EspNowTransport();
+  if (!relayQueue || !relayTransport->begin()) {
+    Serial.println("Relay: transport failed to start");
+    relayTransport = nullptr;
+    return;
+  }
+  relayBootId = esp_random() | 1;
+
+  Serial.print("Relay: ");
+  Serial.print(relayRole == RELAY_MASTER ? "master" : "slave");
+  Serial.print(" on channel ");
+  Serial.println(relayChannel);
+}
+
+// One trigger as the master sends it, sentMicros is stamped per copy
+RelayMessage relayMessage(RemoteAction action, uint32_t bootId, uint32_t seq) {
+  RelayMessage message;
+  message.magic = RELAY_MAGIC;
+  message.version = RELAY_VERSION;
+  message.action = action;
+  memcpy(message.group, relayGroup, sizeof(message.group));
+  message.bootId = bootId;
+  message.seq = seq;
+  message.sentMicros = 0;
+  return message;
+}
+
+// Called before a local trigger runs, forwards it when this remote is the master
+void relayTrigger(RemoteAction action) {
+  if (relayRole != RELAY_MASTER || !relayTransport) {
+    return;
+  }
+
+  RelayMessage message = relayMessage(action, relayBootId, ++relaySeq);
+
+  // Broadcasts are not acknowledged, so send a few copies
+  for (int i = 0; i < relayRepeats; i++) {
+    message.sentMicros = micros();
+    relayTransport->send((const uint8_t*)&message, sizeof(message));
+  }
+  relayStats.sent++;
+}
+
+// True when a received message should fire, nowMicros is the receiver's clock when it is handled
+bool relayAccept(RelayReceiver &receiver, RelayStats &stats, const RelayInbound &inbound, uint32_t nowMicros) {
+  const RelayMessage &message = inbound.message;
+  if (message.magic != RELAY_MAGIC || message.version != RELAY_VERSION ||
+      memcmp(message.group, relayGroup, sizeof(message.group)) != 0 || message.action > ACTION_MACRO_4) {
+    stats.rejected++;
+    return false;
+  }
+  stats.received++;
+
+  // A new master boot brings new sequence numbers and a new clock
+  if (message.bootId != receiver.lastBootId) {
+    receiver.lastBootId = message.bootId;
+    receiver.lastSeq = message.seq - 1;
+    receiver.transitKnown = false;
+  }
+
+  // The clocks are not synchronised, delay is measured over the quickest delivery
+  // seen. Every copy is a sample, and the floor creeps up to follow clock drift.
+  int32_t transit = (int32_t)(inbound.rxMicros - message.sentMicros);
+  if (!receiver.transitKnown || transit < stats.minTransitUs) {
+    stats.minTransitUs = transit;
+    receiver.transitKnown = true;
+  }
+  uint32_t delayUs = (uint32_t)(transit - stats.minTransitUs) + (nowMicros - inbound.rxMicros);
+  stats.minTransitUs += (transit - stats.minTransitUs) / 16;
+
+  // Repeats and replays carry a sequence number already seen
+  if ((int32_t)(message.seq - receiver.lastSeq) <= 0) {
+    stats.duplicates++;
+    return false;
+  }
+  receiver.lastSeq = message.seq;
+
+  stats.jitterAvgUs += ((int32_t)delayUs - (int32_t)stats.jitterAvgUs) / 8;
+  if (delayUs > stats.jitterMaxUs) {
+    stats.jitterMaxUs = delayUs;
+  }
+  if (delayUs > relayMaxAge * 1000) {
+    stats.stale++;
+    Serial.printf("Relay: dropped %s, %lums late\n", remoteActionName((RemoteAction)message.action),
+                  (unsigned long)(delayUs / 1000));
+    return false;
+  }
+
+  Serial.printf("Relay: %s #%lu, %luus late\n", remoteActionName((RemoteAction)message.action),
+                (unsigned long)message.seq, (unsigned long)delayUs);
+  stats.fired++;
+  return true;
+}
+
+// Call from loop(), runs triggers forwarded by the master
+void pollRelayMessages() {
+  if (relayRole != RELAY_SLAVE || !relayQueue) {
+    return;
+  }
+
+  RelayInbound inbound;
+  while (xQueueReceive(relayQueue, &inbound, 0) == pdTRUE) {
+    if (relayAccept(relayReceiver, relayStats, inbound, micros())) {
+      runRemoteAction((RemoteAction)inbound.message.action);
+    }
+  }
+}
+
+#endif // RELAY_H
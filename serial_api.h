@@ -0,0 +1,455 @@
+/*
+ * serial_api.h
+ * Line protocol on USB serial for host-side triggering and state queries
+ *
+ * Request:  <VERB> [tag]\n    VERB = SHUTTER MODE SCREEN SLEEP WAKE PAIR STATE GPS IMU SIGS BOOT MEM LINK ACKS SOAK RIG MACROS LOOP JOURNAL RELAY NAV MODES PING
+ *           LABEL <tag> <entry> <name>\n  names a learned mode signature
+ *           FORGET <tag> <entry>\n  removes a camera from the wake rig
+ *           MACRO <tag> <n> <steps>\n  stores macro n (1-4), e.g. MACRO - 1 MODE ACK SHUTTER WAIT=500 SCREEN
+ *           RUN <tag> <n>\n         runs macro n
+ *           GOTO <tag> <mode>\n     presses MODE until the camera reports a signature entry or label
+ *           Verbs with arguments take the tag first, send - for no tag.
+ * Replies start with '@' so they can be told apart from log output. Every request ends with
+ *   @OK <VERB> <tag> [fields] rx=<us> tx=<us>
+ *   @ERR <VERB> <tag> <reason>
+ * after any of these detail lines:
+ *   @STATE <tag> rx=<us> connected=<0|1> pairing=<0|1> mode="<mode>" battery=<level> link=<quality> camera="<name>"
+ *   @GPS <tag> bytes=<n> sentences=<n> errors=<n> fixes=<n> parse=<us> parse_max=<us> fix=<0|2|3> lat=<deg*1e7> lon=<deg*1e7>
+ *        sats=<n> age=<ms|-1> sent=<n> dropped=<n> latency_avg=<us> latency_max=<us>
+ *        (the last four stay 0 unless GPS_STREAM_EXPERIMENTAL is defined)
+ *   @LINK <tag> profile=<name> interval_us=<us> latency=<n> timeout_ms=<ms> notify_avg=<us> notify_max=<us> hb_mean=<ms> hb_dev=<ms> adv_switch_us=<us>
+ *   @ACK <tag> <command> sent=<n> answered=<n> retries=<n> timeouts=<n> ack_avg=<us>  (one per command, then @OK ACKS)
+ *   @SOAK <tag> uptime=<s> connects=<n> disconnects=<n> lost=<n> ack_hist=<n,...>  (buckets <16,<32,...,>=1024 ms)
+ *   @CAM <tag> <entry> name="<name>" address=<addr> awake=<0|1> after=<ms>  (one per rig camera, then @OK RIG <tag> all_connected=<ms|-1>)
+ *   @MACRO <tag> <n> steps="<steps>"  (one per macro, then @OK MACROS <tag> last=<n|-1> last_ok=<0|1> last_ms=<ms>)
+ *   @LOOP <tag> <phase> count=<n> avg=<us> max=<us> hist=<n,...>  (buckets <32,<64,...,>=65536 us)
+ *   @STALL <tag> at=<ms> pass=<us> phase=<phase> phase_us=<us> caught=<0|1>  (latest stalls, then @OK LOOP <tag> stalls=<n>;
+ *          caught=1 when the watchdog saw the pass running, phase is then where it was stuck)
+ *   @REC <tag> seq=<n> session=<n> t=<ms> cmd=<command> camera=<entry|-1> status=<status> rssi=<dBm>  (newest records, oldest first,
+ *        then @OK JOURNAL <tag> records=<n> dropped=<n> flushes=<n> bytes=<n> erases=<n> torn=<n>)
+ *   @RELAY <tag> role=<off|master|slave> sent=<n> received=<n> duplicates=<n> stale=<n> rejected=<n> fired=<n> jitter_avg=<us> jitter_max=<us>
+ *   @NAV <tag> <screen> cached=<0|1> count=<n> last=<us> avg=<us> max=<us>  (button B time to show each screen,
+ *        then @OK NAV <tag> cache_bytes=<n>)
+ *   @CYCLE <tag> <entry> label="<name>" next=<entry|-1>  (learned MODE press order, then @OK MODES <tag> reached=<n>
+ *        failed=<n> relearned=<n> last_steps=<n> last_ms=<ms> step_avg=<ms>)
+ *   @SIG <tag> <entry> model=<prefix> bytes=<hex> builtin=<0|1> label="<name>"  (one per signature, then @OK SIGS)
+ *   @IMU <tag> samples=<n> overruns=<n> read=<us> cost=<us> taps=<n> flicks=<n> stills=<n> latency=<us>
+ * rx is micros() when the line ended, tx is micros() when the BLE frame was
+ * handed to the stack (or when the reply was written for non-BLE verbs).
+ */
+
+#ifndef SERIAL_API_H
+#define SERIAL_API_H
+
+#define SERIAL_API_LINE_MAX 256     // Room for MACRO <tag> <n> with every step of a macro
+
+// Line assembly state, filled byte by byte without allocations
+char serialLine[SERIAL_API_LINE_MAX];
+int serialLineLength = 0;
+bool serialLineOverflow = false;
+
+struct SerialVerb {
+  const char* name;
+  RemoteAction action;
+  bool needsConnection;
+};
+
+const SerialVerb serialVerbs[] = {
+  {"SHUTTER", ACTION_SHUTTER,    true},
+  {"MODE",    ACTION_MODE,       true},
+  {"SCREEN",  ACTION_SCREEN_OFF, true},
+  {"SLEEP",   ACTION_SLEEP,      true},
+  {"WAKE",    ACTION_WAKE,       false},
+};
+
+void serialReplyError(const char* verb, const char* tag, const char* reason) {
+  Serial.printf("@ERR %s %s %s\n", verb, tag, reason);
+}
+
+// Verbs with arguments take them after the tag: ends the tag in place and returns the arguments
+char* serialArgs(char* tag) {
+  char* args = tag;
+  while (*args && *args != ' ') {
+    args++;
+  }
+  if (*args) {
+    *args++ = '\0';
+    while (*args == ' ') {
+      args++;
+    }
+  }
+  return args;
+}
+
+void serialReplyState(const char* tag, unsigned long rxMicros) {
+  Serial.printf("@STATE %s rx=%lu connected=%d pairing=%d mode=\"%s\" battery=%d link=%d camera=\"%s\"\n",
+                tag, rxMicros, deviceConnected ? 1 : 0, pairingMode ? 1 : 0, mode_str,
+                battery.level, linkHealth.quality, currentCamera.isValid ? currentCamera.name : "-");
+}
+
+// Split "VERB tag" in place: ends the verb and returns the tag, which runs to the end of the line
+char* serialSplitVerb(char* line, char** verbOut) {
+  char* verb = line;
+  while (*verb == ' ') {
+    verb++;
+  }
+  *verbOut = verb;
+
+  char* tag = verb;
+  while (*tag && *tag != ' ') {
+    tag++;
+  }
+  if (*tag) {
+    *tag++ = '\0';
+    while (*tag == ' ') {
+      tag++;
+    }
+  }
+  if (*tag == '\0') {
+    tag = (char*)"-";
+  }
+  return tag;
+}
+
+void handleSerialLine(char* line, unsigned long rxMicros) {
+  char* verb;
+  char* tag = serialSplitVerb(line, &verb);
+
+  if (strcasecmp(verb, "PING") == 0) {
+    Serial.printf("@OK PING %s rx=%lu tx=%lu\n", tag, rxMicros, micros());
+    return;
+  }
+
+  if (strcasecmp(verb, "STATE") == 0) {
+    serialReplyState(tag, rxMicros);
+    Serial.printf("@OK STATE %s rx=%lu tx=%lu\n", tag, rxMicros, micros());
+    return;
+  }
+
+  if (strcasecmp(verb, "GPS") == 0) {
+    Serial.printf("@GPS %s bytes=%lu sentences=%lu errors=%lu fixes=%lu parse=%lu parse_max=%lu fix=%u lat=%ld lon=%ld sats=%u age=%ld "
+                  "sent=%lu dropped=%lu latency_avg=%lu latency_max=%lu\n",
+                  tag, (unsigned long)gpsStats.bytes, (unsigned long)gpsStats.sentences,
+                  (unsigned long)gpsStats.checksumErrors, (unsigned long)gpsStats.fixes,
+                  (unsigned long)gpsStats.parseUs, (unsigned long)gpsStats.parseMaxUs, gpsFix.fixType,
+                  (long)gpsFix.latE7, (long)gpsFix.lonE7, gpsFix.sats,
+                  gpsStats.fixes ? (long)((micros() - gpsFix.rxMicros) / 1000) : -1L,
+                  (unsigned long)gpsStats.sent, (unsigned long)gpsStats.dropped,
+                  (unsigned long)gpsStats.latencyAvgUs, (unsigned long)gpsStats.latencyMaxUs);
+    Serial.printf("@OK GPS %s rx=%lu tx=%lu\n", tag, rxMicros, micros());
+    return;
+  }
+
+  if (strcasecmp(verb, "IMU") == 0) {
+    Serial.printf("@IMU %s samples=%lu overruns=%lu read=%lu cost=%lu taps=%lu flicks=%lu stills=%lu latency=%lu\n",
+                  tag, (unsigned long)motionStats.samples, (unsigned long)motionStats.overruns,
+                  (unsigned long)motionStats.readUsAvg, (unsigned long)motionStats.costUsAvg,
+                  (unsigned long)motionStats.events[GESTURE_DOUBLE_TAP],
+                  (unsigned long)motionStats.events[GESTURE_FLICK],
+                  (unsigned long)motionStats.events[GESTURE_STILL],
+                  (unsigned long)motionStats.lastLatencyUs);
+    Serial.printf("@OK IMU %s rx=%lu tx=%lu\n", tag, rxMicros, micros());
+    return;
+  }
+
+  if (strcasecmp(verb, "BOOT") == 0) {
+    printBootReport();
+    Serial.printf("@OK BOOT %s rx=%lu tx=%lu\n", tag, rxMicros, micros());
+    return;
+  }
+
+  if (strcasecmp(verb, "LINK") == 0) {
+    Serial.printf("@LINK %s profile=%s interval_us=%u latency=%u timeout_ms=%u notify_avg=%lu notify_max=%lu hb_mean=%ld hb_dev=%ld adv_switch_us=%lu\n",
+                  tag, linkProfileName(linkParams.profile), linkParams.interval * 1250, linkParams.latency,
+                  linkParams.timeout * 10, (unsigned long)linkParams.notifyAvgUs,
+                  (unsigned long)linkParams.notifyMaxUs, linkHealth.meanX8 >> 3, linkHealth.devX4 >> 2,
+                  (unsigned long)advSwitchUs);
+    Serial.printf("@OK LINK %s rx=%lu tx=%lu\n", tag, rxMicros, micros());
+    return;
+  }
+
+  if (strcasecmp(verb, "ACKS") == 0) {
+    for (int a = 0; a < NUM_REMOTE_ACTIONS; a++) {
+      const CommandAckStats &stats = commandAckStats[a];
+      Serial.printf("@ACK %s %s sent=%lu answered=%lu retries=%lu timeouts=%lu ack_avg=%lu\n", tag,
+                    remoteActionName((RemoteAction)a), (unsigned long)stats.sent,
+                    (unsigned long)stats.answered, (unsigned long)stats.retries,
+                    (unsigned long)stats.timeouts, (unsigned long)stats.ackAvgUs);
+    }
+    Serial.printf("@OK ACKS %s rx=%lu tx=%lu\n", tag, rxMicros, micros());
+    return;
+  }
+
+  if (strcasecmp(verb, "SOAK") == 0) {
+    Serial.printf("@SOAK %s uptime=%lu connects=%lu disconnects=%lu lost=%lu ack_hist=", tag,
+                  millis() / 1000, (unsigned long)connectCount, (unsigned long)disconnectCount,
+                  (unsigned long)lostCommandCount());
+    for (int b = 0; b < ACK_HISTOGRAM_BUCKETS; b++) {
+      Serial.printf(b ? ",%lu" : "%lu", (unsigned long)ackHistogram[b]);
+    }
+    Serial.println();
+    Serial.printf("@OK SOAK %s rx=%lu tx=%lu\n", tag, rxMicros, micros());
+    return;
+  }
+
+  if (strcasecmp(verb, "LOOP") == 0) {
+    for (int p = 0; p < NUM_LOOP_PHASES; p++) {
+      const LoopPhaseStats &stats = loopPhaseStats[p];
+      Serial.printf("@LOOP %s %s count=%lu avg=%lu max=%lu hist=", tag, loopPhaseNames[p],
+                    (unsigned long)stats.count, (unsigned long)stats.avgUs, (unsigned long)stats.maxUs);
+      for (int b = 0; b < LOOP_HISTOGRAM_BUCKETS; b++) {
+        Serial.printf(b ? ",%lu" : "%lu", (unsigned long)stats.histogram[b]);
+      }
+      Serial.println();
+    }
+    uint32_t first = loopStallCount > LOOP_STALL_LOG_SIZE ? loopStallCount - LOOP_STALL_LOG_SIZE : 0;
+    for (uint32_t i = first; i < loopStallCount; i++) {
+      const LoopStall &stall = loopStalls[i % LOOP_STALL_LOG_SIZE];
+      Serial.printf("@STALL %s at=%lu pass=%lu phase=%s phase_us=%lu caught=%d\n", tag, (unsigned long)stall.atMs,
+                    (unsigned long)stall.passUs, loopPhaseNames[stall.phase], (unsigned long)stall.phaseUs,
+                    stall.caught ? 1 : 0);
+    }
+    Serial.printf("@OK LOOP %s stalls=%lu rx=%lu tx=%lu\n", tag, (unsigned long)loopStallCount, rxMicros, micros());
+    return;
+  }
+
+  if (strcasecmp(verb, "NAV") == 0) {
+    for (int i = 0; i < NUM_SCREENS; i++) {
+      const ScreenNavStats &stats = screenNavStats[i];
+      Serial.printf("@NAV %s %s cached=%d count=%lu last=%lu avg=%lu max=%lu\n", tag, screenFaces[i].label,
+                    screenCached[i] ? 1 : 0, (unsigned long)stats.count, (unsigned long)stats.lastUs,
+                    (unsigned long)(stats.count ? stats.totalUs / stats.count : 0), (unsigned long)stats.maxUs);
+    }
+    Serial.printf("@OK NAV %s cache_bytes=%u rx=%lu tx=%lu\n", tag, (unsigned)screenCacheBytes, rxMicros, micros());
+    return;
+  }
+
+  if (strcasecmp(verb, "JOURNAL") == 0) {
+    if (!journalPartition) {
+      serialReplyError("JOURNAL", tag, "NO_PARTITION");
+      return;
+    }
+    flushJournal();
+    JournalRecord record;
+    for (uint32_t slot = journalExportStart(journalExportMax); slot != journalWriteSlot; slot = (slot + 1) % journalSlots) {
+      if (!readJournalSlot(slot, record)) {
+        continue;
+      }
+      Serial.printf("@REC %s seq=%lu session=%u t=%lu cmd=%s camera=%d status=%s rssi=%d\n", tag,
+                    (unsigned long)record.seq, record.session, (unsigned long)record.timeMs,
+                    remoteActionName((RemoteAction)record.action), record.camera == 0xFF ? -1 : record.camera,
+                    record.status <= JOURNAL_SUPERSEDED ? journalStatusNames[record.status] : "?", record.rssi);
+    }
+    Serial.printf("@OK JOURNAL %s records=%lu dropped=%lu flushes=%lu bytes=%lu erases=%lu torn=%lu rx=%lu tx=%lu\n", tag,
+                  (unsigned long)journalStats.records, (unsigned long)journalStats.dropped,
+                  (unsigned long)journalStats.flushes, (unsigned long)journalStats.bytesWritten,
+                  (unsigned long)journalStats.erases, (unsigned long)journalStats.torn, rxMicros, micros());
+    return;
+  }
+
+  if (strcasecmp(verb, "RELAY") == 0) {
+    Serial.printf("@RELAY %s role=%s sent=%lu received=%lu duplicates=%lu stale=%lu rejected=%lu fired=%lu jitter_avg=%lu jitter_max=%lu\n",
+                  tag, relayRole == RELAY_MASTER ? "master" : (relayRole == RELAY_SLAVE ? "slave" : "off"),
+                  (unsigned long)relayStats.sent, (unsigned long)relayStats.received,
+                  (unsigned long)relayStats.duplicates, (unsigned long)relayStats.stale,
+                  (unsigned long)relayStats.rejected, (unsigned long)relayStats.fired,
+                  (unsigned long)relayStats.jitterAvgUs, (unsigned long)relayStats.jitterMaxUs);
+    Serial.printf("@OK RELAY %s rx=%lu tx=%lu\n", tag, rxMicros, micros());
+    return;
+  }
+
+  if (strcasecmp(verb, "MEM") == 0) {
+    printMemoryReport();
+    Serial.printf("@OK MEM %s rx=%lu tx=%lu\n", tag, rxMicros, micros());
+    return;
+  }
+
+  if (strcasecmp(verb, "SIGS") == 0) {
+    for (int e = 0; e < NUM_BUILTIN_SIGS + numLearnedSigs; e++) {
+      const ModeSignature* sig = modeSignatureEntry(e);
+      Serial.printf("@SIG %s %d model=%s bytes=%02X%02X%02X%02X%02X builtin=%d label=\"%s\"\n", tag, e,
+                    sig->model < NUM_MODELS ? cameraModelPrefixes[sig->model] : "?",
+                    sig->sig[0], sig->sig[1], sig->sig[2], sig->sig[3], sig->sig[4],
+                    e < NUM_BUILTIN_SIGS ? 1 : 0, sig->label);
+    }
+    Serial.printf("@OK SIGS %s rx=%lu tx=%lu\n", tag, rxMicros, micros());
+    return;
+  }
+
+  if (strcasecmp(verb, "LABEL") == 0) {
+    char* args = serialArgs(tag);
+    char* name = args;
+    int entry = (int)strtol(args, &name, 10);
+    while (*name == ' ') {
+      name++;
+    }
+    if (name == args || *name == '\0' || !labelModeSignature(entry, name)) {
+      serialReplyError("LABEL", tag, "BAD_ENTRY");
+      return;
+    }
+    Serial.printf("@OK LABEL %s entry=%d rx=%lu tx=%lu\n", tag, entry, rxMicros, micros());
+    return;
+  }
+
+  if (strcasecmp(verb, "RIG") == 0) {
+    uint8_t connectedMask = rigConnectedMask;
+    for (int i = 0; i < rigCameraCount; i++) {
+      bool awake = connectedMask & (1 << i);
+      Serial.printf("@CAM %s %d name=\"%s\" address=%s awake=%d after=%lu\n", tag, i,
+                    rigCameras[i].name, rigCameras[i].address, awake ? 1 : 0,
+                    awake ? rigConnectedAt[i] : 0UL);
+    }
+    Serial.printf("@OK RIG %s all_connected=%ld rx=%lu tx=%lu\n", tag, wakeAllConnectedMs, rxMicros, micros());
+    return;
+  }
+
+  if (strcasecmp(verb, "FORGET") == 0) {
+    char* args = serialArgs(tag);
+    char* end = args;
+    int entry = (int)strtol(args, &end, 10);
+    if (end == args || !forgetRigCamera(entry)) {
+      serialReplyError("FORGET", tag, "BAD_ENTRY");
+      return;
+    }
+    Serial.printf("@OK FORGET %s entry=%d rx=%lu tx=%lu\n", tag, entry, rxMicros, micros());
+    return;
+  }
+
+  if (strcasecmp(verb, "MACROS") == 0) {
+    for (int m = 0; m < NUM_MACROS; m++) {
+      Serial.printf("@MACRO %s %d steps=\"", tag, m + 1);
+      printMacro(macros[m]);
+      Serial.println("\"");
+    }
+    Serial.printf("@OK MACROS %s last=%d last_ok=%d last_ms=%lu rx=%lu tx=%lu\n", tag, macroStats.last + 1,
+                  macroStats.lastCompleted ? 1 : 0, macroStats.lastMs, rxMicros, micros());
+    return;
+  }
+
+  if (strcasecmp(verb, "MACRO") == 0) {
+    char* args = serialArgs(tag);
+    char* steps = args;
+    int macro = (int)strtol(args, &steps, 10);
+    if (steps == args || !storeMacro(macro - 1, steps)) {
+      serialReplyError("MACRO", tag, "BAD_MACRO");
+      return;
+    }
+    Serial.printf("@OK MACRO %s macro=%d rx=%lu tx=%lu\n", tag, macro, rxMicros, micros());
+    return;
+  }
+
+  if (strcasecmp(verb, "RUN") == 0) {
+    char* args = serialArgs(tag);
+    char* end = args;
+    int macro = (int)strtol(args, &end, 10);
+    if (end == args || macro < 1 || macro > NUM_MACROS) {
+      serialReplyError("RUN", tag, "BAD_MACRO");
+      return;
+    }
+    if (runningMacro >= 0 || modeSelect.active) {
+      serialReplyError("RUN", tag, "BUSY");
+      return;
+    }
+    runMacro(macro - 1);
+    Serial.printf("@OK RUN %s macro=%d rx=%lu tx=%lu\n", tag, macro, rxMicros, micros());
+    return;
+  }
+
+  if (strcasecmp(verb, "GOTO") == 0) {
+    char* mode = serialArgs(tag);
+    int target = *mode ? findModeEntry(mode) : -1;
+    if (target < 0) {
+      serialReplyError("GOTO", tag, "BAD_MODE");
+      return;
+    }
+    if (!deviceConnected) {
+      serialReplyError("GOTO", tag, "NOT_CONNECTED");
+      return;
+    }
+    if (!startModeSelect(target)) {
+      serialReplyError("GOTO", tag, "BUSY");
+      return;
+    }
+    Serial.printf("@OK GOTO %s entry=%d predicted=%d rx=%lu tx=%lu\n", tag, target, modeSelect.predicted, rxMicros, micros());
+    return;
+  }
+
+  if (strcasecmp(verb, "MODES") == 0) {
+    for (int e = 0; e < NUM_BUILTIN_SIGS + numLearnedSigs; e++) {
+      Serial.printf("@CYCLE %s %d label=\"%s\" next=%d\n", tag, e, modeSignatureEntry(e)->label, modeCycleNext[e]);
+    }
+    const ModeSelectStats &stats = modeSelectStats;
+    Serial.printf("@OK MODES %s reached=%lu failed=%lu relearned=%lu last_steps=%d last_ms=%lu step_avg=%lu rx=%lu tx=%lu\n",
+                  tag, (unsigned long)stats.reached, (unsigned long)stats.failed, (unsigned long)stats.relearned,
+                  stats.lastSteps, stats.lastMs, stats.stepAvgMs, rxMicros, micros());
+    return;
+  }
+
+  if (strcasecmp(verb, "PAIR") == 0) {
+    if (pairingMode) {
+      serialReplyError("PAIR", tag, "BUSY");
+      return;
+    }
+    connectNewCamera();
+    Serial.printf("@OK PAIR %s rx=%lu tx=%lu\n", tag, rxMicros, micros());
+    return;
+  }
+
+  for (const SerialVerb &v : serialVerbs) {
+    if (strcasecmp(verb, v.name) != 0) {
+      continue;
+    }
+
+    if (v.needsConnection && !deviceConnected) {
+      serialReplyError(v.name, tag, "NOT_CONNECTED");
+      return;
+    }
+    if (v.action == ACTION_WAKE && rigCameraCount == 0) {
+      serialReplyError(v.name, tag, "NO_CAMERA");
+      return;
+    }
+
+    unsigned long txBefore = lastCommandTxMicros;
+    runRemoteAction(v.action);
+    unsigned long tx = (lastCommandTxMicros != txBefore) ? lastCommandTxMicros : micros();
+    Serial.printf("@OK %s %s rx=%lu tx=%lu\n", v.name, tag, rxMicros, tx);
+    return;
+  }
+
+  serialReplyError(verb, tag, "UNKNOWN_VERB");
+}
+
+// Runs on the UART event task after a burst of bytes, wakes loop() so a command waits for no pass
+void serialReceived() {
+  wakeLoop();
+}
+
+// Call from loop(), consumes whatever bytes have arrived
+void pollSerialCommands() {
+  while (Serial.available() > 0) {
+    char c = (char)Serial.read();
+
+    if (c == '\n' || c == '\r') {
+      unsigned long rxMicros = micros();
+      if (serialLineOverflow) {
+        // The start of the line is kept, so the reply still carries its verb and tag
+        serialLine[serialLineLength] = '\0';
+        char* verb;
+        char* tag = serialSplitVerb(serialLine, &verb);
+        serialArgs(tag);
+        serialReplyError(verb, tag, "LINE_TOO_LONG");
+      } else if (serialLineLength > 0) {
+        serialLine[serialLineLength] = '\0';
+        handleSerialLine(serialLine, rxMicros);
+      }
+      serialLineLength = 0;
+      serialLineOverflow = false;
+    } else if (serialLineLength < SERIAL_API_LINE_MAX - 1) {
+      serialLine[serialLineLength++] = c;
+    } else {
+      serialLineOverflow = true;
+    }
+  }
+}
+
+#endif // SERIAL_API_H
@@ -0,0 +1,95 @@
+/*
+ * ack_test.cpp
+ * Command acknowledgement against a simulated camera: which frames count as an answer, and resends
+ */
+
+#include <Arduino.h>
+#include "../insta360_m5StickC_remote.ino"
+#include "host/host_sim.h"
+#include "camera_sim.h"
+
+static const CommandAckStats &ackStats(RemoteAction action) {
+  return commandAckStats[action];
+}
+
+// Sends one command and runs until it resolves, the timeout included
+static void runCommand(RemoteAction action) {
+  runRemoteAction(action);
+  hostRunFor(3 * commandAckTimeout + 100);
+}
+
+static void testAnswered() {
+  runCommand(ACTION_SHUTTER);
+  CHECK(ackStats(ACTION_SHUTTER).answered == 1);
+  CHECK(ackStats(ACTION_SHUTTER).retries == 0);
+
+  runCommand(ACTION_MODE);
+  CHECK(ackStats(ACTION_MODE).answered == 1);
+  CHECK(lastCommandAnswered);
+}
+
+// Heartbeats and mode reports are not an answer to the shutter, an answer to another command is
+static void testOtherFramesDoNotAnswer() {
+  uint32_t commands = hostCamera.commands;
+  hostCamera.loseAnswers = 1;
+  runRemoteAction(ACTION_SHUTTER);
+  hostRunFor(50);
+  hostBleWrite(HEARTBEAT, sizeof(HEARTBEAT));
+  hostCameraWriteMode();
+  hostRunFor(3 * commandAckTimeout);
+
+  CHECK(ackStats(ACTION_SHUTTER).answered == 1);
+  CHECK(ackStats(ACTION_SHUTTER).timeouts == 1);
+  CHECK(hostCamera.commands == commands + 1);   // Never resent
+  CHECK(!lastCommandAnswered);
+
+  // Answers are not matched to their command: a late screen answer resolves the shutter
+  // whose own answer was lost. ACKS counts it as answered, not as a shutter that fired.
+  hostCamera.loseAnswers = 1;
+  runRemoteAction(ACTION_SHUTTER);
+  hostRunFor(50);
+  hostCameraWriteAnswer(TOGGLE_SCREEN_CMD);
+  hostRunFor(3 * commandAckTimeout);
+  CHECK(ackStats(ACTION_SHUTTER).answered == 2);
+  CHECK(ackStats(ACTION_SHUTTER).timeouts == 1);
+  CHECK(hostCamera.commands == commands + 2);
+
+  // A command answer does not stand in for the mode report MODE waits for
+  hostCamera.loseAnswers = 1;
+  runRemoteAction(ACTION_MODE);
+  hostRunFor(50);
+  hostCameraWriteAnswer(SHUTTER_CMD);
+  hostRunFor(3 * commandAckTimeout);
+  CHECK(ackStats(ACTION_MODE).answered == 1);
+  CHECK(ackStats(ACTION_MODE).timeouts == 1);
+  CHECK(ackStats(ACTION_MODE).retries == 0);
+  CHECK(hostCamera.commands == commands + 3);
+}
+
+// Sleep is resent until the camera drops the link, which is its answer
+static void testSleep() {
+  uint32_t commands = hostCamera.commands;
+  hostCamera.loseAnswers = 2;
+  runCommand(ACTION_SLEEP);
+
+  printf("sleep: %u transmits, answered=%u retries=%u timeouts=%u\n", (unsigned)(hostCamera.commands - commands),
+         (unsigned)ackStats(ACTION_SLEEP).answered, (unsigned)ackStats(ACTION_SLEEP).retries,
+         (unsigned)ackStats(ACTION_SLEEP).timeouts);
+  CHECK(hostCamera.commands == commands + 3);
+  CHECK(ackStats(ACTION_SLEEP).retries == 2);
+  CHECK(ackStats(ACTION_SLEEP).answered == 1);
+  CHECK(ackStats(ACTION_SLEEP).timeouts == 0);
+  CHECK(hostCamera.asleep && !hostBle.connected);
+}
+
+int main() {
+  hostCameraPair();
+  setup();
+  hostCameraConnect();
+  hostRunFor(1000);
+
+  testAnswered();
+  testOtherFramesDoNotAnswer();
+  testSleep();
+  return hostTestResult("ack_test");
+}
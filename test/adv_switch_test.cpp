@@ -0,0 +1,90 @@
+/*
+ * adv_switch_test.cpp
+ * Normal/wake advertising switches: what the caller pays, and advertising staying on air
+ *
+ * A switch should only hand the prebuilt payload to the stack: no sleep, no
+ * wait for the controller and no stop and restart of advertising, whatever the
+ * controller's own time to take the data (advSetLatencyUs on the stand-in).
+ * That time is the controller's, the remote only reports it as adv_switch_us
+ * in LINK.
+ */
+
+#include <Arduino.h>
+#include "../insta360_m5StickC_remote.ino"
+#include "host/host_sim.h"
+
+static const uint8_t rigWakePayloads[3][6] = {
+  {0x31, 0x41, 0x42, 0x43, 0x44, 0x45},
+  {0x32, 0x41, 0x42, 0x43, 0x44, 0x45},
+  {0x33, 0x41, 0x42, 0x43, 0x44, 0x45},
+};
+
+static std::vector<double> callerWallUs;
+
+// One switch: the caller returns without sleeping or touching advertising on/off,
+// and the payload is on air once the controller has taken it
+static void timeSwitch(AdvPayload* expected, void (*doSwitch)(int), int camera) {
+  uint64_t start = hostNowUs;
+  uint32_t sleeps = hostSleeps;
+  uint32_t starts = hostBle.advStarts;
+  uint32_t stops = hostBle.advStops;
+
+  double wallStart = hostWallUs();
+  doSwitch(camera);
+  callerWallUs.push_back(hostWallUs() - wallStart);
+
+  CHECK(hostNowUs == start);
+  CHECK(hostSleeps == sleeps);
+  CHECK(hostBle.advertising);
+
+  hostRunFor(5);
+  CHECK(hostBle.advertising);
+  CHECK(hostBle.advData == std::string((const char*)expected->data, expected->length));
+  CHECK(hostBle.advStarts == starts);
+  CHECK(hostBle.advStops == stops);
+}
+
+static void switchToWake(int camera) {
+  setWakeAdvertising((uint8_t*)rigWakePayloads[camera]);
+}
+
+static void switchToNormal(int camera) {
+  setNormalAdvertising();
+}
+
+int main() {
+  for (int i = 0; i < 3; i++) {
+    char name[16];
+    snprintf(name, sizeof(name), "X5 %dABCDE", i + 1);
+    registerRigCamera(name, "24:0a:c4:11:22:33", rigWakePayloads[i]);
+  }
+  setup();
+  hostRunFor(100);
+  CHECK(hostBle.advertising);
+  CHECK(wakeAdvCount == 3);
+
+  const uint64_t latencies[] = {300, 800, 2500};
+  for (uint64_t latency : latencies) {
+    hostBle.advSetLatencyUs = latency;
+    callerWallUs.clear();
+    for (int round = 0; round < 20; round++) {
+      int camera = round % 3;
+      timeSwitch(wakeAdvPayloadFor(rigWakePayloads[camera]), switchToWake, camera);
+      timeSwitch(&normalAdvPayload, switchToNormal, 0);
+    }
+    printf("controller %4lluus: caller p50 %.1fus max %.1fus of host CPU, no sleep, advertising never stopped\n",
+           (unsigned long long)latency, hostPercentile(callerWallUs, 50), hostPercentile(callerWallUs, 100));
+    CHECK(hostPercentile(callerWallUs, 50) < 100);
+  }
+
+  // The payloads were encoded once at setup, not per switch
+  CHECK(wakeAdvCount == 3);
+
+  // The controller's time is reported, not judged
+  hostSerialTake();
+  hostSerialInput("LINK l1\n");
+  hostRunFor(100);
+  CHECK(hostSerialTake().find(" adv_switch_us=") != std::string::npos);
+
+  return hostTestResult("adv_switch_test");
+}
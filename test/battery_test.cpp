@@ -0,0 +1,96 @@
+/*
+ * battery_test.cpp
+ * Battery sampler against a synthetic discharge curve, and its power IC read rate
+ */
+
+#include <Arduino.h>
+#include "../insta360_m5StickC_remote.ino"
+#include "host/host_sim.h"
+
+// LiPo-like curve: quick drop from full, long plateau, knee near empty
+static double dischargeLevel(double fraction) {
+  if (fraction < 0.1) {
+    return 100 - 100 * fraction;
+  }
+  if (fraction < 0.85) {
+    return 90 - (fraction - 0.1) / 0.75 * 70;
+  }
+  return max(0.0, 20 - (fraction - 0.85) / 0.15 * 20);
+}
+
+static void testBoardWithoutFuelGauge() {
+  M5.Power.level = -1;
+  setup();
+  uint32_t readsAfterSetup = M5.Power.levelReads;
+
+  hostRunFor(60000);
+
+  uint32_t reads = M5.Power.levelReads - readsAfterSetup;
+  printf("no fuel gauge: %u power IC reads in 60s\n", (unsigned)reads);
+  CHECK(reads <= 60000 / batterySampleInterval + 1);
+  CHECK(battery.level == -1);
+}
+
+static void testSyntheticDischarge() {
+  const unsigned long runtimeMs = 4UL * 3600 * 1000;
+  const unsigned long start = 1000;
+  battery = {false, false, false, 0, -1, -1, 0, 0, 0, 0, 0};
+
+  srand(1);
+  int levelChanges = 0;
+  int lastLevel = -1;
+  int maxError = 0;
+  int rises = 0;
+  double worstEstimateError = 0;
+  double totalEstimateError = 0;
+  int estimates = 0;
+
+  for (unsigned long t = 0; t <= runtimeMs; t += batterySampleInterval) {
+    double trueLevel = dischargeLevel((double)t / runtimeMs);
+    int noise = rand() % 5 - 2;         // Gauge noise of +-2%
+    battery.dirty = false;
+    batteryAddSample(constrain((int)lround(trueLevel) + noise, 0, 100), false, start + t);
+
+    if (battery.dirty && battery.level != lastLevel) {
+      if (lastLevel >= 0 && battery.level > lastLevel) {
+        rises++;
+      }
+      levelChanges++;
+      lastLevel = battery.level;
+    }
+    if (t > 60000) {
+      maxError = max(maxError, abs(battery.level - (int)lround(trueLevel)));
+    }
+
+    // On the plateau the estimate is the level over the average rate
+    double fraction = (double)t / runtimeMs;
+    if (fraction > 0.3 && fraction < 0.8) {
+      double ratePerMin = 70.0 / (0.75 * runtimeMs / 60000.0);
+      double expectedMin = trueLevel / ratePerMin;
+      double error = fabs(battery.minutesRemaining - expectedMin) / expectedMin;
+      worstEstimateError = max(worstEstimateError, error);
+      totalEstimateError += error;
+      estimates++;
+    }
+  }
+
+  double meanEstimateError = totalEstimateError / max(estimates, 1);
+  printf("discharge: %d level changes, %d upticks, max error %d%%, runtime estimate error mean %.0f%% worst %.0f%%\n",
+         levelChanges, rises, maxError, meanEstimateError * 100, worstEstimateError * 100);
+  CHECK(maxError <= 4);
+  CHECK(rises == 0);
+  CHECK(levelChanges <= 101);
+  CHECK(meanEstimateError < 0.1);
+  CHECK(worstEstimateError < 0.5);
+
+  // Plugging in drops the estimate
+  batteryAddSample(5, true, start + runtimeMs + batterySampleInterval);
+  CHECK(battery.minutesRemaining == -1);
+  CHECK(battery.charging);
+}
+
+int main() {
+  testBoardWithoutFuelGauge();
+  testSyntheticDischarge();
+  return hostTestResult("battery_test");
+}
@@ -0,0 +1,170 @@
+/*
+ * camera_sim.h
+ * Simulated X5 on the far side of the BLE link: heartbeats, command answers, sleep and wake
+ *
+ * While connected the camera writes a heartbeat every heartbeatMs. MODE is
+ * answered with a mode report for the next mode in its cycle, power off by
+ * dropping the link and going to sleep, every other command with a short
+ * answer frame. Frames are written to the remote's write
+ * characteristic, so they go through the sketch's own onWrite().
+ *
+ * An awake camera connects reconnectMs after it sees the remote advertise, a
+ * sleeping one only when the remote's wake beacon carries its name suffix.
+ */
+
+#pragma once
+#include "host/host_sim.h"
+#include <random>
+
+struct HostCamera {
+  const char* name = "X5 1ABCDE";
+  const char* address = "24:0a:c4:11:22:33";
+  uint8_t bda[6] = {0x24, 0x0a, 0xc4, 0x11, 0x22, 0x33};
+
+  uint64_t answerUs = 12000;          // Command to answer
+  uint64_t answerJitterUs = 0;        // Plus up to this much
+  double answerLoss = 0;              // Chance an answer is lost on air
+  int loseAnswers = 0;                // Answers to leave out before the random losses
+  unsigned long heartbeatMs = 0;      // 0 for no heartbeats
+  unsigned long reconnectMs = 300;    // Remote seen advertising to connected
+  unsigned long wakeMs = 1200;        // Wake beacon seen to connected
+  bool heartbeatsStalled = false;     // Link up but heartbeats stop
+  int cycle[NUM_BUILTIN_SIGS] = {0, 1, 2};  // Builtin signature entries MODE steps through
+  int cycleLength = 3;
+  int mode = 0;                       // Index into cycle
+
+  bool asleep = false;
+  bool connectPending = false;
+  uint32_t generation = 0;            // Bumped per connection, stops the old heartbeat chain
+  std::mt19937 random{7};
+
+  uint32_t commands = 0;
+  uint32_t answers = 0;
+  uint32_t lostAnswers = 0;           // Lost on air or the link went down first, power off excluded
+  uint32_t connects = 0;
+  uint32_t wakes = 0;
+  std::vector<double> answerUsSamples;
+};
+
+HostCamera hostCamera;
+
+void hostCameraWriteMode() {
+  uint8_t frame[15] = {0xFE, 0xEF, 0xFE, 0x10, 0x80, 0x09, 0x01, 0x00, 0x00, 0x00};
+  memcpy(frame + 10, builtinModeSignatures[hostCamera.cycle[hostCamera.mode]].sig, MODE_SIG_LENGTH);
+  hostBleWrite(frame, sizeof(frame));
+}
+
+// Answer frame for a command. The real layout is not known: this one has the camera prefix and the
+// response flag the remote looks for, the rest echoes the command so the RX log shows which it was.
+void hostCameraWriteAnswer(const uint8_t* command) {
+  uint8_t frame[9] = {0xFE, 0xEF, 0xFE, 0x04, 0x80, command[5], command[6], command[7], command[8]};
+  hostBleWrite(frame, sizeof(frame));
+}
+
+void hostCameraHeartbeat(uint32_t generation) {
+  if (!hostBle.connected || generation != hostCamera.generation) {
+    return;
+  }
+  if (!hostCamera.heartbeatsStalled) {
+    hostBleWrite(HEARTBEAT, sizeof(HEARTBEAT));
+  }
+  unsigned long jitter = hostCamera.random() % 41;
+  hostAfter((hostCamera.heartbeatMs - 20 + jitter) * 1000, [generation]() { hostCameraHeartbeat(generation); });
+}
+
+void hostCameraConnect() {
+  hostCamera.connectPending = false;
+  if (hostBle.connected) {
+    return;
+  }
+  hostCamera.connects++;
+  uint32_t generation = ++hostCamera.generation;
+  hostBleConnect(hostCamera.bda);
+  if (hostCamera.heartbeatMs) {
+    hostAfter(hostCamera.heartbeatMs * 1000, [generation]() { hostCameraHeartbeat(generation); });
+  }
+}
+
+// The radio drops the link, the camera stays awake and reconnects
+void hostCameraDropLink() {
+  hostBleDisconnect();
+}
+
+void hostCameraCommand(const uint8_t* data, size_t length) {
+  if (length != 9 || data[0] != 0xFC) {
+    return;
+  }
+  hostCamera.commands++;
+  uint8_t command[9];
+  memcpy(command, data, sizeof(command));
+  bool powerOff = memcmp(command, POWER_OFF_CMD, sizeof(command)) == 0;
+
+  uint64_t delayUs = hostCamera.answerUs;
+  if (hostCamera.answerJitterUs) {
+    delayUs += hostCamera.random() % hostCamera.answerJitterUs;
+  }
+  bool lost = false;
+  if (hostCamera.loseAnswers > 0) {
+    hostCamera.loseAnswers--;
+    lost = true;
+  } else if (hostCamera.answerLoss > 0) {
+    lost = std::uniform_real_distribution<double>(0, 1)(hostCamera.random) < hostCamera.answerLoss;
+  }
+
+  hostAfter(delayUs, [command, powerOff, lost, delayUs]() {
+    if (!hostBle.connected || lost) {
+      if (!powerOff) {
+        hostCamera.lostAnswers++;
+      }
+      return;
+    }
+    hostCamera.answers++;
+    hostCamera.answerUsSamples.push_back(delayUs);
+    if (powerOff) {
+      hostCamera.asleep = true;
+      hostBleDisconnect();
+    } else if (memcmp(command, MODE_CMD, sizeof(command)) == 0) {
+      hostCamera.mode = (hostCamera.mode + 1) % hostCamera.cycleLength;
+      hostCameraWriteMode();
+    } else {
+      hostCameraWriteAnswer(command);
+    }
+  });
+}
+
+// Watches what the remote has on air
+void hostCameraSeesAdvertising() {
+  if (hostBle.connected || !hostBle.advertising || hostCamera.connectPending) {
+    return;
+  }
+
+  unsigned long delayMs = hostCamera.reconnectMs;
+  if (hostCamera.asleep) {
+    // Only the wake beacon carrying this camera's name suffix wakes it
+    const char* suffix = hostCamera.name + strlen(hostCamera.name) - 6;
+    if (hostBle.advData.find(std::string(suffix, 6)) == std::string::npos) {
+      return;
+    }
+    delayMs = hostCamera.wakeMs;
+  }
+
+  hostCamera.connectPending = true;
+  hostAfter((uint64_t)delayMs * 1000, []() {
+    if (!hostBle.advertising) {
+      hostCamera.connectPending = false;
+      return;
+    }
+    if (hostCamera.asleep) {
+      hostCamera.asleep = false;
+      hostCamera.wakes++;
+    }
+    hostCameraConnect();
+  });
+}
+
+// Store the camera as paired, call before setup()
+void hostCameraPair() {
+  saveCurrentCamera(hostCamera.name, hostCamera.address);
+  hostBle.onNotify = hostCameraCommand;
+  hostBle.onAdvertisingChanged = hostCameraSeesAdvertising;
+}
@@ -0,0 +1,262 @@
+/*
+ * gps_test.cpp
+ * NMEA and UBX parser against generated sentences, a 10x real-time NMEA replay, and fixes
+ * streamed to a simulated camera while the shutter is pressed
+ *
+ * Stream latency is from the fix arriving on the UART to its notify, so it
+ * includes the wait for the next loop pass and the hold-off after commands.
+ */
+
+#include <Arduino.h>
+#define GPS_STREAM_EXPERIMENTAL
+#include "../insta360_m5StickC_remote.ino"
+#include "host/host_sim.h"
+#include "camera_sim.h"
+#include <string>
+
+static std::string nmeaSentence(const char* body) {
+  uint8_t checksum = 0;
+  for (const char* c = body; *c; c++) {
+    checksum ^= (uint8_t)*c;
+  }
+  char sentence[128];
+  snprintf(sentence, sizeof(sentence), "$%s*%02X\r\n", body, checksum);
+  return sentence;
+}
+
+// ddmm.mmmmm and the degrees * 1e7 it stands for
+static void nmeaCoordinate(double degrees, int degreeDigits, char* text, size_t size, int32_t* e7) {
+  int whole = (int)degrees;
+  double minutes = (degrees - whole) * 60;
+  snprintf(text, size, "%0*d%08.5f", degreeDigits, whole, minutes);
+  double printed = whole + atof(text + degreeDigits) / 60;
+  *e7 = (int32_t)llround(printed * 1e7);
+}
+
+struct TrackPoint {
+  std::string nmea;           // GGA then RMC
+  int32_t latE7;
+  int32_t lonE7;
+  uint32_t utcMs;
+};
+
+// 10 Hz track heading north-east, as a module set to RMC and GGA would print it
+static TrackPoint trackPoint(int i) {
+  TrackPoint point;
+  uint32_t utcMs = 12 * 3600000 + i * 100;
+  char utc[16], lat[20], lon[20], body[112];
+  snprintf(utc, sizeof(utc), "%02u%02u%02u.%02u", utcMs / 3600000, utcMs / 60000 % 60, utcMs / 1000 % 60, utcMs % 1000 / 10);
+  nmeaCoordinate(47.3769 + i * 2e-6, 2, lat, sizeof(lat), &point.latE7);
+  nmeaCoordinate(8.5417 + i * 3e-6, 3, lon, sizeof(lon), &point.lonE7);
+  point.utcMs = utcMs;
+
+  snprintf(body, sizeof(body), "GPGGA,%s,%s,N,%s,E,1,%d,0.9,%.1f,M,47.0,M,,", utc, lat, lon, 9 + i % 3, 408.0 + i % 10);
+  point.nmea = nmeaSentence(body);
+  snprintf(body, sizeof(body), "GNRMC,%s,A,%s,N,%s,E,5.4,41.5,181026,,,A", utc, lat, lon);
+  point.nmea += nmeaSentence(body);
+  return point;
+}
+
+static void parseText(const std::string &text) {
+  parseGpsBytes((const uint8_t*)text.data(), text.size(), micros());
+}
+
+static void testNmea() {
+  gpsStats = {};
+  TrackPoint point = trackPoint(7);
+  parseText(point.nmea);
+
+  CHECK(gpsStats.sentences == 2);
+  CHECK(gpsStats.checksumErrors == 0);
+  CHECK(gpsStats.fixes == 1);
+  CHECK(abs(gpsFix.latE7 - point.latE7) <= 1);
+  CHECK(abs(gpsFix.lonE7 - point.lonE7) <= 1);
+  CHECK(gpsFix.utcMs == point.utcMs);
+  CHECK(gpsFix.fixType == 3);
+  CHECK(gpsFix.sats == 10);
+  CHECK(gpsFix.altCm == 41500);
+  CHECK(gpsFix.speedCmS == 277);          // 5.4 knots
+  CHECK(gpsFix.courseCdeg == 4150);
+
+  // A flipped byte fails the checksum and the fix stays as it was
+  std::string corrupt = trackPoint(8).nmea;
+  corrupt[corrupt.size() - 20] ^= 0x01;
+  parseText(corrupt);
+  CHECK(gpsStats.checksumErrors == 1);
+  CHECK(gpsStats.fixes == 1);             // Only the RMC publishes a fix
+  CHECK(gpsFix.utcMs == point.utcMs);
+
+  // Southern and western hemispheres, and a void RMC
+  parseText(nmeaSentence("GPRMC,000001.00,A,3351.12345,S,15112.54321,W,0.0,0.0,181026,,,A"));
+  CHECK(gpsFix.latE7 < 0 && gpsFix.lonE7 < 0);
+  uint32_t fixes = gpsStats.fixes;
+  parseText(nmeaSentence("GPRMC,000002.00,V,,,,,,,181026,,,N"));
+  CHECK(gpsStats.fixes == fixes);
+}
+
+static void testUbxNavPvt() {
+  gpsStats = {};
+  uint8_t payload[UBX_NAV_PVT_LENGTH] = {};
+  auto put32 = [&](int offset, int32_t value) { memcpy(payload + offset, &value, 4); };
+  payload[8] = 13;
+  payload[9] = 45;
+  payload[10] = 30;
+  payload[20] = 3;                        // 3D fix
+  payload[21] = 0x01;                     // gnssFixOK
+  payload[23] = 14;
+  put32(24, 85417000);
+  put32(28, 473769000);
+  put32(36, 408120);                      // mm
+  put32(60, 1500);                        // mm/s
+  put32(64, 9000000);                     // 90 deg
+
+  std::string frame = "\xB5\x62\x01\x07";
+  frame += (char)UBX_NAV_PVT_LENGTH;
+  frame += (char)0;
+  frame.append((const char*)payload, sizeof(payload));
+  uint8_t ckA = 0, ckB = 0;
+  for (size_t i = 2; i < frame.size(); i++) {
+    ckA += (uint8_t)frame[i];
+    ckB += ckA;
+  }
+  frame += (char)ckA;
+  frame += (char)ckB;
+
+  // NMEA around the binary frame must not confuse either parser
+  parseText(trackPoint(1).nmea + frame + trackPoint(2).nmea);
+  CHECK(gpsStats.checksumErrors == 0);
+  CHECK(gpsStats.fixes == 3);
+  parseText(frame);
+  CHECK(gpsFix.latE7 == 473769000);
+  CHECK(gpsFix.lonE7 == 85417000);
+  CHECK(gpsFix.altCm == 40812);
+  CHECK(gpsFix.speedCmS == 150);
+  CHECK(gpsFix.courseCdeg == 9000);
+  CHECK(gpsFix.sats == 14);
+  CHECK(gpsFix.utcMs == (13 * 3600 + 45 * 60 + 30) * 1000UL);
+}
+
+// Ten minutes of 10 Hz NMEA at 10x the UART rate, in the chunks loop() would read
+static void testReplay() {
+  const int points = 10 * 600;
+  const unsigned long replayBaud = 10 * gpsBaud;
+  const unsigned long loopMs = 50;
+
+  std::string log;
+  std::vector<TrackPoint> track;
+  for (int i = 0; i < points; i++) {
+    track.push_back(trackPoint(i));
+    log += track.back().nmea;
+  }
+
+  gpsStats = {};
+  size_t chunkBytes = min((size_t)256, (size_t)(replayBaud / 10 * loopMs / 1000));
+  std::vector<double> chunkUs;
+  int wrong = 0;
+  uint32_t lastFixes = 0;
+  double start = hostWallUs();
+  for (size_t offset = 0; offset < log.size(); offset += chunkBytes) {
+    size_t n = min(chunkBytes, log.size() - offset);
+    double chunkStart = hostWallUs();
+    parseGpsBytes((const uint8_t*)log.data() + offset, n, micros());
+    chunkUs.push_back(hostWallUs() - chunkStart);
+
+    if (gpsStats.fixes != lastFixes) {
+      const TrackPoint &expected = track[gpsStats.fixes - 1];
+      if (abs(gpsFix.latE7 - expected.latE7) > 1 || abs(gpsFix.lonE7 - expected.lonE7) > 1) {
+        wrong++;
+      }
+      lastFixes = gpsStats.fixes;
+    }
+  }
+  double wallUs = hostWallUs() - start;
+  double replayUs = log.size() * 10.0 / replayBaud * 1e6;
+
+  printf("replay: %u bytes, %u sentences, %u fixes in %.1fms (%.1fMB/s, %.0fx faster than the 10x replay), "
+         "chunk p50 %.1fus p99 %.1fus\n",
+         (unsigned)gpsStats.bytes, (unsigned)gpsStats.sentences, (unsigned)gpsStats.fixes, wallUs / 1000,
+         gpsStats.bytes / wallUs, replayUs / wallUs, hostPercentile(chunkUs, 50), hostPercentile(chunkUs, 99));
+  CHECK(gpsStats.sentences == 2 * points);
+  CHECK(gpsStats.fixes == (uint32_t)points);
+  CHECK(gpsStats.checksumErrors == 0);
+  CHECK(wrong == 0);
+  CHECK(wallUs < replayUs);
+}
+
+// A minute of 10 Hz fixes with shutter presses over serial at random times
+static void testStream() {
+  hostCamera.heartbeatMs = 1000;
+  hostCameraPair();
+  setup();
+  CHECK(hostRunUntil([]() { return deviceConnected; }, 5000));
+  hostRunFor(1000);
+
+  static uint64_t lastCommandUs = 0;
+  static std::vector<double> commandGapUs;      // Command to the next fix frame
+  static std::vector<uint32_t> frameUtcMs;
+  static std::vector<double> frameAtUs;
+  static int badFrames = 0;
+  lastCommandUs = 0;
+  auto camera = hostBle.onNotify;
+  hostBle.onNotify = [camera](const uint8_t* data, size_t length) {
+    uint8_t expected[32];
+    if (length != packGpsFrame(gpsFix, expected)) {
+      lastCommandUs = hostNowUs;
+      camera(data, length);
+      return;
+    }
+    badFrames += memcmp(data, expected, length) != 0;
+    uint32_t utcMs;
+    memcpy(&utcMs, data + 7, 4);
+    frameUtcMs.push_back(utcMs);
+    frameAtUs.push_back((double)hostNowUs);
+    if (lastCommandUs) {
+      commandGapUs.push_back((double)(hostNowUs - lastCommandUs));
+    }
+  };
+
+  const int points = 600;
+  const uint64_t startUs = hostNowUs;
+  gpsStats = {};
+  for (int i = 0; i < points; i++) {
+    hostAt(startUs + i * 100000ULL, [i]() { parseText(trackPoint(i).nmea); });
+  }
+  std::mt19937 random(11);
+  int presses = 0;
+  for (uint64_t atUs = startUs + 500000; atUs < startUs + points * 100000ULL; atUs += 300000 + random() % 2000000) {
+    hostAt(atUs, []() { hostSerialInput("SHUTTER s1\n"); });
+    presses++;
+  }
+  uint32_t shutters = commandAckStats[ACTION_SHUTTER].sent;
+  hostRunFor(points * 100 + 200);
+  hostSerialTake();
+
+  // Fix i arrived at startUs + i * 100ms
+  std::vector<double> latencyUs;
+  for (size_t f = 0; f < frameUtcMs.size(); f++) {
+    double arrivedUs = startUs + (frameUtcMs[f] - trackPoint(0).utcMs) * 1000.0;
+    latencyUs.push_back(frameAtUs[f] - arrivedUs);
+  }
+  printf("stream: %d fixes, %u sent, %u dropped, %d shutter presses, UART to notify p50 %.1fms p99 %.1fms "
+         "max %.1fms, first fix after a command %.0fms at the soonest\n",
+         points, (unsigned)gpsStats.sent, (unsigned)gpsStats.dropped, presses, hostPercentile(latencyUs, 50) / 1000,
+         hostPercentile(latencyUs, 99) / 1000, hostPercentile(latencyUs, 100) / 1000,
+         hostPercentile(commandGapUs, 0) / 1000);
+
+  CHECK(commandAckStats[ACTION_SHUTTER].sent == shutters + presses);
+  CHECK(badFrames == 0);
+  CHECK(gpsStats.sent == frameUtcMs.size());
+  CHECK(gpsStats.sent + gpsStats.dropped + (gpsFixPending ? 1 : 0) == (uint32_t)points);
+  CHECK(gpsStats.dropped <= (uint32_t)presses);
+  CHECK(hostPercentile(commandGapUs, 0) >= gpsCommandHoldoff * 1000);
+  CHECK(hostPercentile(latencyUs, 50) <= 50000);
+  CHECK(hostPercentile(latencyUs, 100) <= (gpsCommandHoldoff + 50) * 1000);
+}
+
+int main() {
+  testNmea();
+  testUbxNavPvt();
+  testReplay();
+  testStream();
+  return hostTestResult("gps_test");
+}
@@ -0,0 +1,178 @@
+/*
+ * Arduino.h
+ * Host stand-in for the Arduino core: virtual clock, captured Serial and FreeRTOS shims
+ */
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <strings.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include <functional>
+
+typedef uint8_t byte;
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define HIGH 1
+#define LOW 0
+#define INPUT 1
+#define INPUT_PULLUP 5
+#define INPUT_PULLDOWN 9
+#define OUTPUT 3
+#define G0 0
+#define G25 25
+#define G26 26
+#define G32 32
+#define G33 33
+#define G36 36
+#define IRAM_ATTR
+#define PROGMEM
+#define F(x) x
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t level);
+void yield();
+
+class String {
+ public:
+  std::string s;
+  String() {}
+  String(const char* c) : s(c ? c : "") {}
+  String(const char* c, unsigned n) : s(c, n) {}
+  String(const std::string& c) : s(c) {}
+  String(char c) : s(1, c) {}
+  String(int v) : s(std::to_string(v)) {}
+  String(unsigned v) : s(std::to_string(v)) {}
+  String(long v) : s(std::to_string(v)) {}
+  String(unsigned long v) : s(std::to_string(v)) {}
+  unsigned length() const { return s.size(); }
+  const char* c_str() const { return s.c_str(); }
+  char operator[](unsigned i) const { return s[i]; }
+  char& operator[](unsigned i) { return s[i]; }
+  String substring(unsigned a) const { return String(s.substr(a)); }
+  String substring(unsigned a, unsigned b) const { return String(s.substr(a, b - a)); }
+  String& operator+=(const String& o) { s += o.s; return *this; }
+  bool operator==(const String& o) const { return s == o.s; }
+};
+inline String operator+(const String& a, const String& b) { return String(a.s + b.s); }
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(const uint8_t* data, size_t length) { return length; }
+  size_t write(uint8_t c) { return write(&c, 1); }
+  size_t print(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+  size_t print(const String& text) { return print(text.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v, int base = 10) { return print((long)v, base); }
+  size_t print(unsigned v, int base = 10) { return print((unsigned long)v, base); }
+  size_t print(long v, int base = 10) { return base == 10 ? printf("%ld", v) : print((unsigned long)v, base); }
+  size_t print(unsigned long v, int base = 10);
+  size_t print(long long v, int base = 10) { return printf("%lld", v); }
+  size_t print(unsigned long long v, int base = 10) { return printf("%llu", v); }
+  size_t print(double v, int digits = 2) { return printf("%.*f", digits, v); }
+  size_t println() { return print("\r\n"); }
+  template <typename T> size_t println(T v) { size_t n = print(v); return n + println(); }
+  template <typename T> size_t println(T v, int base) { size_t n = print(v, base); return n + println(); }
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+ public:
+  virtual int available() { return 0; }
+  virtual int read() { return -1; }
+  virtual int peek() { return -1; }
+  size_t readBytes(uint8_t* buffer, size_t length);
+};
+
+// Bytes written by the sketch are collected in output, bytes queued with hostSerialInput() are read back
+class HardwareSerial : public Stream {
+ public:
+  std::string input;
+  size_t inputPos = 0;
+  std::string output;
+  bool echo = false;          // Also copy output to stdout
+  std::function<void()> receiveCallback;
+
+  void begin(unsigned long baud, uint32_t config = 0, int8_t rxPin = -1, int8_t txPin = -1) {}
+  void setRxBufferSize(size_t size) {}
+  void setTxBufferSize(size_t size) {}
+  void onReceive(std::function<void()> callback, bool onlyOnTimeout = false) { receiveCallback = callback; }
+  operator bool() const { return true; }
+  size_t write(const uint8_t* data, size_t length) override;
+  int available() override { return (int)(input.size() - inputPos); }
+  int read() override { return inputPos < input.size() ? (uint8_t)input[inputPos++] : -1; }
+  int peek() override { return inputPos < input.size() ? (uint8_t)input[inputPos] : -1; }
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+#define SERIAL_8N1 0x800001c
+
+using std::min;
+using std::max;
+
+// FreeRTOS, single threaded: the loop task owns the virtual clock, other tasks are never started
+typedef void* TaskHandle_t;
+typedef void* SemaphoreHandle_t;
+typedef void* QueueHandle_t;
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+#define portMAX_DELAY 0xffffffff
+#define pdMS_TO_TICKS(x) (x)
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portTICK_PERIOD_MS 1
+#define tskNO_AFFINITY 0x7fffffff
+BaseType_t xTaskCreatePinnedToCore(void (*task)(void*), const char* name, uint32_t stack, void* arg,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t core);
+BaseType_t xTaskCreate(void (*task)(void*), const char* name, uint32_t stack, void* arg,
+                       UBaseType_t priority, TaskHandle_t* handle);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t* lastWake, TickType_t period);
+TickType_t xTaskGetTickCount();
+void vTaskDelete(TaskHandle_t task);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+TaskHandle_t xTaskGetHandle(const char* name);
+const char* pcTaskGetName(TaskHandle_t task);
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks);
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+void xTaskNotifyGive(TaskHandle_t task);
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+inline void portENTER_CRITICAL(portMUX_TYPE* mux) {}
+inline void portEXIT_CRITICAL(portMUX_TYPE* mux) {}
+uint32_t esp_random();
+
+class EspClass {
+ public:
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+  uint32_t getMaxAllocHeap();
+  uint32_t getHeapSize();
+  uint32_t getCpuFreqMHz() { return 240; }
+  uint32_t getCycleCount() { return (uint32_t)(micros() * 240UL); }
+};
+extern EspClass ESP;
@@ -0,0 +1,11 @@
+#pragma once
+#include "BLEDevice.h"
+
+class BLE2902 : public BLEDescriptor {
+ public:
+  bool notifications = false;
+  bool indications = false;
+  void setNotifications(bool enabled) { notifications = enabled; }
+  void setIndications(bool enabled) { indications = enabled; }
+  bool getNotifications() { return notifications; }
+};
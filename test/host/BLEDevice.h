@@ -0,0 +1,193 @@
+/*
+ * BLEDevice.h
+ * Host stand-in for the Bluedroid BLE classes the sketch uses, driven from host_sim.h
+ */
+
+#pragma once
+#include "Arduino.h"
+
+typedef uint8_t esp_bd_addr_t[6];
+
+typedef union {
+  struct { uint16_t conn_id; esp_bd_addr_t remote_bda; } connect;
+  struct { uint16_t conn_id; esp_bd_addr_t remote_bda; int reason; } disconnect;
+} esp_ble_gatts_cb_param_t;
+
+typedef enum {
+  ESP_GAP_BLE_SCAN_RESULT_EVT = 3,
+  ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT = 4,
+  ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT = 20,
+  ESP_GAP_BLE_READ_RSSI_COMPLETE_EVT = 25
+} esp_gap_ble_cb_event_t;
+
+typedef int esp_bt_status_t;
+#define ESP_BT_STATUS_SUCCESS 0
+
+typedef union {
+  struct { esp_bt_status_t status; } adv_data_raw_cmpl;
+  struct { esp_bt_status_t status; esp_bd_addr_t bda; uint16_t min_int, max_int, latency, conn_int, timeout; } update_conn_params;
+  struct { esp_bt_status_t status; int8_t rssi; esp_bd_addr_t remote_addr; } read_rssi_cmpl;
+} esp_ble_gap_cb_param_t;
+
+typedef void (*gap_event_handler)(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param);
+
+class BLEUUID {
+ public:
+  uint8_t bytes[16];          // Little endian, as sent over the air
+  BLEUUID();
+  BLEUUID(const char* text);
+};
+
+class BLEAddress {
+ public:
+  esp_bd_addr_t address;
+  BLEAddress(esp_bd_addr_t bda) { memcpy(address, bda, sizeof(address)); }
+  esp_bd_addr_t* getNative() { return &address; }
+  String toString();
+};
+
+class BLEAdvertisedDevice {
+ public:
+  std::string payload;
+  esp_bd_addr_t address;
+  int rssi = -60;
+
+  bool haveName();
+  String getName();
+  BLEAddress getAddress() { return BLEAddress(address); }
+  int getRSSI() { return rssi; }
+  bool haveRSSI() { return true; }
+  uint8_t* getPayload() { return (uint8_t*)payload.data(); }
+  size_t getPayloadLength() { return payload.size(); }
+};
+
+class BLEAdvertisedDeviceCallbacks {
+ public:
+  virtual ~BLEAdvertisedDeviceCallbacks() {}
+  virtual void onResult(BLEAdvertisedDevice device) = 0;
+};
+
+class BLEScanResults;
+
+class BLEScan {
+ public:
+  BLEAdvertisedDeviceCallbacks* callbacks = nullptr;
+  bool scanning = false;
+  bool active = false;
+  uint16_t intervalMs = 0;
+  uint16_t windowMs = 0;
+
+  void setAdvertisedDeviceCallbacks(BLEAdvertisedDeviceCallbacks* cb, bool duplicates = false, bool parse = false) { callbacks = cb; }
+  void setActiveScan(bool enabled) { active = enabled; }
+  void setInterval(uint16_t ms) { intervalMs = ms; }
+  void setWindow(uint16_t ms) { windowMs = ms; }
+  bool start(uint32_t duration, void (*done)(BLEScanResults), bool cont = false) { scanning = true; return true; }
+  void stop() { scanning = false; }
+  void clearResults() {}
+};
+
+class BLEDescriptor {
+ public:
+  virtual ~BLEDescriptor() {}
+};
+
+class BLECharacteristic;
+
+class BLECharacteristicCallbacks {
+ public:
+  virtual ~BLECharacteristicCallbacks() {}
+  virtual void onWrite(BLECharacteristic* characteristic) {}
+  virtual void onStatus(BLECharacteristic* characteristic, int status, uint32_t code) {}
+};
+
+class BLECharacteristic {
+ public:
+  static const uint32_t PROPERTY_READ = 1, PROPERTY_WRITE = 2, PROPERTY_NOTIFY = 4, PROPERTY_INDICATE = 8, PROPERTY_WRITE_NR = 16;
+
+  std::string uuid;
+  std::string value;
+  BLECharacteristicCallbacks* callbacks = nullptr;
+
+  void setCallbacks(BLECharacteristicCallbacks* cb) { callbacks = cb; }
+  void addDescriptor(BLEDescriptor* descriptor) {}
+  void setValue(uint8_t* data, size_t length) { value.assign((const char*)data, length); }
+  void setValue(String text) { value = text.s; }
+  String getValue() { return String(value); }
+  uint8_t* getData() { return (uint8_t*)value.data(); }
+  size_t getLength() { return value.size(); }
+  void notify(bool isNotification = true);
+};
+
+class BLEService {
+ public:
+  BLECharacteristic* createCharacteristic(const char* uuid, uint32_t properties);
+  void start() {}
+};
+
+class BLEServer;
+
+class BLEServerCallbacks {
+ public:
+  virtual ~BLEServerCallbacks() {}
+  virtual void onConnect(BLEServer* server) {}
+  virtual void onConnect(BLEServer* server, esp_ble_gatts_cb_param_t* param) {}
+  virtual void onDisconnect(BLEServer* server) {}
+  virtual void onDisconnect(BLEServer* server, esp_ble_gatts_cb_param_t* param) {}
+  virtual void onMtuChanged(BLEServer* server, esp_ble_gatts_cb_param_t* param) {}
+};
+
+class BLEServer {
+ public:
+  BLEServerCallbacks* callbacks = nullptr;
+
+  void setCallbacks(BLEServerCallbacks* cb) { callbacks = cb; }
+  BLEService* createService(const char* uuid) { return new BLEService(); }
+  uint16_t getConnId();
+  uint32_t getConnectedCount();
+  void disconnect(uint16_t connId);
+  void startAdvertising();
+  void updateConnParams(esp_bd_addr_t bda, uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout);
+  uint16_t getPeerMTU(uint16_t connId) { return 23; }
+};
+
+class BLEAdvertisementData {
+ public:
+  std::string payload;
+
+  void setFlags(uint8_t flags);
+  void setName(String name);
+  void setCompleteServices(BLEUUID uuid);
+  void setManufacturerData(String data);
+  void addData(String data) { payload += data.s; }
+  void addData(char* data, size_t length) { payload.append(data, length); }
+  String getPayload() { return String(payload); }
+};
+
+class BLEAdvertising {
+ public:
+  void addServiceUUID(const char* uuid) {}
+  void setAdvertisementData(BLEAdvertisementData& data);
+  void setScanResponseData(BLEAdvertisementData& data) {}
+  void setScanResponse(bool enabled) {}
+  void setMinPreferred(uint16_t value) {}
+  void setMaxPreferred(uint16_t value) {}
+  void setMinInterval(uint16_t value) {}
+  void setMaxInterval(uint16_t value) {}
+  bool start();
+  bool stop();
+};
+
+class BLEDevice {
+ public:
+  static void init(String name);
+  static BLEScan* getScan();
+  static BLEServer* createServer();
+  static BLEAdvertising* getAdvertising();
+  static void startAdvertising();
+  static void stopAdvertising();
+  static esp_err_t setPower(int level) { return ESP_OK; }
+  static void setCustomGapHandler(gap_event_handler handler);
+};
+
+esp_err_t esp_ble_gap_config_adv_data_raw(uint8_t* data, uint32_t length);
+esp_err_t esp_ble_gap_read_rssi(esp_bd_addr_t bda);
@@ -0,0 +1,130 @@
+/*
+ * M5Unified.h
+ * Host stand-in for M5Unified: a headless display, scripted buttons, power IC and IMU
+ */
+
+#pragma once
+#include "Arduino.h"
+
+#define BLACK 0x0000
+#define WHITE 0xFFFF
+#define RED 0xF800
+#define GREEN 0x07E0
+#define BLUE 0x001F
+#define YELLOW 0xFFE0
+#define CYAN 0x07FF
+#define DARKGREY 0x7BEF
+#define ORANGE 0xFD20
+#define TFT_BLACK BLACK
+
+// Drawing calls are accepted and dropped, text output included
+class LGFX_Device : public Print {
+ public:
+  int w = 240;
+  int h = 135;
+
+  void setRotation(int rotation) {}
+  void fillScreen(uint16_t color) {}
+  void setTextSize(int size) {}
+  void setCursor(int x, int y) {}
+  void setTextColor(uint16_t color) {}
+  void setTextColor(uint16_t color, uint16_t background) {}
+  void fillRect(int x, int y, int w, int h, uint16_t color) {}
+  void drawRect(int x, int y, int w, int h, uint16_t color) {}
+  void fillCircle(int x, int y, int r, uint16_t color) {}
+  void drawCircle(int x, int y, int r, uint16_t color) {}
+  void drawPixel(int x, int y, uint16_t color) {}
+  void drawFastHLine(int x, int y, int w, uint16_t color) {}
+  void drawFastVLine(int x, int y, int h, uint16_t color) {}
+  void drawBitmap(int x, int y, const uint8_t* bitmap, int w, int h, uint16_t color) {}
+  void pushImage(int x, int y, int w, int h, const uint16_t* data) {}
+  void startWrite() {}
+  void endWrite() {}
+  int width() { return w; }
+  int height() { return h; }
+};
+
+class M5Canvas : public LGFX_Device {
+ public:
+  uint8_t* buffer = nullptr;
+  int depth = 16;
+
+  M5Canvas() {}
+  M5Canvas(LGFX_Device* parent) {}
+  ~M5Canvas() { deleteSprite(); }
+  void setColorDepth(int bits) { depth = bits; }
+  void setPsram(bool enabled) {}
+  void* createSprite(int width, int height) {
+    deleteSprite();
+    w = width;
+    h = height;
+    buffer = (uint8_t*)calloc((width * depth + 7) / 8 * height, 1);
+    return buffer;
+  }
+  void deleteSprite() { free(buffer); buffer = nullptr; }
+  void* getBuffer() { return buffer; }
+  void setPaletteColor(size_t index, uint16_t color) {}
+  void pushSprite(int x, int y) {}
+  void pushSprite(LGFX_Device* target, int x, int y) {}
+};
+
+// A press queued with hostPressButton() reads as released for one M5.update() pass
+struct Button_Class {
+  bool queued = false;
+  bool released = false;
+
+  bool wasReleased() { return released; }
+  bool wasPressed() { return released; }
+  bool isPressed() { return false; }
+  bool wasHold() { return false; }
+  bool pressedFor(uint32_t ms) { return false; }
+};
+
+namespace m5 {
+struct Power_Class {
+  enum is_charging_t { is_discharging = 0, is_charging, charge_unknown };
+
+  int32_t level = 100;        // Negative on boards without a fuel gauge
+  int16_t voltage = 4100;
+  is_charging_t charging = is_discharging;
+  uint32_t levelReads = 0;    // Power IC transactions
+
+  int32_t getBatteryLevel() { levelReads++; return level; }
+  int16_t getBatteryVoltage() { return voltage; }
+  is_charging_t isCharging() { return charging; }
+  void powerOff() {}
+};
+}
+using m5::Power_Class;
+
+struct IMU_Class {
+  bool enabled = false;
+  float accel[3] = {0, 0, 1};
+  float gyro[3] = {0, 0, 0};
+
+  bool begin() { return enabled; }
+  bool isEnabled() { return enabled; }
+  bool update() { return enabled; }
+  bool getAccel(float* x, float* y, float* z) { *x = accel[0]; *y = accel[1]; *z = accel[2]; return true; }
+  bool getGyro(float* x, float* y, float* z) { *x = gyro[0]; *y = gyro[1]; *z = gyro[2]; return true; }
+};
+
+struct m5_config_t {
+  uint32_t serial_baudrate = 115200;
+  bool internal_imu = true;
+};
+
+struct M5_t {
+  LGFX_Device Lcd;
+  LGFX_Device& Display = Lcd;
+  Button_Class BtnA, BtnB;
+  Power_Class Power;
+  IMU_Class Imu;
+
+  m5_config_t config() { return m5_config_t(); }
+  void begin(m5_config_t cfg) {}
+  void begin() {}
+  void update();
+};
+
+extern M5_t M5;
@@ -0,0 +1,36 @@
+/*
+ * Preferences.h
+ * Host stand-in for NVS preferences, kept in memory for the life of the process
+ */
+
+#pragma once
+#include "Arduino.h"
+
+class Preferences {
+ public:
+  std::string ns;
+  bool readOnly = false;
+
+  bool begin(const char* name, bool readOnly = false);
+  void end() { ns.clear(); }
+  bool clear();
+  bool remove(const char* key);
+  bool isKey(const char* key);
+  size_t freeEntries() { return 100; }
+
+  size_t getBytesLength(const char* key);
+  size_t getBytes(const char* key, void* buffer, size_t length);
+  size_t putBytes(const char* key, const void* data, size_t length);
+
+  size_t getString(const char* key, char* buffer, size_t length);
+  String getString(const char* key, String fallback = String());
+  size_t putString(const char* key, const char* text) { return putBytes(key, text, strlen(text) + 1) ? strlen(text) : 0; }
+  size_t putString(const char* key, String text) { return putString(key, text.c_str()); }
+
+  bool getBool(const char* key, bool fallback = false) { return getUChar(key, fallback) != 0; }
+  size_t putBool(const char* key, bool value) { return putUChar(key, value); }
+  uint8_t getUChar(const char* key, uint8_t fallback = 0) { uint8_t v = fallback; getBytes(key, &v, 1); return v; }
+  size_t putUChar(const char* key, uint8_t value) { return putBytes(key, &value, 1); }
+  uint32_t getUInt(const char* key, uint32_t fallback = 0) { uint32_t v = fallback; getBytes(key, &v, 4); return v; }
+  size_t putUInt(const char* key, uint32_t value) { return putBytes(key, &value, 4); }
+};
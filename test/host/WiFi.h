@@ -0,0 +1,11 @@
+#pragma once
+#include "Arduino.h"
+
+#define WIFI_STA 1
+
+class WiFiClass {
+ public:
+  bool mode(int mode) { return true; }
+};
+
+extern WiFiClass WiFi;
@@ -0,0 +1,32 @@
+/*
+ * esp_partition.h
+ * Host stand-in for the partition API over RAM NOR flash, see HostFlash in host_sim.h
+ */
+
+#pragma once
+#include "Arduino.h"
+
+typedef enum {
+  ESP_PARTITION_TYPE_APP = 0,
+  ESP_PARTITION_TYPE_DATA = 1,
+  ESP_PARTITION_TYPE_ANY = 0xff
+} esp_partition_type_t;
+
+typedef enum {
+  ESP_PARTITION_SUBTYPE_DATA_NVS = 0x02,
+  ESP_PARTITION_SUBTYPE_DATA_SPIFFS = 0x82,
+  ESP_PARTITION_SUBTYPE_ANY = 0xff
+} esp_partition_subtype_t;
+
+typedef struct {
+  esp_partition_type_t type;
+  esp_partition_subtype_t subtype;
+  uint32_t address;
+  uint32_t size;
+  char label[17];
+} esp_partition_t;
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char* label);
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t offset, void* buffer, size_t length);
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t offset, const void* data, size_t length);
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t length);
@@ -0,0 +1,6 @@
+#pragma once
+#include "Arduino.h"
+
+typedef enum { WIFI_SECOND_CHAN_NONE = 0 } wifi_second_chan_t;
+
+inline esp_err_t esp_wifi_set_channel(uint8_t channel, wifi_second_chan_t second) { return ESP_OK; }
@@ -0,0 +1,874 @@
+/*
+ * host.cpp
+ * Host implementations of the Arduino, FreeRTOS, BLE, NVS, flash and ESP-NOW stand-ins
+ */
+
+#include "host_sim.h"
+#include "Preferences.h"
+#include "WiFi.h"
+#include "soc/gpio_reg.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <deque>
+#include <map>
+#include <queue>
+
+// Clock and background events
+
+uint64_t hostNowUs = 0;
+uint32_t hostSleeps = 0;
+
+struct HostEvent {
+  uint64_t atUs;
+  uint64_t order;
+  std::function<void()> fn;
+  bool operator>(const HostEvent &other) const {
+    return atUs != other.atUs ? atUs > other.atUs : order > other.order;
+  }
+};
+
+static std::priority_queue<HostEvent, std::vector<HostEvent>, std::greater<HostEvent>> hostEvents;
+static uint64_t hostEventOrder = 0;
+static uint32_t hostNotifyCount = 0;
+
+void hostAt(uint64_t atUs, std::function<void()> fn) {
+  hostEvents.push({atUs, hostEventOrder++, fn});
+}
+
+void hostAfter(uint64_t delayUs, std::function<void()> fn) {
+  hostAt(hostNowUs + delayUs, fn);
+}
+
+std::function<uint64_t(uint64_t maxUs)> hostWait;
+
+// Runs events due by target, stops early once the loop task is notified if asked to
+static void hostAdvanceTo(uint64_t targetUs, bool stopOnNotify) {
+  for (;;) {
+    if (stopOnNotify && hostNotifyCount) {
+      return;
+    }
+    bool eventDue = !hostEvents.empty() && hostEvents.top().atUs <= targetUs;
+    uint64_t nextUs = eventDue ? max(hostEvents.top().atUs, hostNowUs) : targetUs;
+
+    // Real time: sleep towards the next deadline, input may wake the loop early
+    if (hostWait && nextUs > hostNowUs) {
+      hostNowUs += min(hostWait(nextUs - hostNowUs), nextUs - hostNowUs);
+      continue;
+    }
+
+    if (!eventDue) {
+      hostNowUs = max(hostNowUs, targetUs);
+      return;
+    }
+    HostEvent event = hostEvents.top();
+    hostEvents.pop();
+    hostNowUs = max(hostNowUs, event.atUs);
+    event.fn();
+  }
+}
+
+void hostAdvance(uint64_t us) {
+  hostAdvanceTo(hostNowUs + us, false);
+}
+
+unsigned long millis() {
+  return (unsigned long)(hostNowUs / 1000);
+}
+
+unsigned long micros() {
+  return (unsigned long)hostNowUs;
+}
+
+void delay(unsigned long ms) {
+  hostSleeps++;
+  hostAdvance((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  hostSleeps++;
+  hostAdvance(us);
+}
+
+void yield() {
+}
+
+// GPIO
+
+static int hostPins[40];
+static bool hostPinDriven[40];
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin < 40 && !hostPinDriven[pin]) {
+    hostPins[pin] = (mode == INPUT_PULLDOWN) ? LOW : HIGH;
+  }
+}
+
+int digitalRead(uint8_t pin) {
+  return pin < 40 ? hostPins[pin] : LOW;
+}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+  hostSetPin(pin, level);
+}
+
+void hostSetPin(uint8_t pin, int level) {
+  if (pin < 40) {
+    hostPins[pin] = level;
+    hostPinDriven[pin] = true;
+  }
+}
+
+uint32_t REG_READ(uint32_t reg) {
+  int base = (reg == GPIO_IN1_REG) ? 32 : 0;
+  uint32_t levels = 0;
+  for (int i = 0; i < 32 && base + i < 40; i++) {
+    if (hostPins[base + i]) {
+      levels |= 1UL << i;
+    }
+  }
+  return levels;
+}
+
+// Print and Serial
+
+size_t Print::print(unsigned long v, int base) {
+  if (base == 16) {
+    return printf("%lX", v);
+  }
+  if (base == 2) {
+    char bits[65];
+    int n = 0;
+    do {
+      bits[n++] = '0' + (v & 1);
+      v >>= 1;
+    } while (v);
+    std::reverse(bits, bits + n);
+    return write((const uint8_t*)bits, n);
+  }
+  return printf("%lu", v);
+}
+
+size_t Print::printf(const char* format, ...) {
+  char buffer[512];
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  if (n < 0) {
+    return 0;
+  }
+  return write((const uint8_t*)buffer, min((size_t)n, sizeof(buffer) - 1));
+}
+
+size_t Stream::readBytes(uint8_t* buffer, size_t length) {
+  size_t n = 0;
+  while (n < length && available() > 0) {
+    buffer[n++] = (uint8_t)read();
+  }
+  return n;
+}
+
+size_t HardwareSerial::write(const uint8_t* data, size_t length) {
+  output.append((const char*)data, length);
+  if (echo) {
+    fwrite(data, 1, length, stdout);
+  }
+  return length;
+}
+
+HardwareSerial Serial;
+HardwareSerial Serial1;
+HardwareSerial Serial2;
+
+static struct HostSerialEcho {
+  HostSerialEcho() {
+    Serial.echo = getenv("HOST_SERIAL_ECHO") != nullptr;
+  }
+} hostSerialEcho;
+
+void hostSerialInput(const char* text) {
+  Serial.input.erase(0, Serial.inputPos);
+  Serial.inputPos = 0;
+  Serial.input += text;
+  if (Serial.receiveCallback) {
+    Serial.receiveCallback();
+  }
+}
+
+std::string hostSerialTake() {
+  std::string output;
+  output.swap(Serial.output);
+  return output;
+}
+
+// M5
+
+M5_t M5;
+
+void hostPressButton(Button_Class &button) {
+  button.queued = true;
+}
+
+void M5_t::update() {
+  BtnA.released = BtnA.queued;
+  BtnB.released = BtnB.queued;
+  BtnA.queued = false;
+  BtnB.queued = false;
+}
+
+// FreeRTOS
+
+static int hostLoopTaskToken;
+
+struct HostQueue {
+  size_t length;
+  size_t itemSize;
+  std::deque<std::vector<uint8_t>> items;
+};
+
+BaseType_t xTaskCreatePinnedToCore(void (*task)(void*), const char* name, uint32_t stack, void* arg,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t core) {
+  // Tasks are not started, tests drive their per-sample functions directly
+  if (handle) {
+    *handle = new int(0);
+  }
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(void (*task)(void*), const char* name, uint32_t stack, void* arg,
+                       UBaseType_t priority, TaskHandle_t* handle) {
+  return xTaskCreatePinnedToCore(task, name, stack, arg, priority, handle, tskNO_AFFINITY);
+}
+
+void vTaskDelay(TickType_t ticks) {
+  delay(ticks);
+}
+
+void vTaskDelayUntil(TickType_t* lastWake, TickType_t period) {
+  *lastWake += period;
+  if ((int32_t)(*lastWake - millis()) > 0) {
+    delay(*lastWake - millis());
+  }
+}
+
+TickType_t xTaskGetTickCount() {
+  return millis();
+}
+
+void vTaskDelete(TaskHandle_t task) {
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+  return 4096;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  return &hostLoopTaskToken;
+}
+
+TaskHandle_t xTaskGetHandle(const char* name) {
+  return nullptr;
+}
+
+const char* pcTaskGetName(TaskHandle_t task) {
+  return "loopTask";
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  return new int(0);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+  return pdTRUE;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  return new HostQueue{length, itemSize, {}};
+}
+
+BaseType_t xQueueSend(QueueHandle_t handle, const void* item, TickType_t ticks) {
+  HostQueue* queue = (HostQueue*)handle;
+  if (queue->items.size() >= queue->length) {
+    return pdFALSE;
+  }
+  const uint8_t* bytes = (const uint8_t*)item;
+  queue->items.emplace_back(bytes, bytes + queue->itemSize);
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t handle, void* item, TickType_t ticks) {
+  HostQueue* queue = (HostQueue*)handle;
+  if (queue->items.empty()) {
+    return pdFALSE;
+  }
+  memcpy(item, queue->items.front().data(), queue->itemSize);
+  queue->items.pop_front();
+  return pdTRUE;
+}
+
+// The loop task sleeps here: background work runs until a notify or the timeout
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+  hostSleeps++;
+  if (!hostNotifyCount) {
+    hostAdvanceTo(hostNowUs + (uint64_t)ticks * 1000, true);
+  }
+  uint32_t count = hostNotifyCount;
+  hostNotifyCount = clear ? 0 : (count ? count - 1 : 0);
+  return count;
+}
+
+void xTaskNotifyGive(TaskHandle_t task) {
+  hostNotifyCount++;
+}
+
+uint32_t esp_random() {
+  static uint32_t state = 0x2545F491;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+HostHeap hostHeap;
+EspClass ESP;
+
+uint32_t EspClass::getFreeHeap() { return hostHeap.free; }
+uint32_t EspClass::getMinFreeHeap() { return hostHeap.minFree; }
+uint32_t EspClass::getMaxAllocHeap() { return hostHeap.maxAlloc; }
+uint32_t EspClass::getHeapSize() { return hostHeap.size; }
+
+// NVS
+
+static std::map<std::string, std::map<std::string, std::string>> hostNvs;
+
+bool Preferences::begin(const char* name, bool readOnly) {
+  ns = name;
+  this->readOnly = readOnly;
+  return true;
+}
+
+bool Preferences::clear() {
+  hostNvs[ns].clear();
+  return true;
+}
+
+bool Preferences::remove(const char* key) {
+  return hostNvs[ns].erase(key) > 0;
+}
+
+bool Preferences::isKey(const char* key) {
+  return hostNvs[ns].count(key) > 0;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+  auto &space = hostNvs[ns];
+  auto it = space.find(key);
+  return it == space.end() ? 0 : it->second.size();
+}
+
+size_t Preferences::getBytes(const char* key, void* buffer, size_t length) {
+  auto &space = hostNvs[ns];
+  auto it = space.find(key);
+  if (it == space.end() || it->second.size() > length) {
+    return 0;
+  }
+  memcpy(buffer, it->second.data(), it->second.size());
+  return it->second.size();
+}
+
+size_t Preferences::putBytes(const char* key, const void* data, size_t length) {
+  if (ns.empty() || readOnly) {
+    return 0;
+  }
+  hostNvs[ns][key].assign((const char*)data, length);
+  return length;
+}
+
+size_t Preferences::getString(const char* key, char* buffer, size_t length) {
+  auto &space = hostNvs[ns];
+  auto it = space.find(key);
+  if (it == space.end() || it->second.size() > length) {
+    return 0;
+  }
+  memcpy(buffer, it->second.data(), it->second.size());
+  return it->second.size();
+}
+
+String Preferences::getString(const char* key, String fallback) {
+  auto &space = hostNvs[ns];
+  auto it = space.find(key);
+  return it == space.end() ? fallback : String(it->second.c_str());
+}
+
+WiFiClass WiFi;
+
+// BLE
+
+HostBle hostBle;
+
+BLEUUID::BLEUUID() {
+  memset(bytes, 0, sizeof(bytes));
+}
+
+BLEUUID::BLEUUID(const char* text) {
+  uint8_t bigEndian[16] = {0};
+  int nibbles = 0;
+  for (const char* c = text; *c && nibbles < 32; c++) {
+    if (isxdigit((unsigned char)*c)) {
+      int v = isdigit((unsigned char)*c) ? *c - '0' : (tolower(*c) - 'a' + 10);
+      bigEndian[nibbles / 2] |= (nibbles % 2) ? v : v << 4;
+      nibbles++;
+    }
+  }
+  for (int i = 0; i < 16; i++) {
+    bytes[i] = bigEndian[15 - i];
+  }
+}
+
+String BLEAddress::toString() {
+  char text[18];
+  snprintf(text, sizeof(text), "%02x:%02x:%02x:%02x:%02x:%02x",
+           address[0], address[1], address[2], address[3], address[4], address[5]);
+  return String(text);
+}
+
+static bool hostFindField(const std::string &payload, uint8_t type, std::string &field) {
+  for (size_t i = 0; i + 1 < payload.size(); ) {
+    uint8_t length = payload[i];
+    if (length == 0 || i + 1 + length > payload.size()) {
+      break;
+    }
+    if ((uint8_t)payload[i + 1] == type) {
+      field = payload.substr(i + 2, length - 1);
+      return true;
+    }
+    i += length + 1;
+  }
+  return false;
+}
+
+bool BLEAdvertisedDevice::haveName() {
+  std::string name;
+  return hostFindField(payload, 0x09, name) || hostFindField(payload, 0x08, name);
+}
+
+String BLEAdvertisedDevice::getName() {
+  std::string name;
+  if (!hostFindField(payload, 0x09, name)) {
+    hostFindField(payload, 0x08, name);
+  }
+  return String(name);
+}
+
+void BLECharacteristic::notify(bool isNotification) {
+  if (hostBle.connected && hostBle.onNotify) {
+    hostBle.onNotify((const uint8_t*)value.data(), value.size());
+  }
+}
+
+BLECharacteristic* BLEService::createCharacteristic(const char* uuid, uint32_t properties) {
+  BLECharacteristic* characteristic = new BLECharacteristic();
+  characteristic->uuid = uuid;
+  if ((properties & BLECharacteristic::PROPERTY_WRITE) && !hostBle.writeChar) {
+    hostBle.writeChar = characteristic;
+  }
+  if ((properties & BLECharacteristic::PROPERTY_NOTIFY) && !hostBle.notifyChar) {
+    hostBle.notifyChar = characteristic;
+  }
+  return characteristic;
+}
+
+uint32_t BLEServer::getConnectedCount() {
+  return hostBle.connected ? 1 : 0;
+}
+
+uint16_t BLEServer::getConnId() {
+  return hostBle.connId;
+}
+
+void BLEServer::disconnect(uint16_t connId) {
+  // Completes on the BLE task once the controller has torn the link down
+  if (std::find(hostBle.otherLinks.begin(), hostBle.otherLinks.end(), connId) == hostBle.otherLinks.end()) {
+    hostAfter(20000, hostBleDisconnect);
+    return;
+  }
+  hostAfter(20000, [connId]() {
+    auto link = std::find(hostBle.otherLinks.begin(), hostBle.otherLinks.end(), connId);
+    if (link == hostBle.otherLinks.end()) {
+      return;
+    }
+    hostBle.otherLinks.erase(link);
+    esp_ble_gatts_cb_param_t param;
+    memset(&param, 0, sizeof(param));
+    param.disconnect.conn_id = connId;
+    if (hostBle.server.callbacks) {
+      hostBle.server.callbacks->onDisconnect(&hostBle.server);
+      hostBle.server.callbacks->onDisconnect(&hostBle.server, &param);
+    }
+  });
+}
+
+void BLEServer::startAdvertising() {
+  BLEDevice::startAdvertising();
+}
+
+void BLEServer::updateConnParams(esp_bd_addr_t bda, uint16_t minInterval, uint16_t maxInterval,
+                                 uint16_t latency, uint16_t timeout) {
+  hostBle.connParamRequests++;
+  hostAfter(30000, [=]() {
+    if (!hostBle.connected || !hostBle.gap) {
+      return;
+    }
+    esp_ble_gap_cb_param_t param;
+    memset(&param, 0, sizeof(param));
+    param.update_conn_params.status = ESP_BT_STATUS_SUCCESS;
+    param.update_conn_params.min_int = minInterval;
+    param.update_conn_params.max_int = maxInterval;
+    param.update_conn_params.conn_int = maxInterval;
+    param.update_conn_params.latency = latency;
+    param.update_conn_params.timeout = timeout;
+    hostBle.gap(ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT, &param);
+  });
+}
+
+static void hostAddField(std::string &payload, uint8_t type, const std::string &data) {
+  payload += (char)(data.size() + 1);
+  payload += (char)type;
+  payload += data;
+}
+
+void BLEAdvertisementData::setFlags(uint8_t flags) {
+  hostAddField(payload, 0x01, std::string(1, (char)flags));
+}
+
+void BLEAdvertisementData::setName(String name) {
+  hostAddField(payload, 0x09, name.s);
+}
+
+void BLEAdvertisementData::setCompleteServices(BLEUUID uuid) {
+  hostAddField(payload, 0x07, std::string((const char*)uuid.bytes, 16));
+}
+
+void BLEAdvertisementData::setManufacturerData(String data) {
+  hostAddField(payload, 0xFF, data.s);
+}
+
+static void hostAdvertisingChanged() {
+  if (hostBle.onAdvertisingChanged) {
+    hostBle.onAdvertisingChanged();
+  }
+}
+
+void BLEAdvertising::setAdvertisementData(BLEAdvertisementData &data) {
+  hostBle.advData = data.payload;
+}
+
+// The controller can advertise with a link up, and stops advertising when a central connects
+bool BLEAdvertising::start() {
+  hostBle.advStarts++;
+  hostBle.advertising = true;
+  hostAdvertisingChanged();
+  return true;
+}
+
+bool BLEAdvertising::stop() {
+  hostBle.advStops++;
+  hostBle.advertising = false;
+  hostAdvertisingChanged();
+  return true;
+}
+
+void BLEDevice::init(String name) {
+}
+
+BLEScan* BLEDevice::getScan() {
+  return &hostBle.scan;
+}
+
+BLEServer* BLEDevice::createServer() {
+  return &hostBle.server;
+}
+
+BLEAdvertising* BLEDevice::getAdvertising() {
+  return &hostBle.advertisingObject;
+}
+
+void BLEDevice::startAdvertising() {
+  hostBle.advertisingObject.start();
+}
+
+void BLEDevice::stopAdvertising() {
+  hostBle.advertisingObject.stop();
+}
+
+void BLEDevice::setCustomGapHandler(gap_event_handler handler) {
+  hostBle.gap = handler;
+}
+
+esp_err_t esp_ble_gap_config_adv_data_raw(uint8_t* data, uint32_t length) {
+  std::string advData((const char*)data, length);
+  hostBle.advDataSets++;
+  hostAfter(hostBle.advSetLatencyUs, [advData]() {
+    hostBle.advData = advData;
+    if (hostBle.gap) {
+      esp_ble_gap_cb_param_t param;
+      memset(&param, 0, sizeof(param));
+      param.adv_data_raw_cmpl.status = ESP_BT_STATUS_SUCCESS;
+      hostBle.gap(ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT, &param);
+    }
+    hostAdvertisingChanged();
+  });
+  return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_read_rssi(esp_bd_addr_t bda) {
+  hostAfter(2000, []() {
+    if (!hostBle.connected || !hostBle.gap) {
+      return;
+    }
+    esp_ble_gap_cb_param_t param;
+    memset(&param, 0, sizeof(param));
+    param.read_rssi_cmpl.status = ESP_BT_STATUS_SUCCESS;
+    param.read_rssi_cmpl.rssi = hostBle.rssi;
+    hostBle.gap(ESP_GAP_BLE_READ_RSSI_COMPLETE_EVT, &param);
+  });
+  return ESP_OK;
+}
+
+void hostBleConnect(const uint8_t bda[6]) {
+  if (hostBle.connected) {
+    return;
+  }
+  hostBle.connected = true;
+  hostBle.advertising = false;
+  hostBle.connId = hostBle.nextConnId++;
+
+  esp_ble_gatts_cb_param_t param;
+  memset(&param, 0, sizeof(param));
+  param.connect.conn_id = hostBle.connId;
+  memcpy(param.connect.remote_bda, bda, 6);
+  if (hostBle.server.callbacks) {
+    hostBle.server.callbacks->onConnect(&hostBle.server);
+    hostBle.server.callbacks->onConnect(&hostBle.server, &param);
+  }
+}
+
+void hostBleConnectOther(const uint8_t bda[6]) {
+  if (!hostBle.connected || !hostBle.advertising) {
+    return;
+  }
+  hostBle.advertising = false;
+  uint16_t connId = hostBle.nextConnId++;
+  hostBle.otherLinks.push_back(connId);
+
+  esp_ble_gatts_cb_param_t param;
+  memset(&param, 0, sizeof(param));
+  param.connect.conn_id = connId;
+  memcpy(param.connect.remote_bda, bda, 6);
+  if (hostBle.server.callbacks) {
+    hostBle.server.callbacks->onConnect(&hostBle.server);
+    hostBle.server.callbacks->onConnect(&hostBle.server, &param);
+  }
+}
+
+void hostBleDisconnect() {
+  if (!hostBle.connected) {
+    return;
+  }
+  hostBle.connected = false;
+
+  esp_ble_gatts_cb_param_t param;
+  memset(&param, 0, sizeof(param));
+  param.disconnect.conn_id = hostBle.connId;
+  if (hostBle.server.callbacks) {
+    hostBle.server.callbacks->onDisconnect(&hostBle.server);
+    hostBle.server.callbacks->onDisconnect(&hostBle.server, &param);
+  }
+  if (hostBle.onDisconnected) {
+    hostBle.onDisconnected();
+  }
+}
+
+void hostBleWrite(const uint8_t* data, size_t length) {
+  if (!hostBle.connected || !hostBle.writeChar) {
+    return;
+  }
+  hostBle.writeChar->setValue((uint8_t*)data, length);
+  if (hostBle.writeChar->callbacks) {
+    hostBle.writeChar->callbacks->onWrite(hostBle.writeChar);
+  }
+}
+
+void hostBleScanResult(const uint8_t bda[6], const std::string &payload) {
+  if (!hostBle.scan.scanning || !hostBle.scan.callbacks) {
+    return;
+  }
+  BLEAdvertisedDevice device;
+  device.payload = payload;
+  memcpy(device.address, bda, 6);
+  hostBle.scan.callbacks->onResult(device);
+}
+
+// Flash
+
+HostFlash hostFlash;
+
+HostPartition* hostAddPartition(const char* label, esp_partition_subtype_t subtype, uint32_t size) {
+  HostPartition* partition = new HostPartition();
+  partition->info.type = ESP_PARTITION_TYPE_DATA;
+  partition->info.subtype = subtype;
+  partition->info.address = 0x300000 + 0x10000 * hostFlash.partitions.size();
+  partition->info.size = size;
+  snprintf(partition->info.label, sizeof(partition->info.label), "%s", label);
+  partition->data.assign(size, 0xFF);
+  partition->sectorErases.assign(size / 4096, 0);
+  hostFlash.partitions.push_back(partition);
+  return partition;
+}
+
+void hostFlashRestore() {
+  hostFlash.powerBudget = -1;
+  hostFlash.powerLost = false;
+}
+
+static HostPartition* hostPartitionFor(const esp_partition_t* info) {
+  for (HostPartition* partition : hostFlash.partitions) {
+    if (&partition->info == info) {
+      return partition;
+    }
+  }
+  return nullptr;
+}
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char* label) {
+  for (HostPartition* partition : hostFlash.partitions) {
+    const esp_partition_t &info = partition->info;
+    if ((type == ESP_PARTITION_TYPE_ANY || info.type == type) &&
+        (subtype == ESP_PARTITION_SUBTYPE_ANY || info.subtype == subtype) &&
+        (!label || strcmp(info.label, label) == 0)) {
+      return &info;
+    }
+  }
+  return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* info, size_t offset, void* buffer, size_t length) {
+  HostPartition* partition = hostPartitionFor(info);
+  if (!partition || offset + length > partition->data.size()) {
+    return ESP_FAIL;
+  }
+  memcpy(buffer, partition->data.data() + offset, length);
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* info, size_t offset, const void* data, size_t length) {
+  HostPartition* partition = hostPartitionFor(info);
+  if (!partition || offset + length > partition->data.size() || hostFlash.powerLost) {
+    return ESP_FAIL;
+  }
+
+  // A cut lands part way through the write, the rest of the bytes keep their old value
+  size_t allowed = length;
+  if (hostFlash.powerBudget >= 0 && (long)length > hostFlash.powerBudget) {
+    allowed = hostFlash.powerBudget;
+    hostFlash.powerLost = true;
+  }
+  if (hostFlash.powerBudget >= 0) {
+    hostFlash.powerBudget -= allowed;
+  }
+
+  const uint8_t* bytes = (const uint8_t*)data;
+  for (size_t i = 0; i < allowed; i++) {
+    partition->data[offset + i] &= bytes[i];
+  }
+  hostFlash.bytesWritten += allowed;
+  return hostFlash.powerLost ? ESP_FAIL : ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* info, size_t offset, size_t length) {
+  HostPartition* partition = hostPartitionFor(info);
+  if (!partition || offset % 4096 || length % 4096 || offset + length > partition->data.size() ||
+      hostFlash.powerLost) {
+    return ESP_FAIL;
+  }
+
+  // With no budget left the cut lands mid-erase and leaves half a sector behind
+  if (hostFlash.powerBudget == 0) {
+    memset(partition->data.data() + offset, 0xFF, length / 2);
+    hostFlash.powerLost = true;
+    return ESP_FAIL;
+  }
+
+  memset(partition->data.data() + offset, 0xFF, length);
+  for (size_t sector = offset / 4096; sector < (offset + length) / 4096; sector++) {
+    partition->sectorErases[sector]++;
+  }
+  hostFlash.erases += length / 4096;
+  return ESP_OK;
+}
+
+// ESP-NOW
+
+HostEspNow hostEspNow;
+
+esp_err_t esp_now_init() {
+  return ESP_OK;
+}
+
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t callback) {
+  hostEspNow.receive = callback;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t* peer) {
+  return ESP_OK;
+}
+
+esp_err_t esp_now_send(const uint8_t* peer, const uint8_t* data, size_t length) {
+  hostEspNow.sent++;
+  if (hostEspNow.onSend) {
+    hostEspNow.onSend(data, length);
+  }
+  return ESP_OK;
+}
+
+void hostEspNowDeliver(const uint8_t* data, size_t length) {
+  if (hostEspNow.receive) {
+    esp_now_recv_info_t info;
+    memset(&info, 0, sizeof(info));
+    hostEspNow.receive(&info, data, (int)length);
+  }
+}
+
+// Test helpers
+
+int hostFailures = 0;
+
+double hostPercentile(std::vector<double> &samples, double percentile) {
+  if (samples.empty()) {
+    return 0;
+  }
+  std::sort(samples.begin(), samples.end());
+  size_t index = (size_t)(percentile / 100.0 * (samples.size() - 1) + 0.5);
+  return samples[min(index, samples.size() - 1)];
+}
+
+double hostWallUs() {
+  using namespace std::chrono;
+  return duration<double, std::micro>(steady_clock::now().time_since_epoch()).count();
+}
+
+int hostTestResult(const char* name) {
+  if (hostFailures) {
+    printf("%s: %d check(s) failed\n", name, hostFailures);
+    return 1;
+  }
+  printf("%s: all checks passed\n", name);
+  return 0;
+}
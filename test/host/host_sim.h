@@ -0,0 +1,154 @@
+/*
+ * host_sim.h
+ * Controls for the host stand-ins: virtual clock, background events, radio peers and flash
+ *
+ * The sketch runs single threaded on a virtual clock. Work that runs on other
+ * tasks on the device (BLE callbacks, ESP-NOW receive) is queued with hostAfter()
+ * and runs while the loop task waits in delay() or ulTaskNotifyTake(), so a
+ * loop() pass costs no virtual time and a day of activity runs in seconds.
+ */
+
+#pragma once
+#include <Arduino.h>
+#include <M5Unified.h>
+#include "BLEDevice.h"
+#include "esp_partition.h"
+#include "esp_now.h"
+#include <functional>
+#include <vector>
+
+void setup();
+void loop();
+
+// Virtual clock
+extern uint64_t hostNowUs;
+extern uint32_t hostSleeps;                 // delay(), vTaskDelay() and ulTaskNotifyTake() calls so far
+
+// Run fn on a background task at an absolute time, or after a delay from now
+void hostAt(uint64_t atUs, std::function<void()> fn);
+void hostAfter(uint64_t delayUs, std::function<void()> fn);
+
+// Move the clock forward, running background work that falls due
+void hostAdvance(uint64_t us);
+
+// Set for a real-time host build: blocks up to maxUs of wall time, returns the time waited.
+// Input that arrives meanwhile is handed to the sketch, which may wake the loop.
+extern std::function<uint64_t(uint64_t maxUs)> hostWait;
+
+// Run loop() passes until ms of virtual time have gone by
+inline void hostRunFor(unsigned long ms) {
+  uint64_t end = hostNowUs + (uint64_t)ms * 1000;
+  while (hostNowUs < end) {
+    loop();
+  }
+}
+
+// Run loop() passes until done() holds or ms have gone by, true if it held
+inline bool hostRunUntil(std::function<bool()> done, unsigned long ms) {
+  uint64_t end = hostNowUs + (uint64_t)ms * 1000;
+  while (!done()) {
+    if (hostNowUs >= end) {
+      return false;
+    }
+    loop();
+  }
+  return true;
+}
+
+// Serial
+void hostSerialInput(const char* text);
+std::string hostSerialTake();               // Output since the last call
+void hostPressButton(Button_Class &button); // Released on the next M5.update()
+void hostSetPin(uint8_t pin, int level);
+
+// Heap figures reported by ESP
+struct HostHeap {
+  uint32_t free = 180000;
+  uint32_t minFree = 150000;
+  uint32_t maxAlloc = 110000;
+  uint32_t size = 300000;
+};
+extern HostHeap hostHeap;
+
+// BLE peer side: the camera connects, writes frames and reads notifications
+struct HostBle {
+  BLEServer server;
+  BLEScan scan;
+  BLEAdvertising advertisingObject;
+  gap_event_handler gap = nullptr;
+  BLECharacteristic* writeChar = nullptr;       // Camera to remote
+  BLECharacteristic* notifyChar = nullptr;      // Remote to camera
+
+  bool advertising = false;
+  std::string advData;                          // Raw advertisement on air
+  uint32_t advDataSets = 0;
+  uint32_t advStarts = 0;                       // BLEAdvertising start() and stop() calls
+  uint32_t advStops = 0;
+  uint64_t advSetLatencyUs = 800;               // Controller time to take new raw data
+  bool connected = false;
+  uint16_t connId = 0;                          // The link the sketch's callbacks saw connect
+  uint16_t nextConnId = 1;
+  std::vector<uint16_t> otherLinks;             // Further centrals connected at the same time
+  uint32_t connParamRequests = 0;
+  int8_t rssi = -60;
+
+  std::function<void(const uint8_t* data, size_t length)> onNotify;
+  std::function<void()> onAdvertisingChanged;   // Data or on/off, after the controller took it
+  std::function<void()> onDisconnected;         // Either side dropped the link
+};
+extern HostBle hostBle;
+
+void hostBleConnect(const uint8_t bda[6]);
+void hostBleConnectOther(const uint8_t bda[6]); // Another central connects while the link is up
+void hostBleDisconnect();
+void hostBleWrite(const uint8_t* data, size_t length);
+void hostBleScanResult(const uint8_t bda[6], const std::string &payload);
+
+// RAM NOR flash: writes only clear bits, erases set a 4KB sector to 0xFF.
+// powerBudget counts the bytes written before the power is cut, -1 for never.
+struct HostPartition {
+  esp_partition_t info;
+  std::vector<uint8_t> data;
+  std::vector<uint32_t> sectorErases;
+};
+
+struct HostFlash {
+  std::vector<HostPartition*> partitions;
+  uint64_t bytesWritten = 0;
+  uint32_t erases = 0;
+  long powerBudget = -1;
+  bool powerLost = false;
+};
+extern HostFlash hostFlash;
+
+HostPartition* hostAddPartition(const char* label, esp_partition_subtype_t subtype, uint32_t size);
+void hostFlashRestore();                    // Power back on, contents kept
+
+// ESP-NOW frames handed to the radio
+struct HostEspNow {
+  esp_now_recv_cb_t receive = nullptr;
+  std::function<void(const uint8_t* data, size_t length)> onSend;
+  uint32_t sent = 0;
+};
+extern HostEspNow hostEspNow;
+
+void hostEspNowDeliver(const uint8_t* data, size_t length);
+
+// Checks and timings for the test executables
+extern int hostFailures;
+
+#define CHECK(cond) \
+  do { \
+    if (!(cond)) { \
+      printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+      hostFailures++; \
+    } \
+  } while (0)
+
+// Percentile of a sample set, the samples are sorted in place
+double hostPercentile(std::vector<double> &samples, double percentile);
+
+// Wall-clock time for benchmarks, independent of the virtual clock
+double hostWallUs();
+
+int hostTestResult(const char* name);
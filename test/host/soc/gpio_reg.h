@@ -0,0 +1,8 @@
+#pragma once
+#include <cstdint>
+
+#define GPIO_IN_REG 0x3FF4403C
+#define GPIO_IN1_REG 0x3FF44040
+
+// Input levels come from the pins set with digitalWrite() on the host
+uint32_t REG_READ(uint32_t reg);
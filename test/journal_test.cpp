@@ -0,0 +1,256 @@
+/*
+ * journal_test.cpp
+ * Shot journal on the RAM flash stand-in: when batches are written, write amplification, power cuts
+ *
+ * Write amplification is flash bytes written (and sectors erased) per record
+ * byte. A power cut is simulated in the middle of a batch and in the middle
+ * of a sector erase, then the journal is brought up again as after a reboot.
+ */
+
+#include <Arduino.h>
+#include "../insta360_m5StickC_remote.ino"
+#include "host/host_sim.h"
+#include "camera_sim.h"
+
+static const esp_partition_subtype_t JOURNAL_SUBTYPE = (esp_partition_subtype_t)0x40;
+static HostPartition* journalFlash = nullptr;
+
+// Journal state as after a reboot, staged records are gone
+static void rebootJournal() {
+  wheelCancel(&journalFlushTimer);
+  journalPartition = nullptr;
+  journalSlots = 0;
+  journalWriteSlot = 0;
+  journalNextSeq = 1;
+  journalSession = 0;
+  journalStagedCount = 0;
+  journalStats = {};
+  journalFlushWanted = false;
+  setupJournal();
+}
+
+// Sequence numbers JOURNAL would export, oldest first
+static std::vector<uint32_t> exportedSeqs() {
+  std::vector<uint32_t> seqs;
+  JournalRecord record;
+  for (uint32_t slot = journalExportStart(journalSlots); slot != journalWriteSlot; slot = (slot + 1) % journalSlots) {
+    if (readJournalSlot(slot, record)) {
+      seqs.push_back(record.seq);
+    }
+  }
+  return seqs;
+}
+
+static bool consecutive(const std::vector<uint32_t> &seqs) {
+  for (size_t i = 1; i < seqs.size(); i++) {
+    if (seqs[i] != seqs[i - 1] + 1) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Runs loop passes, noting how long after the last command each flush came. Only a full
+// staging area may be written straight after an answer, and never while a command waits.
+static std::vector<double> flushGapsMs;
+static uint32_t fullFlushes = 0;
+static void runWatched(unsigned long ms) {
+  uint64_t end = hostNowUs + (uint64_t)ms * 1000;
+  while (hostNowUs < end) {
+    uint32_t flushes = journalStats.flushes;
+    uint32_t records = journalStats.records;
+    int staged = journalStagedCount;
+    loop();
+    if (journalStats.flushes == flushes) {
+      continue;
+    }
+    CHECK(!pendingCommand.active);
+    if (journalStats.records != records && staged + 1 == JOURNAL_STAGE_SIZE) {
+      fullFlushes++;
+    } else {
+      flushGapsMs.push_back(millis() - journalLastCommandMs);
+    }
+  }
+}
+
+static void shutter(unsigned long thenMs) {
+  runRemoteAction(ACTION_SHUTTER);
+  runWatched(thenMs);
+}
+
+// The default scheme's SPIFFS partition is left alone unless journalUseSpiffs is set
+static void testSpiffsNotTaken() {
+  CHECK(!journalUseSpiffs);
+  CHECK(journalPartition == nullptr);
+  runRemoteAction(ACTION_SHUTTER);
+  hostRunFor(100);
+  CHECK(journalStats.records == 0);
+  CHECK(hostFlash.bytesWritten == 0);
+}
+
+// A full batch waits for the link to go quiet
+static void testDeferredFlush() {
+  uint32_t flushes = journalStats.flushes;
+  for (int i = 0; i < journalFlushBatch; i++) {
+    shutter(300);
+  }
+  CHECK(journalFlushWanted);
+  CHECK(journalStats.flushes == flushes);
+
+  // Another command before the link went idle pushes the write back again
+  runWatched(journalFlushIdle / 2);
+  shutter(journalFlushIdle / 2);
+  CHECK(journalStats.flushes == flushes);
+  runWatched(journalFlushIdle);
+  CHECK(journalStats.flushes == flushes + 1);
+  CHECK(journalStagedCount == 0);
+
+  // A long burst still loses nothing, a full staging area goes out at the first gap
+  for (int i = 0; i < 3 * JOURNAL_STAGE_SIZE; i++) {
+    shutter(100);
+  }
+  runWatched(journalFlushIdle + 100);
+  CHECK(journalStats.dropped == 0);
+  CHECK(journalStagedCount == 0);
+  CHECK(fullFlushes >= 2);
+  CHECK(hostPercentile(flushGapsMs, 0) >= journalFlushIdle);
+}
+
+static void testWriteAmplification(std::mt19937 &random) {
+  uint32_t records = journalStats.records;
+  uint32_t flushes = journalStats.flushes;
+  uint64_t written = hostFlash.bytesWritten;
+  uint32_t erases = hostFlash.erases;
+  flushGapsMs.clear();
+  fullFlushes = 0;
+
+  // Enough to wrap the ring: bursts of shots with pauses between them
+  const uint32_t target = journalSlots + journalSlots / 2;
+  while (journalStats.records - records < target) {
+    int burst = 1 + random() % 12;
+    for (int i = 0; i < burst; i++) {
+      shutter(100 + random() % 400);
+    }
+    runWatched(500 + random() % 15000);
+  }
+  runWatched(journalFlushInterval + journalFlushIdle);
+
+  uint32_t newRecords = journalStats.records - records;
+  uint64_t payload = (uint64_t)newRecords * sizeof(JournalRecord);
+  uint64_t bytes = hostFlash.bytesWritten - written;
+  uint32_t newErases = hostFlash.erases - erases;
+  uint32_t minErases = UINT32_MAX, maxErases = 0;
+  for (uint32_t e : journalFlash->sectorErases) {
+    minErases = min(minErases, e);
+    maxErases = max(maxErases, e);
+  }
+  printf("%u records in %u flushes (%.1f per write), written/payload %.2f, %u erases for %u KB of records, "
+         "sector erases %u-%u, flush after %.0f-%.0f ms idle or %u with the staging full\n",
+         (unsigned)newRecords, (unsigned)(journalStats.flushes - flushes),
+         (double)newRecords / (journalStats.flushes - flushes), (double)bytes / payload, (unsigned)newErases,
+         (unsigned)(payload / 1024), (unsigned)minErases, (unsigned)maxErases,
+         hostPercentile(flushGapsMs, 0), hostPercentile(flushGapsMs, 100), (unsigned)fullFlushes);
+
+  CHECK(bytes == payload);
+  CHECK(newErases <= newRecords / JOURNAL_SLOTS_PER_SECTOR + 1);
+  CHECK(maxErases - minErases <= 1);
+  CHECK(journalStats.flushes - flushes <= newRecords / 4);
+  CHECK(journalStats.dropped == 0);
+  CHECK(hostPercentile(flushGapsMs, 0) >= journalFlushIdle);
+
+  std::vector<uint32_t> seqs = exportedSeqs();
+  CHECK(seqs.size() >= journalSlots - JOURNAL_SLOTS_PER_SECTOR);
+  CHECK(consecutive(seqs));
+  CHECK(seqs.back() == journalNextSeq - 1);
+}
+
+// Stages records with the link idle and runs until they are flushed
+static void stageBatch(int count) {
+  for (int i = 0; i < count; i++) {
+    journalCommand(ACTION_SHUTTER, millis(), JOURNAL_ANSWERED);
+  }
+  CHECK(hostRunUntil([]() { return journalStagedCount == 0; }, journalFlushInterval + journalFlushIdle + 100));
+}
+
+// Power fails part way into a record: the whole records before it survive
+static void testPowerCutInBatch() {
+  stageBatch(journalFlushBatch);
+  uint32_t lastSafe = journalNextSeq - 1;
+  uint16_t session = journalSession;
+
+  hostFlash.powerBudget = 5 * sizeof(JournalRecord) + 7;
+  stageBatch(journalFlushBatch);
+  CHECK(hostFlash.powerLost);
+  hostFlashRestore();
+  rebootJournal();
+
+  printf("power cut in a batch: next record %lu, %lu torn\n", (unsigned long)journalNextSeq,
+         (unsigned long)journalStats.torn);
+  CHECK(journalStats.torn == 1);
+  CHECK(journalNextSeq == lastSafe + 6);
+  CHECK(journalSession == session + 1);
+  std::vector<uint32_t> seqs = exportedSeqs();
+  CHECK(consecutive(seqs));
+  CHECK(seqs.back() == lastSafe + 5);
+
+  // Writing carries on past the torn record
+  stageBatch(3);
+  seqs = exportedSeqs();
+  CHECK(seqs.back() == lastSafe + 8);
+  JournalRecord record;
+  CHECK(readJournalSlot((journalWriteSlot + journalSlots - 1) % journalSlots, record));
+  CHECK(record.session == session + 1);
+}
+
+// Power fails while the next sector is being erased
+static void testPowerCutInErase() {
+  uint32_t room = JOURNAL_SLOTS_PER_SECTOR - journalWriteSlot % JOURNAL_SLOTS_PER_SECTOR;
+  while (room > 0) {
+    int count = min((uint32_t)JOURNAL_STAGE_SIZE, room);
+    stageBatch(count);
+    room -= count;
+  }
+  CHECK(journalWriteSlot % JOURNAL_SLOTS_PER_SECTOR == 0);
+  uint32_t lastSafe = journalNextSeq - 1;
+
+  hostFlash.powerBudget = 0;
+  stageBatch(4);
+  CHECK(hostFlash.powerLost);
+  hostFlashRestore();
+  rebootJournal();
+
+  uint32_t sector = journalWriteSlot / JOURNAL_SLOTS_PER_SECTOR;
+  printf("power cut in an erase: next record %lu at slot %lu\n", (unsigned long)journalNextSeq,
+         (unsigned long)journalWriteSlot);
+  CHECK(journalNextSeq == lastSafe + 1);
+  CHECK(journalWriteSlot % JOURNAL_SLOTS_PER_SECTOR == 0);
+
+  // The half-erased sector is erased again before use
+  uint32_t sectorErases = journalFlash->sectorErases[sector];
+  stageBatch(4);
+  CHECK(journalFlash->sectorErases[sector] == sectorErases + 1);
+  std::vector<uint32_t> seqs = exportedSeqs();
+  CHECK(consecutive(seqs));
+  CHECK(seqs.back() == lastSafe + 4);
+}
+
+int main() {
+  hostAddPartition("spiffs", ESP_PARTITION_SUBTYPE_DATA_SPIFFS, 1024 * 1024);
+  hostCamera.heartbeatMs = 1000;
+  hostCameraPair();
+  setup();
+  hostRunUntil([]() { return deviceConnected; }, 5000);
+  testSpiffsNotTaken();
+
+  journalFlash = hostAddPartition("journal", JOURNAL_SUBTYPE, 16 * JOURNAL_SECTOR_SIZE);
+  rebootJournal();
+  CHECK(journalPartition == &journalFlash->info);
+
+  std::mt19937 random(5);
+  testDeferredFlush();
+  testWriteAmplification(random);
+  testPowerCutInBatch();
+  testPowerCutInErase();
+
+  return hostTestResult("journal_test");
+}
@@ -0,0 +1,117 @@
+/*
+ * loop_stall_test.cpp
+ * Loop stall log: a pass stuck in the BLE stack is caught while it runs, with the phase it is stuck in
+ *
+ * The watchdog task is not started on the host, a background event calls
+ * checkLoopStall() every loopWatchdogInterval in its place. A stall is made
+ * by holding up the notify of a command, the way a congested BLE stack does.
+ */
+
+#include <Arduino.h>
+#include "../insta360_m5StickC_remote.ino"
+#include "host/host_sim.h"
+#include "camera_sim.h"
+
+static bool watchdogRunning = false;
+static unsigned long notifyHoldMs = 0;      // Time the next notify blocks the loop
+static uint32_t stallsWhileStuck = 0;       // Stalls logged by the time the notify returns
+
+static void watchdogTick() {
+  if (!watchdogRunning) {
+    return;
+  }
+  checkLoopStall();
+  hostAfter(loopWatchdogInterval * 1000, watchdogTick);
+}
+
+static void startWatchdog() {
+  watchdogRunning = true;
+  watchdogTick();
+}
+
+static void stuckNotify(const uint8_t* data, size_t length) {
+  if (notifyHoldMs) {
+    delay(notifyHoldMs);
+    notifyHoldMs = 0;
+    stallsWhileStuck = loopStallCount;
+  }
+  hostCameraCommand(data, length);
+}
+
+static const LoopStall &lastStall() {
+  return loopStalls[(loopStallCount - 1) % LOOP_STALL_LOG_SIZE];
+}
+
+// Ordinary passes and the sleep between them are never taken for a stall
+static void testNoFalseStalls() {
+  hostRunFor(10000);
+  CHECK(loopStallCount == 0);
+}
+
+// A pass stuck in a serial SHUTTER is logged before it returns, in the io phase
+static void testCaughtWhileStuck() {
+  notifyHoldMs = 500;
+  hostSerialInput("SHUTTER s1\n");
+  hostRunFor(600);
+
+  const LoopStall &stall = lastStall();
+  printf("stuck 500ms: caught=%d in %s, pass %lums, phase %lums\n", stall.caught, loopPhaseNames[stall.phase],
+         (unsigned long)(stall.passUs / 1000), (unsigned long)(stall.phaseUs / 1000));
+  CHECK(stallsWhileStuck == 1);
+  CHECK(loopStallCount == 1);
+  CHECK(stall.caught);
+  CHECK(stall.phase == LOOP_PHASE_IO);
+  CHECK(stall.passUs >= 500000);              // Filled in once the pass ended
+  CHECK(stall.phaseUs >= 500000);
+}
+
+// A button press stuck just past the threshold is caught in the buttons phase
+static void testButtonPhase() {
+  CHECK(hostRunUntil([]() { return !overlayActive; }, 5000));
+  currentScreen = SCREEN_SHUTTER;
+  notifyHoldMs = loopStallThreshold / 1000 + 2 * loopWatchdogInterval;
+  hostPressButton(M5.BtnA);
+  hostRunFor(2500);
+  CHECK(loopStallCount == 2);
+  CHECK(lastStall().caught);
+  CHECK(lastStall().phase == LOOP_PHASE_BUTTONS);
+}
+
+// Without the watchdog a finished pass is still logged, with its slowest phase
+static void testFinishedPass() {
+  watchdogRunning = false;
+  notifyHoldMs = 50;
+  hostSerialInput("SHUTTER s2\n");
+  hostRunFor(600);
+  CHECK(loopStallCount == 3);
+  CHECK(!lastStall().caught);
+  CHECK(lastStall().phase == LOOP_PHASE_IO);
+  CHECK(lastStall().passUs >= 50000);
+
+  hostSerialTake();
+  hostSerialInput("LOOP l1\n");
+  hostRunFor(100);
+  std::string output = hostSerialTake();
+  CHECK(output.find("phase=io phase_us=") != std::string::npos);
+  CHECK(output.find("caught=1") != std::string::npos);
+  CHECK(output.find("caught=0") != std::string::npos);
+  CHECK(output.find("@OK LOOP l1 stalls=3") != std::string::npos);
+}
+
+int main() {
+  hostCamera.heartbeatMs = 1000;
+  hostCameraPair();
+  setup();
+  hostBle.onNotify = stuckNotify;
+  CHECK(hostRunUntil([]() { return deviceConnected; }, 5000));
+  hostRunFor(1000);
+  loopStallCount = 0;                         // Boot passes do not count
+
+  startWatchdog();
+  testNoFalseStalls();
+  testCaughtWhileStuck();
+  testButtonPhase();
+  testFinishedPass();
+
+  return hostTestResult("loop_stall_test");
+}
@@ -0,0 +1,132 @@
+/*
+ * macro_test.cpp
+ * Macros over serial against a simulated camera: total macro time, and failure on a lost answer
+ *
+ * Each step should start as soon as the camera has answered the one before,
+ * so a macro takes about the sum of the camera's answer times. Before macros
+ * the same sequence was four button presses, each held 2 s by its feedback
+ * screen.
+ */
+
+#include <Arduino.h>
+#include "../insta360_m5StickC_remote.ino"
+#include "host/host_sim.h"
+#include "camera_sim.h"
+
+// Sends one serial line and returns the closing reply for its tag
+static std::string request(const std::string &line, const char* tag) {
+  hostSerialTake();
+  hostSerialInput((line + "\n").c_str());
+  hostRunFor(5);
+  std::string output = hostSerialTake();
+  for (const char* start : {"@OK ", "@ERR "}) {
+    size_t at = output.find(start);
+    while (at != std::string::npos) {
+      std::string reply = output.substr(at, output.find('\n', at) - at);
+      if (reply.find(std::string(" ") + tag + " ") != std::string::npos) {
+        return reply;
+      }
+      at = output.find(start, at + 1);
+    }
+  }
+  return "";
+}
+
+// Runs macro n over serial to the end, returns its time as the remote measured it
+static unsigned long runMacroTimed(int n, const char* tag) {
+  char line[32];
+  snprintf(line, sizeof(line), "RUN %s %d", tag, n);
+  uint64_t start = hostNowUs;
+  std::string reply = request(line, tag);
+  CHECK(reply.rfind(std::string("@OK RUN ") + tag + " macro=", 0) == 0);
+  CHECK(hostRunUntil([]() { return runningMacro < 0; }, 30000));
+  unsigned long hostMs = (unsigned long)((hostNowUs - start) / 1000);
+  CHECK(macroStats.last == n - 1);
+  CHECK(macroStats.lastMs <= hostMs);
+  hostRunFor(2000);           // Let the result overlay go
+  return macroStats.lastMs;
+}
+
+static void testStoreOverSerial() {
+  // A full macro is well past the old 48 byte line
+  std::string steps;
+  for (int i = 0; i < MACRO_MAX_STEPS - 1; i++) {
+    steps += (i % 3 == 2) ? "WAIT=10 " : (i % 3 == 1 ? "ACK " : "SHUTTER ");
+  }
+  std::string line = "MACRO m1 3 " + steps;
+  printf("MACRO line of %zu bytes\n", line.size());
+  CHECK(line.size() > 48 && line.size() < SERIAL_API_LINE_MAX);
+  CHECK(request(line, "m1").rfind("@OK MACRO m1 macro=3", 0) == 0);
+  CHECK(macros[2][MACRO_MAX_STEPS - 2].op == MACRO_WAIT);
+
+  CHECK(request("MACRO m2 2 MODE ACK MODE UNTIL=Timeshift SHUTTER ACK WAIT=200 SCREEN ACK", "m2").rfind("@OK MACRO m2 macro=2", 0) == 0);
+  CHECK(request("MACRO m3 2 FLASH", "m3") == "@ERR MACRO m3 BAD_MACRO");
+  CHECK(request("MACRO m4 9 SHUTTER", "m4") == "@ERR MACRO m4 BAD_MACRO");
+
+  // WAIT takes 0 to 65535 ms, anything else is refused rather than wrapped
+  CHECK(request("MACRO w1 3 SHUTTER WAIT=65535", "w1").rfind("@OK MACRO w1 macro=3", 0) == 0);
+  CHECK(macros[2][1].op == MACRO_WAIT && macros[2][1].arg == 65535);
+  for (const char* wait : {"WAIT=65536", "WAIT=70000", "WAIT=-5", "WAIT=abc", "WAIT=10ms", "WAIT=", "WAIT=+5"}) {
+    CHECK(request(std::string("MACRO w2 3 SHUTTER ") + wait, "w2") == "@ERR MACRO w2 BAD_MACRO");
+  }
+  CHECK(macros[2][1].arg == 65535);           // A refused macro leaves the stored one alone
+  CHECK(request(line, "m1").rfind("@OK MACRO m1 macro=3", 0) == 0);
+  CHECK(request("RUN r0 7", "r0") == "@ERR RUN r0 BAD_MACRO");
+
+  // Past the line buffer the reply still names the request
+  std::string tooLong = "MACRO m5 1";
+  while (tooLong.size() < SERIAL_API_LINE_MAX) {
+    tooLong += " SHUTTER";
+  }
+  CHECK(request(tooLong, "m5") == "@ERR MACRO m5 LINE_TOO_LONG");
+}
+
+static void testTotalTime() {
+  const unsigned long answerMs = hostCamera.answerUs / 1000;
+
+  // MODE ACK SHUTTER ACK SCREEN: two answers waited for, the last command is not
+  hostCamera.mode = 0;
+  unsigned long builtinMs = runMacroTimed(1, "r1");
+  CHECK(macroStats.lastCompleted);
+
+  // Two MODE presses to reach Timeshift, then the shutter and a 200 ms pause
+  hostCamera.mode = 0;
+  unsigned long storedMs = runMacroTimed(2, "r2");
+  CHECK(macroStats.lastCompleted);
+  CHECK(lastModeEntry == 2);
+
+  unsigned long fifteenMs = runMacroTimed(3, "r3");
+  CHECK(macroStats.lastCompleted);
+
+  printf("camera answers in %lums: macro 1 %lums, macro 2 %lums, 15 step macro %lums (button presses: %lums)\n",
+         answerMs, builtinMs, storedMs, fifteenMs, 4 * 2000UL);
+  CHECK(builtinMs >= 2 * answerMs && builtinMs <= 2 * answerMs + 10);
+  CHECK(storedMs >= 4 * answerMs + 200 && storedMs <= 4 * answerMs + 200 + 20);
+  CHECK(fifteenMs >= 5 * answerMs + 50 && fifteenMs <= 5 * answerMs + 50 + 20);
+}
+
+// A lost answer stops the macro at its ACK once the command times out
+static void testLostAnswer() {
+  hostCamera.loseAnswers = 1;
+  unsigned long failedMs = runMacroTimed(1, "r4");
+  CHECK(!macroStats.lastCompleted);
+  CHECK(failedMs >= commandAckTimeout && failedMs <= commandAckTimeout + 50);   // Ack timeouts run at the loop's pace
+
+  std::string reply = request("MACROS l1", "l1");
+  printf("%s\n", reply.c_str());
+  CHECK(reply.rfind("@OK MACROS l1 last=1 last_ok=0 last_ms=", 0) == 0);
+}
+
+int main() {
+  hostCamera.heartbeatMs = 1000;
+  hostCameraPair();
+  setup();
+  hostRunUntil([]() { return deviceConnected; }, 5000);
+  hostRunFor(1000);
+
+  testStoreOverSerial();
+  testTotalTime();
+  testLostAnswer();
+
+  return hostTestResult("macro_test");
+}
@@ -0,0 +1,57 @@
+/*
+ * mode_db_test.cpp
+ * Mode names for status frame signatures: per-model entries, the built-in fallback and learning
+ */
+
+#include <Arduino.h>
+#include "../insta360_m5StickC_remote.ino"
+#include "host/host_sim.h"
+
+static const uint8_t UNKNOWN_SIG[MODE_SIG_LENGTH] = {0x41, 0x42, 0x43, 0x44, 0x45};
+
+// Name shown for a signature with the given camera paired
+static std::string modeName(const char* camera, const uint8_t* sig) {
+  snprintf(currentCamera.name, sizeof(currentCamera.name), "%s", camera);
+  char name[MODE_LABEL_LENGTH + 8];
+  modeNameForSignature(sig, name, sizeof(name));
+  return name;
+}
+
+static void testBuiltin() {
+  for (const char* camera : {"X5 1ABCDE", "X4 1ABCDE", ""}) {
+    CHECK(modeName(camera, builtinModeSignatures[0].sig) == "Camera");
+    CHECK(lastModeEntry == 0);
+    CHECK(modeName(camera, builtinModeSignatures[1].sig) == "Video");
+    CHECK(modeName(camera, builtinModeSignatures[2].sig) == "Timeshift");
+    CHECK(modeName(camera, builtinModeSignatures[3].sig) == "Loop Record");
+  }
+  CHECK(cameraModelFromName("") == MODEL_UNKNOWN);
+
+  // Nothing was learned for the X4 or the unknown camera
+  CHECK(numLearnedSigs == 0);
+}
+
+// Unknown bytes are learned per model, and a label applies to that model only
+static void testLearned() {
+  CHECK(modeName("X4 1ABCDE", UNKNOWN_SIG) == "Sig #4");
+  CHECK(numLearnedSigs == 1);
+  CHECK(modeName("X4 1ABCDE", UNKNOWN_SIG) == "Sig #4");
+  CHECK(numLearnedSigs == 1);
+  CHECK(labelModeSignature(4, "Bullet"));
+  CHECK(modeName("X4 1ABCDE", UNKNOWN_SIG) == "Bullet");
+
+  CHECK(modeName("", UNKNOWN_SIG) == "Sig #5");
+  CHECK(modeName("X5 1ABCDE", UNKNOWN_SIG) == "Sig #6");
+  CHECK(numLearnedSigs == 3);
+
+  // The built-in names still win for every model
+  CHECK(modeName("X4 1ABCDE", builtinModeSignatures[1].sig) == "Video");
+  CHECK(modeName("", builtinModeSignatures[1].sig) == "Video");
+}
+
+int main() {
+  loadModeSignatures();
+  testBuiltin();
+  testLearned();
+  return hostTestResult("mode_db_test");
+}
@@ -0,0 +1,137 @@
+/*
+ * mode_select_test.cpp
+ * GOTO over serial against a simulated camera: mode reach time, learned press counts, a changed mode cycle
+ *
+ * Each press waits for the camera's mode report, so reaching a mode should
+ * take the camera's answer time per press. Once the cycle is learned the
+ * press count GOTO predicts should be the one it needs.
+ */
+
+#include <Arduino.h>
+#include "../insta360_m5StickC_remote.ino"
+#include "host/host_sim.h"
+#include "camera_sim.h"
+
+// Sends one serial line and returns the closing reply for its tag
+static std::string request(const std::string &line, const char* tag) {
+  hostSerialTake();
+  hostSerialInput((line + "\n").c_str());
+  hostRunFor(1);
+  std::string output = hostSerialTake();
+  for (const char* start : {"@OK ", "@ERR "}) {
+    size_t at = output.find(start);
+    while (at != std::string::npos) {
+      std::string reply = output.substr(at, output.find('\n', at) - at);
+      if (reply.find(std::string(" ") + tag + " ") != std::string::npos) {
+        return reply;
+      }
+      at = output.find(start, at + 1);
+    }
+  }
+  return "";
+}
+
+static int replyField(const std::string &reply, const char* key) {
+  size_t at = reply.find(std::string(" ") + key + "=");
+  return at == std::string::npos ? -99 : atoi(reply.c_str() + at + strlen(key) + 2);
+}
+
+struct GotoResult {
+  bool reached;
+  int predicted;
+  int steps;
+  unsigned long ms;
+};
+
+static GotoResult gotoMode(const char* mode) {
+  static int tagCount = 0;
+  char tag[16];
+  snprintf(tag, sizeof(tag), "g%d", ++tagCount);
+  uint32_t reached = modeSelectStats.reached;
+
+  std::string reply = request(std::string("GOTO ") + tag + " " + mode, tag);
+  CHECK(reply.rfind(std::string("@OK GOTO ") + tag + " entry=", 0) == 0);
+  CHECK(hostRunUntil([]() { return !modeSelect.active; }, 10000));
+  GotoResult result = {modeSelectStats.reached != reached, replyField(reply, "predicted"),
+                       modeSelectStats.lastSteps, modeSelectStats.lastMs};
+  hostRunFor(2000);           // Let the result overlay go
+  return result;
+}
+
+static void testLearnAndReach() {
+  const unsigned long answerMs = hostCamera.answerUs / 1000;
+
+  // Nothing known yet: the first GOTO finds its way and teaches the cycle
+  GotoResult first = gotoMode("Timeshift");
+  CHECK(first.reached);
+  CHECK(first.predicted == -1);
+  CHECK(lastModeEntry == 2);
+  gotoMode("Camera");
+  gotoMode("Video");
+
+  std::vector<double> reachMs;
+  std::vector<double> msPerPress;
+  std::mt19937 random(9);
+  const char* const modes[] = {"Camera", "Video", "Timeshift", "0", "1", "2"};
+  int mispredicted = 0;
+  for (int i = 0; i < 60; i++) {
+    GotoResult result = gotoMode(modes[random() % 6]);
+    CHECK(result.reached);
+    mispredicted += (result.predicted != result.steps);
+    reachMs.push_back(result.ms);
+    if (result.steps) {
+      msPerPress.push_back((double)result.ms / result.steps);
+    }
+  }
+  printf("camera answers in %lums: reach p50 %.0fms max %.0fms, %.1fms per press, %d of 60 mispredicted\n",
+         answerMs, hostPercentile(reachMs, 50), hostPercentile(reachMs, 100),
+         hostPercentile(msPerPress, 50), mispredicted);
+  CHECK(mispredicted == 0);
+  CHECK(hostPercentile(reachMs, 100) <= 2 * answerMs + 10);
+  CHECK(hostPercentile(msPerPress, 100) <= answerMs + 5);
+}
+
+// The camera's mode list changes: the old prediction is wrong once, then relearned
+static void testChangedCycle() {
+  hostCamera.cycle[1] = 2;
+  hostCamera.cycle[2] = 1;
+  uint32_t relearned = modeSelectStats.relearned;
+
+  GotoResult changed = gotoMode("Timeshift");
+  CHECK(changed.reached);
+  gotoMode("Camera");
+  gotoMode("Video");
+  CHECK(modeSelectStats.relearned > relearned);
+
+  GotoResult again = gotoMode("Timeshift");
+  CHECK(again.reached);
+  CHECK(again.predicted == again.steps);
+}
+
+// A mode the camera never reports gives up after modeSelectMaxSteps presses
+static void testUnreachable() {
+  uint32_t failed = modeSelectStats.failed;
+  GotoResult result = gotoMode("Loop Record");
+  CHECK(!result.reached);
+  CHECK(result.steps == modeSelectMaxSteps);
+  CHECK(modeSelectStats.failed == failed + 1);
+
+  CHECK(request("GOTO e1 Nope", "e1") == "@ERR GOTO e1 BAD_MODE");
+  CHECK(request("GOTO e2", "e2") == "@ERR GOTO e2 BAD_MODE");
+  std::string modes = request("MODES m1", "m1");
+  CHECK(modes.rfind("@OK MODES m1 reached=", 0) == 0);
+}
+
+int main() {
+  hostCamera.heartbeatMs = 1000;
+  hostCameraPair();
+  setup();
+  hostRunUntil([]() { return deviceConnected; }, 5000);
+  hostRunFor(1000);
+
+  testLearnAndReach();
+  testChangedCycle();
+  testUnreachable();
+
+  return hostTestResult("mode_select_test");
+}
@@ -0,0 +1,112 @@
+/*
+ * motion_test.cpp
+ * Gesture detector against a synthetic 200 Hz IMU trace: detections, false triggers, latency and cost
+ */
+
+#include <Arduino.h>
+#include "../insta360_m5StickC_remote.ino"
+#include "host/host_sim.h"
+
+struct TraceGesture {
+  unsigned long atMs;
+  int kind;                   // 0 single tap, 1 double tap, 2 flick, 3 long twist
+};
+
+static const TraceGesture traceGestures[] = {
+  {12000, 1},
+  {20000, 2},
+  {45000, 1},
+  {50000, 0},
+  {55000, 3},
+};
+
+// Hand-held noise well under the tap threshold, never still outside 30-35 s
+static void traceSample(unsigned long ms, int32_t accel[3], int32_t gyro[3]) {
+  bool still = ms >= 30000 && ms < 35000;
+  int accelNoise = still ? 20 : 300;
+  int gyroNoise = still ? 2 : 40;
+  accel[0] = rand() % (2 * accelNoise + 1) - accelNoise;
+  accel[1] = rand() % (2 * accelNoise + 1) - accelNoise;
+  accel[2] = 1000 + rand() % (2 * accelNoise + 1) - accelNoise;
+  for (int i = 0; i < 3; i++) {
+    gyro[i] = rand() % (2 * gyroNoise + 1) - gyroNoise;
+  }
+
+  for (const TraceGesture &g : traceGestures) {
+    long t = (long)ms - (long)g.atMs;
+    bool tap = (t >= 0 && t < 10) || (g.kind == 1 && t >= 150 && t < 160);
+    if (g.kind <= 1 && tap) {
+      accel[2] += 2500;
+    }
+    if ((g.kind == 2 && t >= 0 && t < 120) || (g.kind == 3 && t >= 0 && t < 600)) {
+      gyro[0] = 600;
+    }
+  }
+}
+
+static void testTrace() {
+  motionQueue = xQueueCreate(8, sizeof(MotionEvent));
+  motionDetector = {};
+  motionStats = {};
+  srand(3);
+
+  const unsigned long traceMs = 60000;
+  uint32_t counts[NUM_GESTURES] = {};
+  unsigned long detectedAtMs[NUM_GESTURES][4] = {};
+  uint32_t latencyUs[NUM_GESTURES][4] = {};
+  double costUs = 0;
+  int samples = 0;
+
+  for (unsigned long ms = 0; ms < traceMs; ms += motionSampleInterval) {
+    int32_t accel[3], gyro[3];
+    traceSample(ms, accel, gyro);
+
+    double start = hostWallUs();
+    processMotionSample(accel, gyro, ms * 1000);
+    costUs += hostWallUs() - start;
+    samples++;
+
+    MotionEvent event;
+    while (xQueueReceive(motionQueue, &event, 0) == pdTRUE) {
+      uint32_t n = counts[event.gesture]++;
+      if (n < 4) {
+        detectedAtMs[event.gesture][n] = ms;
+        latencyUs[event.gesture][n] = event.latencyUs;
+      }
+    }
+  }
+
+  printf("trace: %d samples, %u double taps, %u flicks, %u stills, %.0fns per sample\n", samples,
+         (unsigned)counts[GESTURE_DOUBLE_TAP], (unsigned)counts[GESTURE_FLICK], (unsigned)counts[GESTURE_STILL],
+         costUs * 1000 / samples);
+  for (int g = 0; g < NUM_GESTURES; g++) {
+    for (uint32_t n = 0; n < min(counts[g], (uint32_t)4); n++) {
+      printf("  %s at %lums, latency %lums\n", motionGestureName((MotionGesture)g), detectedAtMs[g][n],
+             (unsigned long)latencyUs[g][n] / 1000);
+    }
+  }
+
+  // Both double taps, the second tap is where they are detected; the lone tap and the slow twist do nothing
+  CHECK(counts[GESTURE_DOUBLE_TAP] == 2);
+  CHECK(detectedAtMs[GESTURE_DOUBLE_TAP][0] == 12150);
+  CHECK(detectedAtMs[GESTURE_DOUBLE_TAP][1] == 45150);
+  CHECK(latencyUs[GESTURE_DOUBLE_TAP][0] == 150000);
+
+  // The flick is detected as soon as the rotation stops
+  CHECK(counts[GESTURE_FLICK] == 1);
+  CHECK(detectedAtMs[GESTURE_FLICK][0] == 20120);
+  CHECK(latencyUs[GESTURE_FLICK][0] == 120000);
+
+  // Still once, motionStillTime after the gravity estimate settled on the resting hand
+  CHECK(counts[GESTURE_STILL] == 1);
+  CHECK(detectedAtMs[GESTURE_STILL][0] >= 30000 + motionStillTime);
+  CHECK(detectedAtMs[GESTURE_STILL][0] <= 30000 + motionStillTime + 500);
+
+  // The detector runs on the motion task every motionSampleInterval, it must be a tiny part of that
+  CHECK(costUs / samples < motionSampleInterval * 1000 / 100.0);
+}
+
+int main() {
+  testTrace();
+  return hostTestResult("motion_test");
+}
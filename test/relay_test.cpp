@@ -0,0 +1,204 @@
+/*
+ * relay_test.cpp
+ * Trigger relay from one master to several slaves over UDP loopback: latency, skew between slaves, duplicates
+ *
+ * The master sends through a RelayTransport that writes each copy to every
+ * slave's UDP socket on 127.0.0.1, as a broadcast would. Each slave runs
+ * relayAccept() with its own state, counters and clock offset. Latency is
+ * wall time from the first copy sent to the slave deciding to fire, skew the
+ * spread of those times across slaves for one trigger.
+ */
+
+#include <Arduino.h>
+#include "../insta360_m5StickC_remote.ino"
+#include "host/host_sim.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <random>
+#include <sys/socket.h>
+#include <unistd.h>
+
+const int NUM_SLAVES = 8;
+
+struct HostSlave {
+  int socket;
+  sockaddr_in address;
+  uint32_t clockOffset;       // Slave clocks are not synchronised with the master's
+  RelayReceiver receiver;
+  RelayStats stats;
+  double firedAtUs;
+};
+
+static HostSlave slaves[NUM_SLAVES];
+
+static uint32_t slaveClock(const HostSlave &slave) {
+  return (uint32_t)hostWallUs() + slave.clockOffset;
+}
+
+// Loopback stand-in for the ESP-NOW broadcast
+class UdpLoopbackTransport : public RelayTransport {
+  public:
+    bool begin() {
+      sender = socket(AF_INET, SOCK_DGRAM, 0);
+      return sender >= 0;
+    }
+
+    bool send(const uint8_t* data, size_t length) {
+      bool sent = true;
+      for (HostSlave &slave : slaves) {
+        sent &= sendto(sender, data, length, 0, (sockaddr*)&slave.address, sizeof(slave.address)) == (ssize_t)length;
+      }
+      return sent;
+    }
+
+  private:
+    int sender = -1;
+};
+
+static bool openSlave(HostSlave &slave, uint32_t clockOffset) {
+  slave.socket = socket(AF_INET, SOCK_DGRAM, 0);
+  memset(&slave.address, 0, sizeof(slave.address));
+  slave.address.sin_family = AF_INET;
+  slave.address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  slave.address.sin_port = 0;
+  socklen_t length = sizeof(slave.address);
+  if (slave.socket < 0 || bind(slave.socket, (sockaddr*)&slave.address, sizeof(slave.address)) != 0 ||
+      getsockname(slave.socket, (sockaddr*)&slave.address, &length) != 0) {
+    return false;
+  }
+  slave.clockOffset = clockOffset;
+  slave.receiver = {};
+  slave.stats = {};
+  return true;
+}
+
+// Hands every datagram that arrives within waitMs to its slave, returns the copies received
+static int drainSlaves(int expected, int waitMs) {
+  struct pollfd fds[NUM_SLAVES];
+  for (int i = 0; i < NUM_SLAVES; i++) {
+    fds[i] = {slaves[i].socket, POLLIN, 0};
+  }
+
+  int received = 0;
+  double end = hostWallUs() + waitMs * 1000.0;
+  while (received < expected && hostWallUs() < end) {
+    if (poll(fds, NUM_SLAVES, 1) <= 0) {
+      continue;
+    }
+    for (int i = 0; i < NUM_SLAVES; i++) {
+      if (!(fds[i].revents & POLLIN)) {
+        continue;
+      }
+      HostSlave &slave = slaves[i];
+      RelayInbound inbound;
+      if (recv(slave.socket, &inbound.message, sizeof(inbound.message), 0) != sizeof(inbound.message)) {
+        continue;
+      }
+      inbound.rxMicros = slaveClock(slave);
+      received++;
+      if (relayAccept(slave.receiver, slave.stats, inbound, slaveClock(slave))) {
+        slave.firedAtUs = hostWallUs();
+      }
+    }
+  }
+  hostSerialTake();
+  return received;
+}
+
+// Sends one trigger as relayTrigger() does, sentLateUs backdates the copies
+static double sendTrigger(RelayTransport &transport, uint32_t bootId, uint32_t seq, uint32_t masterOffset,
+                          uint32_t sentLateUs = 0) {
+  for (HostSlave &slave : slaves) {
+    slave.firedAtUs = 0;
+  }
+  RelayMessage message = relayMessage(ACTION_SHUTTER, bootId, seq);
+  double start = hostWallUs();
+  for (int i = 0; i < relayRepeats; i++) {
+    message.sentMicros = (uint32_t)hostWallUs() + masterOffset - sentLateUs;
+    transport.send((const uint8_t*)&message, sizeof(message));
+  }
+  return start;
+}
+
+static uint32_t totalOf(uint32_t RelayStats::*field) {
+  uint32_t total = 0;
+  for (HostSlave &slave : slaves) {
+    total += slave.stats.*field;
+  }
+  return total;
+}
+
+int main() {
+  UdpLoopbackTransport transport;
+  CHECK(transport.begin());
+  std::mt19937 random(3);
+  for (HostSlave &slave : slaves) {
+    CHECK(openSlave(slave, random()));
+  }
+
+  const uint32_t masterOffset = random();
+  const uint32_t bootId = random() | 1;
+  const int triggers = 300;
+  std::vector<double> latencyUs;
+  std::vector<double> skewUs;
+  int missing = 0;
+
+  for (uint32_t seq = 1; seq <= (uint32_t)triggers; seq++) {
+    double start = sendTrigger(transport, bootId, seq, masterOffset);
+    drainSlaves(NUM_SLAVES * relayRepeats, 100);
+
+    double first = 0, last = 0;
+    for (HostSlave &slave : slaves) {
+      if (!slave.firedAtUs) {
+        missing++;
+        continue;
+      }
+      latencyUs.push_back(slave.firedAtUs - start);
+      first = first ? min(first, slave.firedAtUs) : slave.firedAtUs;
+      last = max(last, slave.firedAtUs);
+    }
+    skewUs.push_back(last - first);
+  }
+
+  printf("%d triggers to %d slaves, %d copies each: latency p50 %.0fus p95 %.0fus max %.0fus, "
+         "skew p50 %.0fus p95 %.0fus, jitter seen by slaves max %luus\n",
+         triggers, NUM_SLAVES, relayRepeats, hostPercentile(latencyUs, 50), hostPercentile(latencyUs, 95),
+         hostPercentile(latencyUs, 100), hostPercentile(skewUs, 50), hostPercentile(skewUs, 95),
+         (unsigned long)slaves[0].stats.jitterMaxUs);
+
+  // Every slave fires every trigger once, the repeats are dropped
+  CHECK(missing == 0);
+  CHECK(totalOf(&RelayStats::fired) == (uint32_t)(triggers * NUM_SLAVES));
+  CHECK(totalOf(&RelayStats::duplicates) == (uint32_t)(triggers * NUM_SLAVES * (relayRepeats - 1)));
+  CHECK(totalOf(&RelayStats::stale) == 0);
+  CHECK(hostPercentile(latencyUs, 50) < 2000);
+  CHECK(hostPercentile(skewUs, 50) < 2000);
+
+  // A trigger held up past relayMaxAge is dropped by every slave
+  sendTrigger(transport, bootId, triggers + 1, masterOffset, (relayMaxAge + 50) * 1000);
+  drainSlaves(NUM_SLAVES * relayRepeats, 100);
+  CHECK(totalOf(&RelayStats::stale) == NUM_SLAVES);
+  CHECK(totalOf(&RelayStats::fired) == (uint32_t)(triggers * NUM_SLAVES));
+
+  // A replayed old trigger is a duplicate, a master reboot starts a new sequence
+  uint32_t duplicates = totalOf(&RelayStats::duplicates);
+  sendTrigger(transport, bootId, 5, masterOffset);
+  drainSlaves(NUM_SLAVES * relayRepeats, 100);
+  CHECK(totalOf(&RelayStats::duplicates) == duplicates + NUM_SLAVES * relayRepeats);
+  sendTrigger(transport, bootId + 2, 1, masterOffset + 123456789);
+  drainSlaves(NUM_SLAVES * relayRepeats, 100);
+  CHECK(totalOf(&RelayStats::fired) == (uint32_t)((triggers + 1) * NUM_SLAVES));
+
+  // Another group's frames are rejected
+  RelayMessage other = relayMessage(ACTION_SHUTTER, bootId, triggers + 10);
+  other.group[3] ^= 1;
+  transport.send((const uint8_t*)&other, sizeof(other));
+  drainSlaves(NUM_SLAVES, 100);
+  CHECK(totalOf(&RelayStats::rejected) == NUM_SLAVES);
+
+  for (HostSlave &slave : slaves) {
+    close(slave.socket);
+  }
+  return hostTestResult("relay_test");
+}
@@ -0,0 +1,76 @@
+/*
+ * rig_wake_test.cpp
+ * Waking a rig of three cameras while one is linked: one link at a time, the others counted as awake
+ *
+ * The remote keeps a single camera link. A rig camera that connects while it
+ * is up is marked awake for the wake and dropped, and the linked camera's
+ * state is left alone.
+ */
+
+#include <Arduino.h>
+#include "../insta360_m5StickC_remote.ino"
+#include "host/host_sim.h"
+#include "camera_sim.h"
+
+static const uint8_t otherBda[2][6] = {{0x24, 0x0a, 0xc4, 0x44, 0x55, 0x66}, {0x24, 0x0a, 0xc4, 0x77, 0x88, 0x99}};
+
+static bool rigAwake(int entry) {
+  return rigConnectedMask & (1 << entry);
+}
+
+// The linked camera is the last one paired, rig entry 2
+static void testWakeWhileLinked() {
+  uint32_t connects = connectCount;
+  uint32_t disconnects = disconnectCount;
+
+  executeWake();
+  CHECK(rigAwake(2));
+  CHECK(wakeMode && hostBle.advertising);     // The beacon goes out with the link up
+
+  hostBleConnectOther(otherBda[0]);
+  CHECK(rigAwake(0));
+  CHECK(hostBle.otherLinks.size() == 1);
+  hostRunFor(100);
+  CHECK(hostBle.otherLinks.empty());
+  CHECK(deviceConnected && hostBle.connected);
+  CHECK(strcmp(connectedDeviceAddress, hostCamera.address) == 0);
+  CHECK(connectCount == connects && disconnectCount == disconnects);
+
+  // The next slice puts the beacon back on air for the last camera
+  CHECK(hostRunUntil([]() { return hostBle.advertising; }, 1000));
+  hostBleConnectOther(otherBda[1]);
+  CHECK(rigAwake(1));
+  CHECK(hostRunUntil([]() { return !wakeMode; }, 1000));
+  hostRunFor(100);
+
+  printf("rig of %d woken with one link: all connected after %ldms\n", rigCameraCount, wakeAllConnectedMs);
+  CHECK(wakeAllConnectedMs >= 0);
+  CHECK(!hostBle.advertising);                // Nothing else may connect while linked
+  CHECK(hostBle.otherLinks.empty());
+  CHECK(deviceConnected && disconnectCount == disconnects);
+}
+
+// The camera's own link going down brings normal advertising back
+static void testLinkDrops() {
+  uint32_t disconnects = disconnectCount;
+  hostCameraDropLink();
+  CHECK(!deviceConnected);
+  CHECK(disconnectCount == disconnects + 1);
+  CHECK(hostBle.advertising && !wakeMode);
+  CHECK(hostRunUntil([]() { return deviceConnected; }, 2000));
+}
+
+int main() {
+  saveCurrentCamera("X5 2BCDEF", "24:0a:c4:44:55:66");
+  saveCurrentCamera("X4 3CDEFG", "24:0a:c4:77:88:99");
+  hostCameraPair();
+  setup();
+  CHECK(rigCameraCount == 3);
+  CHECK(hostRunUntil([]() { return deviceConnected; }, 5000));
+  hostRunFor(1000);
+
+  testWakeWhileLinked();
+  testLinkDrops();
+
+  return hostTestResult("rig_wake_test");
+}
@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+"""Host client for the remote's serial line protocol (see serial_api.h).
+
+  serial_client.py --port /dev/ttyUSB0 SHUTTER
+  serial_client.py --port /dev/ttyUSB0 bench -n 200 --verb SHUTTER
+  serial_client.py --exec ./serial_host bench -n 200 --max-p50-ms 20
+
+Each request gets a tag, the reply lines carrying that tag are collected up
+to the closing @OK or @ERR. bench reports the round trip seen by the host
+and the remote's own rx->tx time from the reply.
+"""
+
+import argparse
+import queue
+import subprocess
+import sys
+import threading
+import time
+
+
+class ExecLink:
+    """A host build of the sketch talking on stdin/stdout."""
+
+    def __init__(self, command):
+        self.process = subprocess.Popen(command, shell=True, stdin=subprocess.PIPE,
+                                        stdout=subprocess.PIPE, bufsize=0)
+        self.lines = queue.Queue()
+        threading.Thread(target=self._read, daemon=True).start()
+
+    def _read(self):
+        for line in self.process.stdout:
+            self.lines.put(line.decode(errors="replace").rstrip("\r\n"))
+
+    def write(self, text):
+        self.process.stdin.write(text.encode())
+        self.process.stdin.flush()
+
+    def readline(self, timeout):
+        try:
+            return self.lines.get(timeout=timeout)
+        except queue.Empty:
+            return None
+
+    def close(self):
+        self.process.stdin.close()
+        self.process.wait(timeout=5)
+
+
+class SerialLink:
+    """A remote on a serial port, needs pyserial."""
+
+    def __init__(self, port, baud):
+        import serial
+        self.port = serial.Serial(port, baud, timeout=0.05)
+
+    def write(self, text):
+        self.port.write(text.encode())
+
+    def readline(self, timeout):
+        end = time.monotonic() + timeout
+        while time.monotonic() < end:
+            line = self.port.readline()
+            if line:
+                return line.decode(errors="replace").rstrip("\r\n")
+        return None
+
+    def close(self):
+        self.port.close()
+
+
+class Remote:
+    def __init__(self, link):
+        self.link = link
+        self.next_tag = 1
+
+    def request(self, verb, args="", timeout=2.0):
+        """Send one request, returns (reply lines, host round trip in us)."""
+        tag = "t%d" % self.next_tag
+        self.next_tag += 1
+        line = "%s %s %s" % (verb, tag, args) if args else "%s %s" % (verb, tag)
+
+        start = time.perf_counter()
+        self.link.write(line + "\n")
+        replies = []
+        end = time.monotonic() + timeout
+        while time.monotonic() < end:
+            reply = self.link.readline(max(0.0, end - time.monotonic()))
+            if reply is None:
+                break
+            fields = reply.split()
+            if len(fields) < 2 or not fields[0].startswith("@"):
+                continue
+            if fields[0] in ("@OK", "@ERR"):
+                if len(fields) >= 3 and fields[2] == tag:
+                    replies.append(reply)
+                    return replies, (time.perf_counter() - start) * 1e6
+            elif fields[1] == tag:
+                replies.append(reply)
+        raise TimeoutError("no reply to " + line)
+
+
+def reply_fields(reply):
+    """key=value pairs of a reply line."""
+    fields = {}
+    for field in reply.split():
+        key, sep, value = field.partition("=")
+        if sep:
+            fields[key] = value
+    return fields
+
+
+def percentile(samples, p):
+    samples = sorted(samples)
+    return samples[min(len(samples) - 1, int(round(p / 100.0 * (len(samples) - 1))))]
+
+
+def bench(remote, count, verb, gap_ms, max_p50_ms):
+    # Wait until the remote reports the camera connected
+    for _ in range(50):
+        replies, _ = remote.request("STATE")
+        if any("connected=1" in r for r in replies):
+            break
+        time.sleep(0.1)
+    else:
+        print("camera not connected")
+        return 1
+
+    host_us, remote_us = [], []
+    errors = 0
+    for _ in range(count):
+        replies, round_trip = remote.request(verb)
+        last = replies[-1]
+        if last.startswith("@ERR"):
+            errors += 1
+        else:
+            fields = reply_fields(last)
+            host_us.append(round_trip)
+            remote_us.append(int(fields["tx"]) - int(fields["rx"]))
+        time.sleep(gap_ms / 1000.0)
+
+    if not host_us:
+        print("%s: every request failed" % verb)
+        return 1
+    print("%s x%d errors=%d" % (verb, count, errors))
+    for name, samples in (("host round trip", host_us), ("remote rx->tx", remote_us)):
+        print("  %-16s p50=%8.0fus p95=%8.0fus max=%8.0fus" % (
+            name, percentile(samples, 50), percentile(samples, 95), max(samples)))
+
+    if max_p50_ms is not None and percentile(host_us, 50) > max_p50_ms * 1000:
+        print("host round trip p50 over %gms" % max_p50_ms)
+        return 1
+    return 1 if errors else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    target = parser.add_mutually_exclusive_group(required=True)
+    target.add_argument("--port", help="serial port of the remote")
+    target.add_argument("--exec", dest="command", help="run a host build and talk to it on stdin/stdout")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("verb", help="request verb, or bench")
+    parser.add_argument("args", nargs="*", help="request arguments after the tag")
+    parser.add_argument("-n", type=int, default=100, help="bench: requests to send")
+    parser.add_argument("--verb", dest="bench_verb", default="SHUTTER", help="bench: verb to send")
+    parser.add_argument("--gap-ms", type=float, default=50, help="bench: pause between requests")
+    parser.add_argument("--max-p50-ms", type=float, help="bench: fail above this round trip median")
+    options = parser.parse_args()
+
+    link = SerialLink(options.port, options.baud) if options.port else ExecLink(options.command)
+    remote = Remote(link)
+    try:
+        if options.verb == "bench":
+            return bench(remote, options.n, options.bench_verb, options.gap_ms, options.max_p50_ms)
+        replies, round_trip = remote.request(options.verb.upper(), " ".join(options.args))
+        for reply in replies:
+            print(reply)
+        print("round trip %.0fus" % round_trip)
+        return 1 if replies[-1].startswith("@ERR") else 0
+    finally:
+        link.close()
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,50 @@
+/*
+ * serial_host.cpp
+ * The sketch in real time on stdin/stdout, paired and connected to a simulated camera
+ *
+ * Stands in for a remote on USB serial so serial_client.py can be tried and
+ * benchmarked without hardware:
+ *   ./serial_host                              (type PING, SHUTTER t1, STATE ...)
+ *   python3 serial_client.py --exec ./serial_host bench -n 200
+ * Exits when stdin closes.
+ */
+
+#include <Arduino.h>
+#include "../insta360_m5StickC_remote.ino"
+#include "host/host_sim.h"
+#include "camera_sim.h"
+#include <poll.h>
+#include <unistd.h>
+
+// Sleeps until stdin has bytes or maxUs is up, the bytes go to the sketch's Serial
+static uint64_t waitForStdin(uint64_t maxUs) {
+  double start = hostWallUs();
+  struct pollfd input = {STDIN_FILENO, POLLIN, 0};
+  struct timespec timeout = {(time_t)(maxUs / 1000000), (long)(maxUs % 1000000) * 1000};
+
+  if (ppoll(&input, 1, &timeout, nullptr) > 0) {
+    char buffer[256];
+    ssize_t n = read(STDIN_FILENO, buffer, sizeof(buffer) - 1);
+    if (n <= 0) {
+      exit(0);
+    }
+    buffer[n] = '\0';
+    hostSerialInput(buffer);
+  }
+  return (uint64_t)(hostWallUs() - start);
+}
+
+int main() {
+  setvbuf(stdout, nullptr, _IONBF, 0);
+  Serial.echo = true;
+
+  hostCamera.heartbeatMs = 1000;
+  hostCameraPair();
+  setup();
+  hostCameraConnect();
+
+  hostWait = waitForStdin;
+  for (;;) {
+    loop();
+  }
+}
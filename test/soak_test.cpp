@@ -0,0 +1,152 @@
+/*
+ * soak_test.cpp
+ * 24 hours of use against a simulated camera on the virtual clock: reconnects, lost commands, answer latency
+ *
+ * Every 20-120 s the "user" fires a command: mostly shutter and mode, now and
+ * then screen off, sleep (followed by wake on the next turn), a radio drop or
+ * a stretch of missing heartbeats. The camera loses 1% of its answers.
+ */
+
+#include <Arduino.h>
+#include "../insta360_m5StickC_remote.ino"
+#include "host/host_sim.h"
+#include "camera_sim.h"
+
+struct SoakCounts {
+  uint32_t commands[NUM_REMOTE_ACTIONS];
+  uint32_t drops;
+  uint32_t stalls;
+  uint32_t sleeps;
+  uint32_t skipped;           // Turns that found the link still down
+};
+
+static SoakCounts soak;
+static std::vector<double> reconnectMs;
+static std::vector<double> wakeMs;
+
+// Runs until the camera is back, records how long that took
+static void awaitReconnect(std::vector<double> &samples, unsigned long limitMs) {
+  uint64_t start = hostNowUs;
+  if (hostRunUntil([]() { return deviceConnected; }, limitMs)) {
+    samples.push_back((hostNowUs - start) / 1000.0);
+  }
+}
+
+static void userTurn(std::mt19937 &random) {
+  if (hostCamera.asleep) {
+    runRemoteAction(ACTION_WAKE);
+    soak.commands[ACTION_WAKE]++;
+    awaitReconnect(wakeMs, wakeDuration + 1000);
+    return;
+  }
+  if (!deviceConnected) {
+    soak.skipped++;
+    return;
+  }
+
+  int pick = random() % 100;
+  if (pick < 50) {
+    runRemoteAction(ACTION_SHUTTER);
+    soak.commands[ACTION_SHUTTER]++;
+  } else if (pick < 80) {
+    runRemoteAction(ACTION_MODE);
+    soak.commands[ACTION_MODE]++;
+  } else if (pick < 90) {
+    runRemoteAction(ACTION_SCREEN_OFF);
+    soak.commands[ACTION_SCREEN_OFF]++;
+  } else if (pick < 94) {
+    runRemoteAction(ACTION_SLEEP);
+    soak.commands[ACTION_SLEEP]++;
+    soak.sleeps++;
+  } else if (pick < 97) {
+    soak.drops++;
+    hostCameraDropLink();
+    awaitReconnect(reconnectMs, 10000);
+  } else {
+    // The remote notices the silence and drops the link itself
+    soak.stalls++;
+    hostCamera.heartbeatsStalled = true;
+    hostRunUntil([]() { return !deviceConnected; }, 30000);
+    hostCamera.heartbeatsStalled = false;
+    awaitReconnect(reconnectMs, 10000);
+  }
+}
+
+int main() {
+  const unsigned long soakMs = 24UL * 3600 * 1000;
+  hostCamera.heartbeatMs = 1000;
+  hostCamera.answerUs = 8000;
+  hostCamera.answerJitterUs = 40000;
+  hostCamera.answerLoss = 0.01;
+
+  hostCameraPair();
+  setup();
+  hostRunUntil([]() { return deviceConnected; }, 5000);
+
+  std::mt19937 random(11);
+  double wallStart = hostWallUs();
+  while (millis() < soakMs) {
+    hostRunFor(20000 + random() % 100000);
+    userTurn(random);
+    hostSerialTake();
+  }
+  hostRunFor(5000);
+  double wallMs = (hostWallUs() - wallStart) / 1000;
+
+  uint32_t sent = 0;
+  for (int a = 0; a < NUM_REMOTE_ACTIONS; a++) {
+    sent += commandAckStats[a].sent;
+  }
+  printf("soak: %lus virtual in %.0fms, %u commands sent, %u turns skipped while reconnecting\n",
+         millis() / 1000, wallMs, (unsigned)sent, (unsigned)soak.skipped);
+  printf("  link: %u connects, %u disconnects (%u drops, %u heartbeat stalls, %u sleeps), %u wakes\n",
+         (unsigned)connectCount, (unsigned)disconnectCount, (unsigned)soak.drops, (unsigned)soak.stalls,
+         (unsigned)soak.sleeps, (unsigned)hostCamera.wakes);
+  printf("  reconnect ms: p50 %.0f p95 %.0f max %.0f, wake to connected ms: p50 %.0f max %.0f\n",
+         hostPercentile(reconnectMs, 50), hostPercentile(reconnectMs, 95), hostPercentile(reconnectMs, 100),
+         hostPercentile(wakeMs, 50), hostPercentile(wakeMs, 100));
+  printf("  lost commands %u, answers the camera lost %u\n", (unsigned)lostCommandCount(),
+         (unsigned)hostCamera.lostAnswers);
+  printf("  camera answer ms: p50 %.1f p95 %.1f, remote ack histogram:",
+         hostPercentile(hostCamera.answerUsSamples, 50) / 1000, hostPercentile(hostCamera.answerUsSamples, 95) / 1000);
+  for (int b = 0; b < ACK_HISTOGRAM_BUCKETS; b++) {
+    printf(b == ACK_HISTOGRAM_BUCKETS - 1 ? " >=%lums:%u" : " <%lums:%u", 16UL << (b == ACK_HISTOGRAM_BUCKETS - 1 ? b - 1 : b),
+           (unsigned)ackHistogram[b]);
+  }
+  printf("\n");
+
+  // Every disconnect was followed by a reconnect, the last one unless the camera sleeps
+  CHECK(connectCount == hostCamera.connects);
+  CHECK(disconnectCount == soak.drops + soak.stalls + soak.sleeps);
+  CHECK(connectCount == disconnectCount + (deviceConnected ? 1 : 0));
+  CHECK(reconnectMs.size() == soak.drops + soak.stalls);
+  CHECK(wakeMs.size() == hostCamera.wakes);
+  CHECK(hostPercentile(reconnectMs, 100) < 2000);
+  CHECK(hostPercentile(wakeMs, 100) < wakeDuration);
+
+  // A command is lost exactly when its answer was, and every sent command resolved
+  CHECK(lostCommandCount() == hostCamera.lostAnswers);
+  uint32_t resolved = 0;
+  for (int a = 0; a < NUM_REMOTE_ACTIONS; a++) {
+    resolved += commandAckStats[a].answered + commandAckStats[a].timeouts;
+  }
+  CHECK(resolved == sent);
+  CHECK(soak.commands[ACTION_SHUTTER] > 500);
+
+  // The remote sees each answer when it arrives, not at its next loop pass
+  uint32_t cameraHistogram[ACK_HISTOGRAM_BUCKETS] = {};
+  for (double us : hostCamera.answerUsSamples) {
+    int bucket = 0;
+    while (bucket < ACK_HISTOGRAM_BUCKETS - 1 && us >= (16000UL << bucket)) {
+      bucket++;
+    }
+    cameraHistogram[bucket]++;
+  }
+  uint32_t misplaced = 0;
+  for (int b = 0; b < ACK_HISTOGRAM_BUCKETS; b++) {
+    misplaced += abs((int)ackHistogram[b] - (int)cameraHistogram[b]);
+  }
+  CHECK(misplaced * 100 <= sent);
+
+  return hostTestResult("soak_test");
+}
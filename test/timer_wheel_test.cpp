@@ -0,0 +1,177 @@
+/*
+ * timer_wheel_test.cpp
+ * Timer wheel on a virtual clock, plus insert, cancel and fire benchmarks with thousands of timers
+ */
+
+#include <Arduino.h>
+#include "../timer_wheel.h"
+#include "host/host_sim.h"
+#include <random>
+
+static unsigned long virtualMs = 0;
+
+static unsigned long virtualClock() {
+  return virtualMs;
+}
+
+struct TestTimer {
+  WheelTimer timer;
+  unsigned long dueMs;
+  unsigned long firedMs;
+  int fired;
+  bool cancelled;
+};
+
+static int lateFires = 0;
+static int earlyFires = 0;
+
+static void testFired(void* arg) {
+  TestTimer* t = (TestTimer*)arg;
+  t->fired++;
+  t->firedMs = virtualMs;
+  if (virtualMs < t->dueMs) {
+    earlyFires++;
+  } else if (virtualMs >= t->dueMs + WHEEL_TICK_MS) {
+    lateFires++;
+  }
+}
+
+// Steps the clock 1ms at a time, so a timer must fire within the tick it falls due in
+static void advanceTo(unsigned long ms) {
+  while (virtualMs < ms) {
+    virtualMs++;
+    runTimerWheel();
+  }
+}
+
+static void testVirtualClock() {
+  std::mt19937 rng(7);
+  const int count = 5000;
+  std::vector<TestTimer> timers(count);
+
+  virtualMs = 123457;
+  wheelInit();
+
+  // Delays across all three levels and past the wheel's span
+  for (int i = 0; i < count; i++) {
+    unsigned long delayMs;
+    switch (i % 4) {
+      case 0:  delayMs = rng() % 2560; break;
+      case 1:  delayMs = rng() % 163840; break;
+      case 2:  delayMs = rng() % (WHEEL_MAX_TICKS * WHEEL_TICK_MS); break;
+      default: delayMs = WHEEL_MAX_TICKS * WHEEL_TICK_MS + rng() % 3600000; break;
+    }
+    timers[i] = TestTimer();
+    timers[i].dueMs = virtualMs + delayMs;
+    wheelSchedule(&timers[i].timer, delayMs, testFired, &timers[i]);
+  }
+
+  // Cancel one in five and move one in five somewhere else
+  for (int i = 0; i < count; i += 5) {
+    wheelCancel(&timers[i].timer);
+    timers[i].cancelled = true;
+  }
+  advanceTo(virtualMs + 60000);
+  for (int i = 1; i < count; i += 5) {
+    if (!timers[i].fired) {
+      unsigned long delayMs = rng() % 600000;
+      timers[i].dueMs = virtualMs + delayMs;
+      wheelSchedule(&timers[i].timer, delayMs, testFired, &timers[i]);
+    }
+  }
+
+  unsigned long lastDue = 0;
+  for (const TestTimer &t : timers) {
+    lastDue = max(lastDue, t.dueMs);
+  }
+  advanceTo(lastDue + 1000);
+
+  int missing = 0;
+  int twice = 0;
+  for (const TestTimer &t : timers) {
+    if (t.cancelled) {
+      CHECK(t.fired == 0);
+    } else if (t.fired == 0) {
+      missing++;
+    } else if (t.fired > 1) {
+      twice++;
+    }
+    CHECK(!wheelPending(&t.timer));
+  }
+  printf("virtual clock: %d timers, %d missing, %d twice, %d early, %d late\n",
+         count, missing, twice, earlyFires, lateFires);
+  CHECK(missing == 0);
+  CHECK(twice == 0);
+  CHECK(earlyFires == 0);
+  CHECK(lateFires == 0);
+}
+
+// A pass that skips ticks (a slow loop) still runs everything that fell due, in order
+static void testCoarseSteps() {
+  virtualMs = 5;
+  wheelInit();
+  TestTimer a = TestTimer(), b = TestTimer();
+  a.dueMs = 35;
+  b.dueMs = 3000;
+  wheelSchedule(&a.timer, 30, testFired, &a);
+  wheelSchedule(&b.timer, 2995, testFired, &b);
+
+  virtualMs = 2000;
+  runTimerWheel();
+  CHECK(a.fired == 1 && b.fired == 0);
+  virtualMs = 5000;
+  runTimerWheel();
+  CHECK(b.fired == 1);
+}
+
+static void benchFired(void* arg) {
+  (*(int*)arg)++;
+}
+
+static void benchmark() {
+  const int count = 10000;
+  std::vector<WheelTimer> timers(count);
+  std::vector<unsigned long> delays(count);
+  std::mt19937 rng(11);
+  for (int i = 0; i < count; i++) {
+    delays[i] = 10 + rng() % 600000;
+    timers[i] = WheelTimer();
+  }
+  int fired = 0;
+
+  virtualMs = 0;
+  wheelInit();
+
+  double start = hostWallUs();
+  for (int i = 0; i < count; i++) {
+    wheelSchedule(&timers[i], delays[i], benchFired, &fired);
+  }
+  double insertNs = (hostWallUs() - start) * 1000 / count;
+
+  start = hostWallUs();
+  for (int i = 0; i < count; i += 2) {
+    wheelCancel(&timers[i]);
+  }
+  double cancelNs = (hostWallUs() - start) * 1000 / (count / 2);
+
+  start = hostWallUs();
+  int ticks = 0;
+  while (virtualMs <= 610000) {
+    virtualMs += WHEEL_TICK_MS;
+    runTimerWheel();
+    ticks++;
+  }
+  double runUs = hostWallUs() - start;
+
+  printf("benchmark: %d timers, insert %.0f ns, cancel %.0f ns, run %.0f ns per fired timer, %.0f ns per tick\n",
+         count, insertNs, cancelNs, runUs * 1000 / max(fired, 1), runUs * 1000 / ticks);
+  CHECK(fired == count / 2);
+}
+
+int main() {
+  wheelClock = virtualClock;
+  testVirtualClock();
+  testCoarseSteps();
+  benchmark();
+  return hostTestResult("timer_wheel_test");
+}
@@ -0,0 +1,178 @@
+/*
+ * timer_wheel.h
+ * Hierarchical timer wheel with O(1) schedule and cancel, run from loop()
+ * Timers are owned by the caller and must only be touched from the loop task.
+ */
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+// Wheel geometry: 10ms ticks, 256 + 64 + 64 slots covers about 2.9 hours
+#define WHEEL_TICK_MS     10
+#define WHEEL_L0_BITS     8
+#define WHEEL_LN_BITS     6
+#define WHEEL_L0_SIZE     (1 << WHEEL_L0_BITS)
+#define WHEEL_LN_SIZE     (1 << WHEEL_LN_BITS)
+#define WHEEL_L0_MASK     (WHEEL_L0_SIZE - 1)
+#define WHEEL_LN_MASK     (WHEEL_LN_SIZE - 1)
+#define WHEEL_L1_SHIFT    WHEEL_L0_BITS
+#define WHEEL_L2_SHIFT    (WHEEL_L0_BITS + WHEEL_LN_BITS)
+#define WHEEL_MAX_TICKS   (1UL << (WHEEL_L0_BITS + 2 * WHEEL_LN_BITS))
+
+typedef void (*WheelCallback)(void* arg);
+typedef unsigned long (*WheelClock)();
+
+// Time source in ms, a test can drive the wheel from its own clock
+WheelClock wheelClock = millis;
+
+// Intrusive timer, also used as the list head of each slot
+struct WheelTimer {
+  WheelTimer* next;
+  WheelTimer* prev;
+  uint32_t expires;           // Tick at which the callback runs
+  WheelCallback callback;
+  void* arg;
+};
+
+struct TimerWheel {
+  bool ready;
+  uint32_t tick;              // Next tick to process
+  WheelTimer l0[WHEEL_L0_SIZE];
+  WheelTimer l1[WHEEL_LN_SIZE];
+  WheelTimer l2[WHEEL_LN_SIZE];
+};
+
+TimerWheel timerWheel;
+
+inline void wheelListInit(WheelTimer* head) {
+  head->next = head;
+  head->prev = head;
+}
+
+inline void wheelListAppend(WheelTimer* head, WheelTimer* t) {
+  t->prev = head->prev;
+  t->next = head;
+  head->prev->next = t;
+  head->prev = t;
+}
+
+inline void wheelListUnlink(WheelTimer* t) {
+  t->prev->next = t->next;
+  t->next->prev = t->prev;
+  t->next = nullptr;
+  t->prev = nullptr;
+}
+
+void wheelInit() {
+  for (int i = 0; i < WHEEL_L0_SIZE; i++) {
+    wheelListInit(&timerWheel.l0[i]);
+  }
+  for (int i = 0; i < WHEEL_LN_SIZE; i++) {
+    wheelListInit(&timerWheel.l1[i]);
+    wheelListInit(&timerWheel.l2[i]);
+  }
+  timerWheel.tick = wheelClock() / WHEEL_TICK_MS;
+  timerWheel.ready = true;
+}
+
+// Put a timer in the slot matching its distance from the current tick
+void wheelPlace(WheelTimer* t) {
+  uint32_t delta = t->expires - timerWheel.tick;
+  uint32_t slotTick = t->expires;
+
+  if ((int32_t)delta < 0) {
+    // Already due, runs on the next tick
+    wheelListAppend(&timerWheel.l0[timerWheel.tick & WHEEL_L0_MASK], t);
+    return;
+  }
+
+  if (delta >= WHEEL_MAX_TICKS) {
+    // Park in the furthest slot, re-placed when that slot cascades
+    slotTick = timerWheel.tick + WHEEL_MAX_TICKS - 1;
+    delta = WHEEL_MAX_TICKS - 1;
+  }
+
+  if (delta < WHEEL_L0_SIZE) {
+    wheelListAppend(&timerWheel.l0[slotTick & WHEEL_L0_MASK], t);
+  } else if (delta < (1UL << WHEEL_L2_SHIFT)) {
+    wheelListAppend(&timerWheel.l1[(slotTick >> WHEEL_L1_SHIFT) & WHEEL_LN_MASK], t);
+  } else {
+    wheelListAppend(&timerWheel.l2[(slotTick >> WHEEL_L2_SHIFT) & WHEEL_LN_MASK], t);
+  }
+}
+
+inline bool wheelPending(const WheelTimer* t) {
+  return t->prev != nullptr;
+}
+
+void wheelCancel(WheelTimer* t) {
+  if (wheelPending(t)) {
+    wheelListUnlink(t);
+  }
+}
+
+// Run callback(arg) once, delayMs from now. Re-scheduling a pending timer moves it.
+void wheelSchedule(WheelTimer* t, unsigned long delayMs, WheelCallback callback, void* arg = nullptr) {
+  if (!timerWheel.ready) {
+    wheelInit();
+  }
+
+  wheelCancel(t);
+  t->callback = callback;
+  t->arg = arg;
+  t->expires = (wheelClock() + delayMs + WHEEL_TICK_MS - 1) / WHEEL_TICK_MS;
+  wheelPlace(t);
+}
+
+// Move every timer of a higher-level slot down the wheel
+void wheelCascade(WheelTimer* head) {
+  while (head->next != head) {
+    WheelTimer* t = head->next;
+    wheelListUnlink(t);
+    wheelPlace(t);
+  }
+}
+
+// Call from loop(), runs every callback that is due
+void runTimerWheel() {
+  if (!timerWheel.ready) {
+    wheelInit();
+  }
+
+  uint32_t target = wheelClock() / WHEEL_TICK_MS;
+
+  while ((int32_t)(target - timerWheel.tick) >= 0) {
+    uint32_t tick = timerWheel.tick;
+    int index = tick & WHEEL_L0_MASK;
+
+    if (index == 0) {
+      int l1Index = (tick >> WHEEL_L1_SHIFT) & WHEEL_LN_MASK;
+      wheelCascade(&timerWheel.l1[l1Index]);
+      if (l1Index == 0) {
+        wheelCascade(&timerWheel.l2[(tick >> WHEEL_L2_SHIFT) & WHEEL_LN_MASK]);
+      }
+    }
+
+    // Detach the slot first so callbacks can re-schedule freely
+    WheelTimer due;
+    wheelListInit(&due);
+    WheelTimer* slot = &timerWheel.l0[index];
+    if (slot->next != slot) {
+      due.next = slot->next;
+      due.prev = slot->prev;
+      due.next->prev = &due;
+      due.prev->next = &due;
+      wheelListInit(slot);
+    }
+
+    timerWheel.tick++;
+
+    while (due.next != &due) {
+      WheelTimer* t = due.next;
+      wheelListUnlink(t);
+      t->callback(t->arg);
+    }
+  }
+}
+
+#endif // TIMER_WHEEL_H
@@ -8,13 +8,8 @@
 
 // UI variables
 int currentScreen = 0;
-
-// GPIO variables
-unsigned long lastPinPress[3] = {0, 0, 0}; // For G0, G26, G36
-unsigned long startupTime = 0;
-
-// External GPIO delay variable (defined in main sketch)
-extern int gpioDelay;
+bool overlayActive = false;     // A message is covering the current screen
+WheelTimer overlayTimer;
 
 // Auto-detection and scaling variables
 bool isPlus2 = false;
@@ -37,6 +32,42 @@ struct ScreenLayout {
 
 ScreenLayout layout;
 
+// Static face of each menu screen: icon and label
+struct ScreenFace {
+  const uint8_t* icon;
+  uint16_t color;
+  const char* label;
+};
+
+const ScreenFace screenFaces[NUM_SCREENS] = {
+  {bluetooth_icon, ICON_BLUE,   "CONNECT"},
+  {shutter_icon,   ICON_RED,    "SHUTTER"},
+  {switch_icon,    ICON_ORANGE, "MODE"},
+  {screen_icon,    ICON_PINK,   "SCREEN"},
+  {sleep_icon,     ICON_PURPLE, "SLEEP"},
+  {wake_icon,      ICON_YELLOW, "WAKE"},
+  {macro_icon,     ICON_CYAN,   "MACRO"},
+};
+
+// Faces pre-rendered into 2-bit palette sprites (black, icon, label), each a
+// full-width band from the icon to the bottom of the label. Navigating between
+// menu screens pushes the band and moves the active dot instead of redrawing.
+M5Canvas screenCache[NUM_SCREENS];
+bool screenCached[NUM_SCREENS];
+int screenBandY = 0;
+int screenBandHeight = 0;
+size_t screenCacheBytes = 0;
+bool menuFrameShown = false;    // The display holds a menu frame, no message over it
+
+struct ScreenNavStats {
+  uint32_t count;
+  uint32_t lastUs;
+  uint32_t maxUs;
+  uint32_t totalUs;
+};
+
+ScreenNavStats screenNavStats[NUM_SCREENS];
+
 void detectDeviceAndSetScale() {
   // Detect device by screen dimensions
   int screenWidth = M5.Lcd.width();
@@ -125,22 +156,151 @@ void drawBitmap(int16_t x, int16_t y, const uint8_t *bitmap, int16_t w, int16_t
   }
 }
 
+void drawLinkQualityBars(int quality) {
+  // Three signal bars filling the status dot's box
+  int size = 2 * layout.connectionRadius + 1;
+  int left = layout.statusX - layout.connectionRadius;
+  int bottom = layout.statusY + layout.connectionRadius;
+  int barWidth = (size - 2) / 3;
+
+  uint16_t color = GREEN;
+  if (quality == LINK_QUALITY_FAIR) {
+    color = YELLOW;
+  } else if (quality <= LINK_QUALITY_POOR) {
+    color = RED;
+  }
+
+  for (int i = 0; i < 3; i++) {
+    int barHeight = size * (i + 1) / 3;
+    int x = left + i * (barWidth + 1);
+    if (i < quality) {
+      M5.Lcd.fillRect(x, bottom - barHeight + 1, barWidth, barHeight, color);
+    } else {
+      M5.Lcd.drawRect(x, bottom - barHeight + 1, barWidth, barHeight, DARKGREY);
+    }
+  }
+}
+
 void drawConnectionStatus() {
-  // Draw connection status circle in top-right corner
-  if (deviceConnected) {
+  // Draw connection status in top-right corner
+  int r = layout.connectionRadius;
+  M5.Lcd.fillRect(layout.statusX - r, layout.statusY - r, 2 * r + 1, 2 * r + 1, BLACK);
+
+  if (deviceConnected && linkHealth.quality != LINK_QUALITY_UNKNOWN) {
+    drawLinkQualityBars(linkHealth.quality);
+  } else if (deviceConnected) {
     M5.Lcd.fillCircle(layout.statusX, layout.statusY, layout.connectionRadius, GREEN);
   } else if (pairingMode) {
     M5.Lcd.fillCircle(layout.statusX, layout.statusY, layout.connectionRadius, YELLOW);
   } else {
     M5.Lcd.fillCircle(layout.statusX, layout.statusY, layout.connectionRadius, RED);
   }
+
+  linkHealth.dirty = false;
+}
+
+void drawBatteryStatus() {
+  // Draw the cached battery level, never reads the power IC
+  M5.Lcd.fillRect(layout.battX, layout.battY, isPlus2 ? 200 : 135, 8, BLACK);
+  M5.Lcd.setTextColor(DARKGREY);
+  M5.Lcd.setTextSize(1);
+  M5.Lcd.setCursor(layout.battX, layout.battY);
+
+  char battString[48];
+  if (battery.level < 0) {
+    snprintf(battString, sizeof(battString), "Battery: --");
+  } else if (battery.minutesRemaining >= 0) {
+    snprintf(battString, sizeof(battString), "Battery: %d ~%ldh%02ldm", battery.level,
+             battery.minutesRemaining / 60, battery.minutesRemaining % 60);
+  } else {
+    snprintf(battString, sizeof(battString), "Battery: %d", battery.level);
+  }
+  M5.Lcd.print(battString);
+
+  battery.dirty = false;
 }
 
 // Helper function to get text width for proper centering
-int getTextWidth(String text, int textSize) {
+int getTextWidth(const char* text, int textSize) {
   // Approximate character width based on text size
   int charWidth = (textSize == 1) ? 6 : 12;  // Size 1 = ~6px, Size 2 = ~12px per char
-  return text.length() * charWidth;
+  return strlen(text) * charWidth;
+}
+
+// Helper function to get centered label position
+int labelX(const char* text) {
+  return layout.textX - getTextWidth(text, scaledTextSize) / 2;
+}
+
+// Call from setup() once the layout is known and the radio stacks hold their memory
+void buildScreenCache() {
+  screenBandY = layout.iconY;
+  screenBandHeight = layout.textY + 8 * scaledTextSize - layout.iconY;
+  int width = M5.Lcd.width();
+  size_t bytes = (width * 2 + 7) / 8 * screenBandHeight;
+
+  for (int i = 0; i < NUM_SCREENS; i++) {
+    // Leave the heap the BLE stack needs at runtime, uncached screens draw directly
+    if (ESP.getMaxAllocHeap() < bytes + screenCacheHeapReserve) {
+      break;
+    }
+
+    M5Canvas &band = screenCache[i];
+    band.setColorDepth(2);
+    if (!band.createSprite(width, screenBandHeight)) {
+      break;
+    }
+    band.setPaletteColor(0, (uint16_t)BLACK);
+    band.setPaletteColor(1, (uint16_t)screenFaces[i].color);
+    band.setPaletteColor(2, (uint16_t)WHITE);
+
+    band.fillScreen(0);
+    band.drawBitmap(layout.iconX, 0, screenFaces[i].icon, 32, 32, 1);
+    band.setTextSize(scaledTextSize);
+    band.setTextColor(2);
+    band.setCursor(labelX(screenFaces[i].label), layout.textY - screenBandY);
+    band.print(screenFaces[i].label);
+
+    screenCached[i] = true;
+    screenCacheBytes += bytes;
+  }
+
+  int cached = 0;
+  for (int i = 0; i < NUM_SCREENS; i++) {
+    cached += screenCached[i] ? 1 : 0;
+  }
+  Serial.printf("Screen cache: %d of %d screens, %u bytes, %lu bytes free\n", cached, NUM_SCREENS,
+                (unsigned)screenCacheBytes, (unsigned long)ESP.getFreeHeap());
+}
+
+void drawScreenFace(int screen) {
+  if (screenCached[screen]) {
+    screenCache[screen].pushSprite(&M5.Lcd, 0, screenBandY);
+    return;
+  }
+
+  const ScreenFace &face = screenFaces[screen];
+  M5.Lcd.fillRect(0, screenBandY, M5.Lcd.width(), screenBandHeight, BLACK);
+  drawBitmap(layout.iconX, layout.iconY, face.icon, 32, 32, face.color);
+  M5.Lcd.setTextSize(scaledTextSize);
+  M5.Lcd.setTextColor(WHITE);
+  M5.Lcd.setCursor(labelX(face.label), layout.textY);
+  M5.Lcd.print(face.label);
+}
+
+// Screen indicator dot at the bottom, filled for the current screen
+void drawScreenDot(int screen) {
+  int x = layout.dotsStartX + (screen * layout.dotsSpacing);
+  int y = layout.dotsY;
+  int dotRadius = isPlus2 ? 4 : 3;
+  int dotRadiusInactive = isPlus2 ? 3 : 2;
+
+  if (screen == currentScreen) {
+    M5.Lcd.fillCircle(x, y, dotRadius, WHITE);
+  } else {
+    M5.Lcd.fillCircle(x, y, dotRadius, BLACK);
+    M5.Lcd.drawCircle(x, y, dotRadiusInactive, DARKGREY);
+  }
 }
 
 void updateDisplay() {
@@ -153,68 +313,11 @@ void updateDisplay() {
   
   // Draw screen indicator dots at bottom
   for (int i = 0; i < NUM_SCREENS; i++) {
-    int x = layout.dotsStartX + (i * layout.dotsSpacing);
-    int y = layout.dotsY;
-    int dotRadius = isPlus2 ? 4 : 3;
-    int dotRadiusInactive = isPlus2 ? 3 : 2;
-    
-    if (i == currentScreen) {
-      M5.Lcd.fillCircle(x, y, dotRadius, WHITE);
-    } else {
-      M5.Lcd.drawCircle(x, y, dotRadiusInactive, DARKGREY);
-    }
+    drawScreenDot(i);
   }
   
   // Draw current screen content with properly centered text
-  String displayText = "";
-  uint16_t iconColor = WHITE;
-  
-  switch (currentScreen) {
-    case 0: // Connect New Camera
-      drawBitmap(layout.iconX, layout.iconY, bluetooth_icon, 32, 32, ICON_BLUE);
-      displayText = "CONNECT";
-      iconColor = ICON_BLUE;
-      break;
-      
-    case 1: // Shutter
-      drawBitmap(layout.iconX, layout.iconY, shutter_icon, 32, 32, ICON_RED);
-      displayText = "SHUTTER";
-      iconColor = ICON_RED;
-      break;
-      
-    case 2: // Switch Mode
-      drawBitmap(layout.iconX, layout.iconY, switch_icon, 32, 32, ICON_ORANGE);
-      displayText = "MODE";
-      iconColor = ICON_ORANGE;
-      break;
-      
-    case 3: // Screen Off
-      drawBitmap(layout.iconX, layout.iconY, screen_icon, 32, 32, ICON_PINK);
-      displayText = "SCREEN";
-      iconColor = ICON_PINK;
-      break;
-      
-    case 4: // Sleep
-      drawBitmap(layout.iconX, layout.iconY, sleep_icon, 32, 32, ICON_PURPLE);
-      displayText = "SLEEP";
-      iconColor = ICON_PURPLE;
-      break;
-      
-    case 5: // Wake
-      drawBitmap(layout.iconX, layout.iconY, wake_icon, 32, 32, ICON_YELLOW);
-      displayText = "WAKE";
-      iconColor = ICON_YELLOW;
-      break;
-  }
-  
-  // Calculate centered text position
-  int textWidth = getTextWidth(displayText, scaledTextSize);
-  int centeredTextX = layout.textX - (textWidth / 2);
-  
-  // Draw the text centered
-  M5.Lcd.setTextColor(WHITE);
-  M5.Lcd.setCursor(centeredTextX, layout.textY);
-  M5.Lcd.print(displayText);
+  drawScreenFace(currentScreen);
   
   // Show instructions hint (small text)
   M5.Lcd.setTextColor(DARKGREY);
@@ -223,14 +326,56 @@ void updateDisplay() {
   M5.Lcd.print("A:Run B:Next");
 
   // Show battery level
-  M5.Lcd.setTextColor(DARKGREY);
-  M5.Lcd.setTextSize(1);
-  M5.Lcd.setCursor(layout.battX, layout.battY);
-  char battString[32];
-  sprintf(battString, "Battery: %ld\n", M5.Power.getBatteryLevel());
-  M5.Lcd.print(battString);
+  drawBatteryStatus();
 
   displayCameraMode();
+  menuFrameShown = true;
+}
+
+// Button B: the status, battery and mode widgets are already current on a menu
+// frame, so only the face and the two dots that change are drawn
+void showNextScreen() {
+  uint32_t start = micros();
+  int previous = currentScreen;
+  currentScreen = (currentScreen + 1) % NUM_SCREENS;
+
+  if (menuFrameShown) {
+    drawScreenFace(currentScreen);
+    drawScreenDot(previous);
+    drawScreenDot(currentScreen);
+  } else {
+    updateDisplay();
+  }
+
+  ScreenNavStats &stats = screenNavStats[currentScreen];
+  stats.lastUs = micros() - start;
+  stats.totalUs += stats.lastUs;
+  stats.count++;
+  if (stats.lastUs > stats.maxUs) {
+    stats.maxUs = stats.lastUs;
+  }
+}
+
+void overlayExpired(void* arg) {
+  overlayActive = false;
+  updateDisplay();
+}
+
+// Keep a message on screen for durationMs, or until clearOverlay() when 0.
+// Buttons are ignored while an overlay is up, like the old blocking delays.
+void showOverlay(unsigned long durationMs) {
+  overlayActive = true;
+  menuFrameShown = false;
+  if (durationMs > 0) {
+    wheelSchedule(&overlayTimer, durationMs, overlayExpired);
+  } else {
+    wheelCancel(&overlayTimer);
+  }
+}
+
+void clearOverlay() {
+  wheelCancel(&overlayTimer);
+  overlayExpired(nullptr);
 }
 
 void showNotConnectedMessage() {
@@ -241,8 +386,7 @@ void showNotConnectedMessage() {
   M5.Lcd.setCursor(msgX, msgY);
   M5.Lcd.setTextColor(RED);
   M5.Lcd.println("Not Connected!");
-  delay(1500);
-  updateDisplay();
+  showOverlay(1500);
 }
 
 void showNoCameraMessage() {
@@ -258,66 +402,7 @@ void showNoCameraMessage() {
   M5.Lcd.setCursor(msgX + (isPlus2 ? 10 : 5), msgY2);
   M5.Lcd.setTextColor(WHITE);
   M5.Lcd.println("Connect first");
-  delay(2000);
-  updateDisplay();
-}
-
-void checkGPIOPins() {
-  unsigned long currentTime = millis();
-  
-  // Skip GPIO checks during startup delay
-  if (currentTime - startupTime < startupDelay) {
-    return; // GPIO input disabled during startup
-  }
-  
-  // One-time message when GPIO becomes active
-  static bool gpioActivationMessageShown = false;
-  if (!gpioActivationMessageShown) {
-    Serial.println("GPIO input now active!");
-    gpioActivationMessageShown = true;
-  }
-  
-  // Check G0 (SHUTTER_PIN) - Function #2 - Trigger on LOW (to GND)
-  static bool lastShutterState = HIGH; // G0 defaults to HIGH due to hardware pullup
-  bool currentShutterState = digitalRead(SHUTTER_PIN);
-  
-  if (currentShutterState == LOW && lastShutterState == HIGH && (currentTime - lastPinPress[0] > debounceDelay)) {
-    lastPinPress[0] = currentTime;
-    Serial.print("GPIO Pin G0 activated (pulled to GND) - Delaying ");
-    Serial.print(gpioDelay);
-    Serial.println("ms then executing Shutter");
-    delay(gpioDelay);  // Apply unique delay before executing
-    executeShutter();
-  }
-  lastShutterState = currentShutterState;
-  
-  // Check G26 (SLEEP_PIN) - Function #5 - Trigger on HIGH (to 3.3V)
-  static bool lastSleepState = LOW;
-  bool currentSleepState = digitalRead(SLEEP_PIN);
-  
-  if (currentSleepState == HIGH && lastSleepState == LOW && (currentTime - lastPinPress[1] > debounceDelay)) {
-    lastPinPress[1] = currentTime;
-    Serial.print("GPIO Pin G26 activated - Delaying ");
-    Serial.print(gpioDelay);
-    Serial.println("ms then executing Sleep");
-    delay(gpioDelay);  // Apply unique delay before executing
-    executeSleep();
-  }
-  lastSleepState = currentSleepState;
-  
-  // Check G25 (WAKE_PIN) - Function #6 - Trigger on HIGH (to 3.3V)
-  static bool lastWakeState = LOW;
-  bool currentWakeState = digitalRead(WAKE_PIN);
-  
-  if (currentWakeState == HIGH && lastWakeState == LOW && (currentTime - lastPinPress[2] > debounceDelay)) {
-    lastPinPress[2] = currentTime;
-    Serial.print("GPIO Pin G25 activated - Delaying ");
-    Serial.print(gpioDelay);
-    Serial.println("ms then executing Wake");
-    delay(gpioDelay);  // Apply unique delay before executing
-    executeWake();
-  }
-  lastWakeState = currentWakeState;
+  showOverlay(2000);
 }
 
 #endif // UI_H
\ No newline at end of file